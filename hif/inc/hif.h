@@ -405,6 +405,11 @@ struct hif_msg_callbacks {
 					uint32_t toeplitz_hash_result);
 	QDF_STATUS (*rxCompletionHandler)(void *Context, qdf_nbuf_t wbuf,
 					uint8_t pipeID);
+	QDF_STATUS (*rxCompletionHandlerMultiple)(void *Context,
+						  qdf_nbuf_t *wbufs,
+						  uint32_t num,
+						  uint8_t pipeID);
+	/**< optional, receives completions reaped together in one call */
 	void (*txResourceAvailHandler)(void *context, uint8_t pipe);
 	void (*fwEventHandler)(void *context, QDF_STATUS status);
 };
@@ -478,6 +483,25 @@ void hif_trigger_dump(struct hif_opaque_softc *hif_ctx,
 QDF_STATUS hif_send_head(struct hif_opaque_softc *scn, uint8_t PipeID,
 				  uint32_t transferID, uint32_t nbytes,
 				  qdf_nbuf_t wbuf, uint32_t data_attr);
+
+/**
+ * struct hif_gather_frag - one fragment of a gathered tx transfer
+ * @vaddr: CPU address of the fragment
+ * @paddr: DMA address of the fragment, only used by DMA buses
+ * @len: length of the fragment in bytes
+ */
+struct hif_gather_frag {
+	uint8_t *vaddr;
+	qdf_dma_addr_t paddr;
+	uint32_t len;
+};
+
+uint32_t hif_get_max_gather_frags(struct hif_opaque_softc *scn,
+				  uint8_t PipeID);
+QDF_STATUS hif_send_gather(struct hif_opaque_softc *scn, uint8_t PipeID,
+			   uint32_t transferID, uint32_t nbytes,
+			   struct hif_gather_frag *frags, uint32_t nfrags,
+			   qdf_nbuf_t ctx_buf);
 void hif_send_complete_check(struct hif_opaque_softc *scn, uint8_t PipeID,
 			     int force);
 void hif_shut_down_device(struct hif_opaque_softc *scn);
@@ -488,6 +512,32 @@ int hif_map_service_to_pipe(struct hif_opaque_softc *scn, uint16_t svc_id,
 			int *dl_is_polled);
 uint16_t
 hif_get_free_queue_number(struct hif_opaque_softc *scn, uint8_t PipeID);
+#if defined(HIF_PCI) || defined(SNOC) || defined(HIF_AHB)
+QDF_STATUS hif_rx_nbuf_pool_enable(struct hif_opaque_softc *scn,
+				   uint8_t pipe_id, uint32_t pool_size);
+void hif_rx_nbuf_recycle(struct hif_opaque_softc *scn, uint8_t pipe_id,
+			 qdf_nbuf_t nbuf);
+void hif_rx_nbuf_release(struct hif_opaque_softc *scn, uint8_t pipe_id,
+			 qdf_nbuf_t nbuf);
+#else
+static inline QDF_STATUS
+hif_rx_nbuf_pool_enable(struct hif_opaque_softc *scn, uint8_t pipe_id,
+			uint32_t pool_size)
+{
+	return QDF_STATUS_E_NOSUPPORT;
+}
+
+static inline void hif_rx_nbuf_recycle(struct hif_opaque_softc *scn,
+				       uint8_t pipe_id, qdf_nbuf_t nbuf)
+{
+	qdf_nbuf_free(nbuf);
+}
+
+static inline void hif_rx_nbuf_release(struct hif_opaque_softc *scn,
+				       uint8_t pipe_id, qdf_nbuf_t nbuf)
+{
+}
+#endif
 void *hif_get_targetdef(struct hif_opaque_softc *scn);
 uint32_t hif_hia_item_address(uint32_t target_type, uint32_t item_offset);
 void hif_set_target_sleep(struct hif_opaque_softc *scn, bool sleep_ok,
@@ -610,6 +660,8 @@ int hif_send_single(struct hif_opaque_softc *osc, qdf_nbuf_t msdu, uint32_t
 		transfer_id, u_int32_t len);
 int hif_send_fast(struct hif_opaque_softc *osc, qdf_nbuf_t nbuf,
 	uint32_t transfer_id, uint32_t download_len);
+int hif_send_fast_burst(struct hif_opaque_softc *osc, qdf_nbuf_t *msdus,
+	uint32_t num_msdus, uint32_t transfer_id, uint32_t download_len);
 void hif_pkt_dl_len_set(void *hif_sc, unsigned int pkt_download_len);
 void hif_ce_war_disable(void);
 void hif_ce_war_enable(void);
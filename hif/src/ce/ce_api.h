@@ -153,6 +153,15 @@ int ce_send(struct CE_handle *copyeng,
 int ce_send_fast(struct CE_handle *copyeng, qdf_nbuf_t msdu,
 	unsigned int transfer_id, uint32_t download_len);
 
+/*
+ * Post an array of msdus with a single source ring write index update.
+ * Returns the number of msdus posted; msdus[ret..num_msdus - 1] were not
+ * sent and remain owned by the caller.
+ */
+int ce_send_fast_burst(struct CE_handle *copyeng, qdf_nbuf_t *msdus,
+	unsigned int num_msdus, unsigned int transfer_id,
+	uint32_t download_len);
+
 #endif
 
 void ce_update_tx_ring(struct CE_handle *ce_tx_hdl, uint32_t num_htt_cmpls);
@@ -224,6 +233,22 @@ int ce_recv_buf_enqueue(struct CE_handle *copyeng,
 			void *per_transfer_recv_context,
 			qdf_dma_addr_t buffer);
 
+/*
+ * Make several buffers available to receive at once. The buffers are
+ * pushed to the Dest ring under a single lock hold and the Dest ring write
+ * index is updated once.
+ *   copyeng                    - which copy engine to use
+ *   per_transfer_recv_context  - array of contexts passed back to recv_cb
+ *   buffer                     - array of buffer addresses in CE space
+ *   num_bufs                   - number of entries in both arrays
+ * Returns the number of buffers enqueued; buffers past that index were
+ * not posted and remain owned by the caller.
+ */
+unsigned int ce_recv_buf_enqueue_multiple(struct CE_handle *copyeng,
+			void **per_transfer_recv_context,
+			qdf_dma_addr_t *buffer,
+			unsigned int num_bufs);
+
 /*
  * Register a Receive Callback function.
  * This function is called as soon as data is received
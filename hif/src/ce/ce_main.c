@@ -47,6 +47,8 @@
 #ifndef CONFIG_WIN
 #include "qwlan_version.h"
 #endif
+#include <linux/hash.h>
+#include <linux/log2.h>
 
 #define CE_POLL_TIMEOUT 10      /* ms */
 
@@ -1277,6 +1279,81 @@ hif_send_head(struct hif_opaque_softc *hif_ctx,
 	return status;
 }
 
+/**
+ * hif_get_max_gather_frags() - max fragments accepted by hif_send_gather
+ * @hif_ctx: hif context
+ * @pipe: pipe the gathered transfer will be sent on
+ *
+ * Return: number of fragments one copy engine sendlist can carry
+ */
+uint32_t hif_get_max_gather_frags(struct hif_opaque_softc *hif_ctx,
+				  uint8_t pipe)
+{
+	return CE_SENDLIST_ITEMS_MAX;
+}
+
+/**
+ * hif_send_gather() - send a transfer gathered from several buffers
+ * @hif_ctx: hif context
+ * @pipe: pipe to send on
+ * @transfer_id: transfer id reported back with the completion
+ * @nbytes: total length of all fragments
+ * @frags: fragments, already mapped for DMA
+ * @nfrags: number of fragments
+ * @ctx_buf: nbuf handed back to the tx completion handler
+ *
+ * Each fragment becomes one source ring entry of a single copy engine
+ * sendlist, so the target sees one contiguous download while the host
+ * copies nothing. Only @ctx_buf is indicated on completion.
+ *
+ * Return: QDF_STATUS_SUCCESS on success or an error status
+ */
+QDF_STATUS hif_send_gather(struct hif_opaque_softc *hif_ctx, uint8_t pipe,
+			   uint32_t transfer_id, uint32_t nbytes,
+			   struct hif_gather_frag *frags, uint32_t nfrags,
+			   qdf_nbuf_t ctx_buf)
+{
+	struct HIF_CE_state *hif_state = HIF_GET_CE_STATE(hif_ctx);
+	struct HIF_CE_pipe_info *pipe_info = &(hif_state->pipe_info[pipe]);
+	struct CE_handle *ce_hdl = pipe_info->ce_hdl;
+	struct ce_sendlist sendlist;
+	uint32_t i;
+	int status;
+
+	if (qdf_unlikely(ce_hdl == NULL)) {
+		HIF_ERROR("%s: error CE handle is null", __func__);
+		return QDF_STATUS_E_INVAL;
+	}
+
+	if (nfrags == 0 || nfrags > CE_SENDLIST_ITEMS_MAX)
+		return QDF_STATUS_E_NOSUPPORT;
+
+	transfer_id &= TRANSACTION_ID_MASK;
+
+	ce_sendlist_init(&sendlist);
+	for (i = 0; i < nfrags; i++) {
+		status = ce_sendlist_buf_add(&sendlist, frags[i].paddr,
+					     frags[i].len,
+					     CE_SEND_FLAG_SWAP_DISABLE, 0);
+		if (status != QDF_STATUS_SUCCESS)
+			return status;
+	}
+
+	qdf_spin_lock_bh(&pipe_info->completion_freeq_lock);
+	if (pipe_info->num_sends_allowed < nfrags) {
+		qdf_spin_unlock_bh(&pipe_info->completion_freeq_lock);
+		ce_pkt_error_count_incr(hif_state, HIF_PIPE_NO_RESOURCE);
+		return QDF_STATUS_E_RESOURCES;
+	}
+	pipe_info->num_sends_allowed -= nfrags;
+	qdf_spin_unlock_bh(&pipe_info->completion_freeq_lock);
+
+	status = ce_sendlist_send(ce_hdl, ctx_buf, &sendlist, transfer_id);
+	QDF_ASSERT(status == QDF_STATUS_SUCCESS);
+
+	return status;
+}
+
 void hif_send_complete_check(struct hif_opaque_softc *hif_ctx, uint8_t pipe,
 								int force)
 {
@@ -1361,26 +1438,64 @@ hif_pci_ce_send_done(struct CE_handle *copyeng, void *ce_context,
 			&toeplitz_hash_result) == QDF_STATUS_SUCCESS);
 }
 
+/* max rx completions handed to the upper layer in one call */
+#define HIF_CE_RX_BATCH_MAX 32
+
+/**
+ * hif_ce_flush_recv(): hand the batched messages to upper layers
+ * @msg_callbacks: structure containing callback and callback context
+ * @netbufs: messages reaped from the copy engine
+ * @count: number of messages in @netbufs, reset to 0
+ * @pipe_info: used for the pipe_number info
+ *
+ * return: None
+ */
+static void hif_ce_flush_recv(struct hif_msg_callbacks *msg_callbacks,
+			      qdf_nbuf_t *netbufs, int *count,
+			      struct HIF_CE_pipe_info *pipe_info)
+{
+	int i;
+
+	if (!*count)
+		return;
+
+	if (msg_callbacks->rxCompletionHandlerMultiple)
+		msg_callbacks->rxCompletionHandlerMultiple(
+				msg_callbacks->Context, netbufs, *count,
+				pipe_info->pipe_num);
+	else
+		for (i = 0; i < *count; i++)
+			msg_callbacks->rxCompletionHandler(
+					msg_callbacks->Context, netbufs[i],
+					pipe_info->pipe_num);
+	*count = 0;
+}
+
 /**
  * hif_ce_do_recv(): send message from copy engine to upper layers
  * @msg_callbacks: structure containing callback and callback context
  * @netbuff: skb containing message
  * @nbytes: number of bytes in the message
  * @pipe_info: used for the pipe_number info
+ * @netbufs: batch of messages not yet handed to upper layers
+ * @count: number of messages in @netbufs
  *
  * Checks the packet length, configures the lenght in the netbuff,
- * and calls the upper layer callback.
+ * and adds it to the batch, which is flushed to the upper layer
+ * callback once full.
  *
  * return: None
  */
 static inline void hif_ce_do_recv(struct hif_msg_callbacks *msg_callbacks,
 		qdf_nbuf_t netbuf, int nbytes,
-		struct HIF_CE_pipe_info *pipe_info) {
+		struct HIF_CE_pipe_info *pipe_info,
+		qdf_nbuf_t *netbufs, int *count) {
 	if (nbytes <= pipe_info->buf_sz) {
 		qdf_nbuf_set_pktlen(netbuf, nbytes);
-		msg_callbacks->
-			rxCompletionHandler(msg_callbacks->Context,
-					netbuf, pipe_info->pipe_num);
+		netbufs[(*count)++] = netbuf;
+		if (*count == HIF_CE_RX_BATCH_MAX)
+			hif_ce_flush_recv(msg_callbacks, netbufs, count,
+					  pipe_info);
 	} else {
 		HIF_ERROR("%s: Invalid Rx msg buf:%p nbytes:%d",
 				__func__, netbuf, nbytes);
@@ -1388,6 +1503,9 @@ static inline void hif_ce_do_recv(struct hif_msg_callbacks *msg_callbacks,
 	}
 }
 
+static bool hif_rx_pool_track(struct HIF_CE_pipe_info *pipe_info,
+			      qdf_nbuf_t nbuf, qdf_dma_addr_t paddr);
+
 /* Called by lower (CE) layer when data is received from the Target. */
 void
 hif_pci_ce_recv_data(struct CE_handle *copyeng, void *ce_context,
@@ -1405,14 +1523,24 @@ hif_pci_ce_recv_data(struct CE_handle *copyeng, void *ce_context,
 #endif
 	struct hif_msg_callbacks *msg_callbacks =
 		&hif_state->msg_callbacks_current;
+	qdf_nbuf_t netbufs[HIF_CE_RX_BATCH_MAX];
+	int count = 0;
 
 	do {
 #ifdef HIF_PCI
 		hif_pm_runtime_mark_last_busy(hif_pci_sc->dev);
 #endif
-		qdf_nbuf_unmap_single(scn->qdf_dev,
-				      (qdf_nbuf_t) transfer_context,
-				      QDF_DMA_FROM_DEVICE);
+		if (pipe_info->rx_pool_max && nbytes <= pipe_info->buf_sz &&
+		    scn->target_status != TARGET_STATUS_RESET &&
+		    hif_rx_pool_track(pipe_info, transfer_context, CE_data))
+			/* keep the mapping, see hif_rx_nbuf_recycle */
+			qdf_mem_dma_sync_single_for_cpu(scn->qdf_dev, CE_data,
+							pipe_info->buf_sz,
+							DMA_FROM_DEVICE);
+		else
+			qdf_nbuf_unmap_single(scn->qdf_dev,
+					      (qdf_nbuf_t) transfer_context,
+					      QDF_DMA_FROM_DEVICE);
 
 		atomic_inc(&pipe_info->recv_bufs_needed);
 		hif_post_recv_buffers_for_pipe(pipe_info);
@@ -1420,7 +1548,7 @@ hif_pci_ce_recv_data(struct CE_handle *copyeng, void *ce_context,
 			qdf_nbuf_free(transfer_context);
 		else
 			hif_ce_do_recv(msg_callbacks, transfer_context,
-				nbytes, pipe_info);
+				nbytes, pipe_info, netbufs, &count);
 
 		/* Set up force_break flag if num of receices reaches
 		 * MAX_NUM_OF_RECEIVES */
@@ -1433,6 +1561,7 @@ hif_pci_ce_recv_data(struct CE_handle *copyeng, void *ce_context,
 					&CE_data, &nbytes, &transfer_id,
 					&flags) == QDF_STATUS_SUCCESS);
 
+	hif_ce_flush_recv(msg_callbacks, netbufs, &count, pipe_info);
 }
 
 /* TBDXXX: Set CE High Watermark; invoke txResourceAvailHandler in response */
@@ -1566,16 +1695,410 @@ void hif_dump_pipe_debug_count(struct hif_softc *scn)
 			pipe_info->nbuf_alloc_err_count,
 			pipe_info->nbuf_dma_err_count,
 			pipe_info->nbuf_ce_enqueue_err_count);
+
+	if (pipe_info->rx_pool_max)
+		HIF_ERROR(
+			"%s: pipe_id = %d, rx_pool_len = %u, rx_pool_hit_count = %u, rx_pool_miss_count = %u",
+			__func__, pipe_info->pipe_num,
+			qdf_nbuf_queue_len(&pipe_info->rx_pool),
+			pipe_info->rx_pool_hit_count,
+			pipe_info->rx_pool_miss_count);
+	}
+}
+
+/**
+ * hif_rx_pool_get() - take a mapped receive buffer from the recycling pool
+ * @pipe_info: pipe whose pool is used
+ *
+ * Return: mapped nbuf, or NULL if the pool is disabled or empty
+ */
+static qdf_nbuf_t hif_rx_pool_get(struct HIF_CE_pipe_info *pipe_info)
+{
+	qdf_nbuf_t nbuf;
+
+	if (!pipe_info->rx_pool_max)
+		return NULL;
+
+	qdf_spin_lock_bh(&pipe_info->rx_pool_lock);
+	nbuf = qdf_nbuf_queue_remove(&pipe_info->rx_pool);
+	if (nbuf)
+		pipe_info->rx_pool_hit_count++;
+	else
+		pipe_info->rx_pool_miss_count++;
+	qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+
+	return nbuf;
+}
+
+/**
+ * hif_rx_pool_track() - remember the mapping of a buffer sent upstream
+ * @pipe_info: pipe the buffer was received on
+ * @nbuf: received buffer, its data pointer still where it was mapped
+ * @paddr: DMA address the buffer was posted with
+ *
+ * The upper layer may pull, push or reuse the control block of the
+ * buffer, so the mapping is kept here until hif_rx_nbuf_recycle().
+ *
+ * Return: true if tracked and the mapping may be kept, false if the
+ *	table is full and the buffer has to be unmapped now
+ */
+static bool hif_rx_pool_track(struct HIF_CE_pipe_info *pipe_info,
+			      qdf_nbuf_t nbuf, qdf_dma_addr_t paddr)
+{
+	uint32_t mask = (1 << pipe_info->rx_pool_ents_bits) - 1;
+	struct hif_rx_pool_ent *ent;
+	uint32_t i;
+
+	qdf_spin_lock_bh(&pipe_info->rx_pool_lock);
+	/* keep the table at most half full so probes stay short */
+	if (!pipe_info->rx_pool_ents ||
+	    pipe_info->rx_pool_ents_cnt >= (mask + 1) / 2) {
+		qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+		return false;
+	}
+
+	/*
+	 * an entry for @nbuf is left behind if an earlier buffer at this
+	 * address was freed without going through hif_rx_nbuf_recycle();
+	 * its mapping is lost, but the entry must describe the new one
+	 */
+	i = hash_ptr(nbuf, pipe_info->rx_pool_ents_bits);
+	while (pipe_info->rx_pool_ents[i].nbuf &&
+	       pipe_info->rx_pool_ents[i].nbuf != nbuf)
+		i = (i + 1) & mask;
+
+	ent = &pipe_info->rx_pool_ents[i];
+	if (!ent->nbuf)
+		pipe_info->rx_pool_ents_cnt++;
+	ent->nbuf = nbuf;
+	ent->paddr = paddr;
+	ent->data_off = qdf_nbuf_headroom(nbuf);
+	ent->map_len = qdf_nbuf_len(nbuf) + qdf_nbuf_tailroom(nbuf);
+	qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+
+	return true;
+}
+
+/**
+ * hif_rx_pool_untrack() - take the remembered mapping of a buffer
+ * @pipe_info: pipe the buffer was received on
+ * @nbuf: buffer handed back by the upper layer
+ * @out: filled with the mapping of @nbuf
+ *
+ * Return: true if @nbuf was tracked, false if it was not kept mapped
+ */
+static bool hif_rx_pool_untrack(struct HIF_CE_pipe_info *pipe_info,
+				qdf_nbuf_t nbuf, struct hif_rx_pool_ent *out)
+{
+	uint32_t mask = (1 << pipe_info->rx_pool_ents_bits) - 1;
+	struct hif_rx_pool_ent *ents = pipe_info->rx_pool_ents;
+	uint32_t i, j, k;
+
+	qdf_spin_lock_bh(&pipe_info->rx_pool_lock);
+	if (!ents) {
+		qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+		return false;
+	}
+
+	i = hash_ptr(nbuf, pipe_info->rx_pool_ents_bits);
+	while (ents[i].nbuf && ents[i].nbuf != nbuf)
+		i = (i + 1) & mask;
+	if (!ents[i].nbuf) {
+		qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+		return false;
+	}
+	*out = ents[i];
+	pipe_info->rx_pool_ents_cnt--;
+
+	/* close the gap so that later entries of the probe chain are found */
+	for (;;) {
+		ents[i].nbuf = NULL;
+		j = i;
+		for (;;) {
+			j = (j + 1) & mask;
+			if (!ents[j].nbuf)
+				goto done;
+			k = hash_ptr(ents[j].nbuf, pipe_info->rx_pool_ents_bits);
+			/* move the entry unless its home lies in (i, j] */
+			if (i <= j ? (k <= i || k > j) : (k <= i && k > j))
+				break;
+		}
+		ents[i] = ents[j];
+		i = j;
+	}
+done:
+	qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+
+	return true;
+}
+
+/**
+ * hif_rx_pool_deinit() - disable recycling and free the mapping table
+ * @scn: HIF context
+ * @pipe_info: pipe whose copy engine is being torn down
+ *
+ * Buffers still held by the upper layer are unmapped here by address,
+ * without touching the nbufs, so that hif_rx_nbuf_recycle() only has to
+ * free them when they come back.
+ *
+ * Return: None
+ */
+static void hif_rx_pool_deinit(struct hif_softc *scn,
+			       struct HIF_CE_pipe_info *pipe_info)
+{
+	struct hif_rx_pool_ent *ents;
+	uint32_t i;
+
+	qdf_spin_lock_bh(&pipe_info->rx_pool_lock);
+	pipe_info->rx_pool_max = 0;
+	ents = pipe_info->rx_pool_ents;
+	if (ents) {
+		for (i = 0; i < (1 << pipe_info->rx_pool_ents_bits); i++) {
+			if (!ents[i].nbuf)
+				continue;
+			qdf_mem_unmap_nbytes_single(scn->qdf_dev, ents[i].paddr,
+						    QDF_DMA_FROM_DEVICE,
+						    ents[i].map_len);
+		}
+		pipe_info->rx_pool_ents = NULL;
+		pipe_info->rx_pool_ents_cnt = 0;
+	}
+	qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+
+	if (ents)
+		qdf_mem_free(ents);
+}
+
+/**
+ * hif_rx_pool_flush() - unmap and free all buffers of the recycling pool
+ * @pipe_info: pipe whose pool is flushed
+ *
+ * Return: None
+ */
+static void hif_rx_pool_flush(struct HIF_CE_pipe_info *pipe_info)
+{
+	struct hif_softc *scn = HIF_GET_SOFTC(pipe_info->HIF_CE_state);
+	qdf_nbuf_t nbuf;
+
+	qdf_spin_lock_bh(&pipe_info->rx_pool_lock);
+	while ((nbuf = qdf_nbuf_queue_remove(&pipe_info->rx_pool))) {
+		qdf_nbuf_unmap_single(scn->qdf_dev, nbuf, QDF_DMA_FROM_DEVICE);
+		qdf_nbuf_free(nbuf);
 	}
+	qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+}
+
+/**
+ * hif_rx_nbuf_pool_enable() - enable rx buffer recycling on a pipe
+ * @hif_ctx: HIF context
+ * @pipe_id: pipe to enable recycling on
+ * @pool_size: max number of mapped buffers kept in the pool
+ *
+ * Once enabled, receive buffers delivered on @pipe_id are normally not
+ * unmapped by HIF. The upper layer must hand every buffer received on
+ * the pipe back through hif_rx_nbuf_recycle() instead of freeing it.
+ * HIF remembers the DMA address and data offset each buffer was mapped
+ * with, so the upper layer may pull, push and reuse the control block.
+ *
+ * Return: QDF_STATUS_SUCCESS if recycling is enabled
+ */
+QDF_STATUS hif_rx_nbuf_pool_enable(struct hif_opaque_softc *hif_ctx,
+				   uint8_t pipe_id, uint32_t pool_size)
+{
+	struct hif_softc *scn = HIF_GET_SOFTC(hif_ctx);
+	struct HIF_CE_state *hif_state = HIF_GET_CE_STATE(hif_ctx);
+	struct HIF_CE_pipe_info *pipe_info;
+	struct CE_state *ce_state;
+
+	if (pipe_id >= scn->ce_count)
+		return QDF_STATUS_E_INVAL;
+
+	pipe_info = &hif_state->pipe_info[pipe_id];
+	ce_state = scn->ce_id_to_state[pipe_id];
+
+	/* fastpath rx buffers are owned and unmapped by the upper layer */
+	if (!pipe_info->buf_sz || !ce_state || !ce_state->dest_ring ||
+	    (scn->fastpath_mode_on && ce_state->htt_rx_data))
+		return QDF_STATUS_E_NOSUPPORT;
+
+	if (pipe_info->rx_pool_max)
+		return QDF_STATUS_E_ALREADY;
+
+	/* room for every posted buffer and the pool, at most half full */
+	pipe_info->rx_pool_ents_bits =
+		ilog2(roundup_pow_of_two(2 * (ce_state->dest_ring->nentries +
+					      pool_size)));
+	pipe_info->rx_pool_ents = qdf_mem_malloc(
+			sizeof(struct hif_rx_pool_ent) <<
+			pipe_info->rx_pool_ents_bits);
+	if (!pipe_info->rx_pool_ents)
+		return QDF_STATUS_E_NOMEM;
+	pipe_info->rx_pool_ents_cnt = 0;
+
+	pipe_info->rx_pool_max = pool_size;
+	HIF_INFO("%s: pipe %d rx nbuf pool size %u", __func__, pipe_id,
+		 pool_size);
+
+	return QDF_STATUS_SUCCESS;
+}
+
+/**
+ * hif_rx_nbuf_recycle() - return a received buffer to its pipe
+ * @hif_ctx: HIF context
+ * @pipe_id: pipe the buffer was received on
+ * @nbuf: buffer delivered by rxCompletionHandler
+ *
+ * The buffer is reset and kept mapped in the pipe's pool for the next
+ * replenish. It is unmapped and freed if the pool is full or the buffer
+ * cannot be reused.
+ *
+ * Return: None
+ */
+void hif_rx_nbuf_recycle(struct hif_opaque_softc *hif_ctx, uint8_t pipe_id,
+			 qdf_nbuf_t nbuf)
+{
+	struct hif_softc *scn = HIF_GET_SOFTC(hif_ctx);
+	struct HIF_CE_state *hif_state = HIF_GET_CE_STATE(hif_ctx);
+	struct HIF_CE_pipe_info *pipe_info;
+	struct hif_rx_pool_ent ent;
+
+	if (pipe_id >= CE_COUNT_MAX) {
+		HIF_ERROR("%s: invalid pipe %d", __func__, pipe_id);
+		qdf_nbuf_free(nbuf);
+		return;
+	}
+	pipe_info = &hif_state->pipe_info[pipe_id];
+
+	/* not kept mapped, it was unmapped on completion */
+	if (!pipe_info->rx_pool_max ||
+	    !hif_rx_pool_untrack(pipe_info, nbuf, &ent)) {
+		qdf_nbuf_free(nbuf);
+		return;
+	}
+
+	if (qdf_nbuf_is_cloned(nbuf) ||
+	    qdf_nbuf_queue_len(&pipe_info->rx_pool) >=
+	    pipe_info->rx_pool_max)
+		goto release;
+
+	/* restore the data pointer and DMA address of the mapping */
+	qdf_nbuf_init(nbuf);
+	qdf_nbuf_reserve(nbuf, ent.data_off - qdf_nbuf_headroom(nbuf));
+	qdf_nbuf_set_pktlen(nbuf, 0);
+	qdf_nbuf_set_next(nbuf, NULL);
+	qdf_nbuf_mapped_paddr_set(nbuf, ent.paddr);
+
+	qdf_spin_lock_bh(&pipe_info->rx_pool_lock);
+	if (qdf_nbuf_queue_len(&pipe_info->rx_pool) < pipe_info->rx_pool_max) {
+		qdf_nbuf_queue_add(&pipe_info->rx_pool, nbuf);
+		nbuf = NULL;
+	}
+	qdf_spin_unlock_bh(&pipe_info->rx_pool_lock);
+
+	if (!nbuf)
+		return;
+
+release:
+	/* the data pointer may have moved, unmap with the original mapping */
+	qdf_nbuf_mapped_paddr_set(nbuf, ent.paddr);
+	qdf_nbuf_unmap_nbytes_single(scn->qdf_dev, nbuf, QDF_DMA_FROM_DEVICE,
+				     ent.map_len);
+	qdf_nbuf_free(nbuf);
+}
+
+/**
+ * hif_rx_nbuf_release() - take a received buffer out of recycling
+ * @hif_ctx: HIF context
+ * @pipe_id: pipe the buffer was received on
+ * @nbuf: buffer delivered by rxCompletionHandler
+ *
+ * For buffers handed on to code that frees them with qdf_nbuf_free():
+ * the mapping kept for recycling is dropped now. Buffers that were not
+ * kept mapped are left alone.
+ *
+ * Return: None
+ */
+void hif_rx_nbuf_release(struct hif_opaque_softc *hif_ctx, uint8_t pipe_id,
+			 qdf_nbuf_t nbuf)
+{
+	struct hif_softc *scn = HIF_GET_SOFTC(hif_ctx);
+	struct HIF_CE_state *hif_state = HIF_GET_CE_STATE(hif_ctx);
+	struct HIF_CE_pipe_info *pipe_info;
+	struct hif_rx_pool_ent ent;
+
+	if (pipe_id >= CE_COUNT_MAX)
+		return;
+	pipe_info = &hif_state->pipe_info[pipe_id];
+
+	if (!pipe_info->rx_pool_max ||
+	    !hif_rx_pool_untrack(pipe_info, nbuf, &ent))
+		return;
+
+	qdf_nbuf_mapped_paddr_set(nbuf, ent.paddr);
+	qdf_nbuf_unmap_nbytes_single(scn->qdf_dev, nbuf, QDF_DMA_FROM_DEVICE,
+				     ent.map_len);
+}
+
+/* max number of receive buffers allocated and posted per ring update */
+#define HIF_RX_POST_BATCH_MAX 16
+
+/**
+ * hif_post_recv_buffers_batch() - post a batch of mapped nbufs to a pipe
+ * @pipe_info: pipe the buffers are posted to
+ * @nbufs: array of mapped nbufs
+ * @paddrs: DMA addresses of @nbufs
+ * @num: number of buffers in the batch
+ *
+ * Buffers the copy engine could not accept are unmapped, freed and given
+ * back to recv_bufs_needed.
+ *
+ * Return: number of buffers posted
+ */
+static uint32_t hif_post_recv_buffers_batch(struct HIF_CE_pipe_info *pipe_info,
+					    qdf_nbuf_t *nbufs,
+					    qdf_dma_addr_t *paddrs,
+					    uint32_t num)
+{
+	struct hif_softc *scn = HIF_GET_SOFTC(pipe_info->HIF_CE_state);
+	uint32_t posted;
+	uint32_t i;
+
+	if (num == 0)
+		return 0;
+
+	posted = ce_recv_buf_enqueue_multiple(pipe_info->ce_hdl,
+					      (void **)nbufs, paddrs, num);
+	QDF_ASSERT(posted == num);
+	if (posted == num)
+		return posted;
+
+	qdf_spin_lock_bh(&pipe_info->recv_bufs_needed_lock);
+	pipe_info->nbuf_ce_enqueue_err_count += num - posted;
+	qdf_spin_unlock_bh(&pipe_info->recv_bufs_needed_lock);
+	HIF_ERROR(
+		"%s buf alloc error [%d] needed %d, nbuf_ce_enqueue_err_count = %u",
+		__func__, pipe_info->pipe_num,
+		atomic_read(&pipe_info->recv_bufs_needed),
+		pipe_info->nbuf_ce_enqueue_err_count);
+
+	for (i = posted; i < num; i++) {
+		qdf_nbuf_unmap_single(scn->qdf_dev, nbufs[i],
+				      QDF_DMA_FROM_DEVICE);
+		qdf_nbuf_free(nbufs[i]);
+		atomic_inc(&pipe_info->recv_bufs_needed);
+	}
+
+	return posted;
 }
 
 static int hif_post_recv_buffers_for_pipe(struct HIF_CE_pipe_info *pipe_info)
 {
-	struct CE_handle *ce_hdl;
 	qdf_size_t buf_sz;
 	struct hif_softc *scn = HIF_GET_SOFTC(pipe_info->HIF_CE_state);
 	QDF_STATUS ret;
 	uint32_t bufs_posted = 0;
+	qdf_nbuf_t nbufs[HIF_RX_POST_BATCH_MAX];
+	qdf_dma_addr_t paddrs[HIF_RX_POST_BATCH_MAX];
 
 	buf_sz = pipe_info->buf_sz;
 	if (buf_sz == 0) {
@@ -1583,77 +2106,91 @@ static int hif_post_recv_buffers_for_pipe(struct HIF_CE_pipe_info *pipe_info)
 		return 0;
 	}
 
-	ce_hdl = pipe_info->ce_hdl;
-
 	qdf_spin_lock_bh(&pipe_info->recv_bufs_needed_lock);
 	while (atomic_read(&pipe_info->recv_bufs_needed) > 0) {
-		qdf_dma_addr_t CE_data;      /* CE space buffer address */
-		qdf_nbuf_t nbuf;
-		int status;
+		uint32_t batch_sz, num, posted;
 
-		atomic_dec(&pipe_info->recv_bufs_needed);
+		/* claim a batch of buffers to replenish */
+		batch_sz = QDF_MIN(atomic_read(&pipe_info->recv_bufs_needed),
+				   HIF_RX_POST_BATCH_MAX);
+		atomic_sub(batch_sz, &pipe_info->recv_bufs_needed);
 		qdf_spin_unlock_bh(&pipe_info->recv_bufs_needed_lock);
 
-		nbuf = qdf_nbuf_alloc(scn->qdf_dev, buf_sz, 0, 4, false);
-		if (!nbuf) {
-			qdf_spin_lock_bh(&pipe_info->recv_bufs_needed_lock);
-			pipe_info->nbuf_alloc_err_count++;
-			qdf_spin_unlock_bh(
-				&pipe_info->recv_bufs_needed_lock);
-			HIF_ERROR(
-				"%s buf alloc error [%d] needed %d, nbuf_alloc_err_count = %u",
-				 __func__, pipe_info->pipe_num,
-				 atomic_read(&pipe_info->recv_bufs_needed),
-				pipe_info->nbuf_alloc_err_count);
-			atomic_inc(&pipe_info->recv_bufs_needed);
-			return 1;
-		}
+		for (num = 0; num < batch_sz; num++) {
+			qdf_nbuf_t nbuf;
+
+			nbuf = hif_rx_pool_get(pipe_info);
+			if (nbuf) {
+				nbufs[num] = nbuf;
+				paddrs[num] = qdf_nbuf_mapped_paddr_get(nbuf);
+				qdf_mem_dma_sync_single_for_device(
+					scn->qdf_dev, paddrs[num], buf_sz,
+					DMA_FROM_DEVICE);
+				continue;
+			}
 
-		/*
-		 * qdf_nbuf_peek_header(nbuf, &data, &unused);
-		 * CE_data = dma_map_single(dev, data, buf_sz, );
-		 * DMA_FROM_DEVICE);
-		 */
-		ret =
-			qdf_nbuf_map_single(scn->qdf_dev, nbuf,
-					    QDF_DMA_FROM_DEVICE);
+			nbuf = qdf_nbuf_alloc(scn->qdf_dev, buf_sz, 0, 4,
+					      false);
+			if (!nbuf) {
+				qdf_spin_lock_bh(
+					&pipe_info->recv_bufs_needed_lock);
+				pipe_info->nbuf_alloc_err_count++;
+				qdf_spin_unlock_bh(
+					&pipe_info->recv_bufs_needed_lock);
+				HIF_ERROR(
+					"%s buf alloc error [%d] needed %d, nbuf_alloc_err_count = %u",
+					 __func__, pipe_info->pipe_num,
+					 atomic_read(
+						&pipe_info->recv_bufs_needed),
+					pipe_info->nbuf_alloc_err_count);
+				break;
+			}
 
-		if (unlikely(ret != QDF_STATUS_SUCCESS)) {
-			qdf_spin_lock_bh(&pipe_info->recv_bufs_needed_lock);
-			pipe_info->nbuf_dma_err_count++;
-			qdf_spin_unlock_bh(&pipe_info->recv_bufs_needed_lock);
-			HIF_ERROR(
-				"%s buf alloc error [%d] needed %d, nbuf_dma_err_count = %u",
-				 __func__, pipe_info->pipe_num,
-				 atomic_read(&pipe_info->recv_bufs_needed),
-				pipe_info->nbuf_dma_err_count);
-			qdf_nbuf_free(nbuf);
-			atomic_inc(&pipe_info->recv_bufs_needed);
-			return 1;
+			/*
+			 * qdf_nbuf_peek_header(nbuf, &data, &unused);
+			 * CE_data = dma_map_single(dev, data, buf_sz, );
+			 * DMA_FROM_DEVICE);
+			 */
+			ret = qdf_nbuf_map_single(scn->qdf_dev, nbuf,
+						  QDF_DMA_FROM_DEVICE);
+
+			if (unlikely(ret != QDF_STATUS_SUCCESS)) {
+				qdf_spin_lock_bh(
+					&pipe_info->recv_bufs_needed_lock);
+				pipe_info->nbuf_dma_err_count++;
+				qdf_spin_unlock_bh(
+					&pipe_info->recv_bufs_needed_lock);
+				HIF_ERROR(
+					"%s buf alloc error [%d] needed %d, nbuf_dma_err_count = %u",
+					 __func__, pipe_info->pipe_num,
+					 atomic_read(
+						&pipe_info->recv_bufs_needed),
+					pipe_info->nbuf_dma_err_count);
+				qdf_nbuf_free(nbuf);
+				break;
+			}
+
+			nbufs[num] = nbuf;
+			paddrs[num] = qdf_nbuf_get_frag_paddr(nbuf, 0);
+
+			qdf_mem_dma_sync_single_for_device(scn->qdf_dev,
+							   paddrs[num], buf_sz,
+							   DMA_FROM_DEVICE);
 		}
 
-		CE_data = qdf_nbuf_get_frag_paddr(nbuf, 0);
+		posted = hif_post_recv_buffers_batch(pipe_info, nbufs,
+						     paddrs, num);
 
-		qdf_mem_dma_sync_single_for_device(scn->qdf_dev, CE_data,
-					       buf_sz, DMA_FROM_DEVICE);
-		status = ce_recv_buf_enqueue(ce_hdl, (void *)nbuf, CE_data);
-		QDF_ASSERT(status == QDF_STATUS_SUCCESS);
-		if (status != EOK) {
-			qdf_spin_lock_bh(&pipe_info->recv_bufs_needed_lock);
-			pipe_info->nbuf_ce_enqueue_err_count++;
+		qdf_spin_lock_bh(&pipe_info->recv_bufs_needed_lock);
+		bufs_posted += posted;
+
+		if (num < batch_sz || posted < num) {
+			/* return the unallocated part of the batch */
+			atomic_add(batch_sz - num,
+				   &pipe_info->recv_bufs_needed);
 			qdf_spin_unlock_bh(&pipe_info->recv_bufs_needed_lock);
-			HIF_ERROR(
-				"%s buf alloc error [%d] needed %d, nbuf_alloc_err_count = %u",
-				__func__, pipe_info->pipe_num,
-				atomic_read(&pipe_info->recv_bufs_needed),
-				pipe_info->nbuf_ce_enqueue_err_count);
-			atomic_inc(&pipe_info->recv_bufs_needed);
-			qdf_nbuf_free(nbuf);
 			return 1;
 		}
-
-		qdf_spin_lock_bh(&pipe_info->recv_bufs_needed_lock);
-		bufs_posted++;
 	}
 	pipe_info->nbuf_alloc_err_count =
 		(pipe_info->nbuf_alloc_err_count > bufs_posted) ?
@@ -1759,6 +2296,8 @@ void hif_recv_buffer_cleanup_on_pipe(struct HIF_CE_pipe_info *pipe_info)
 				      QDF_DMA_FROM_DEVICE);
 		qdf_nbuf_free(netbuf);
 	}
+
+	hif_rx_pool_flush(pipe_info);
 }
 
 void hif_send_buffer_cleanup_on_pipe(struct HIF_CE_pipe_info *pipe_info)
@@ -1881,6 +2420,7 @@ void hif_ce_stop(struct hif_softc *scn)
 			ce_fini(pipe_info->ce_hdl);
 			pipe_info->ce_hdl = NULL;
 			pipe_info->buf_sz = 0;
+			hif_rx_pool_deinit(scn, pipe_info);
 		}
 	}
 
@@ -2070,6 +2610,7 @@ void hif_unconfig_ce(struct hif_softc *hif_sc)
 			ce_fini(pipe_info->ce_hdl);
 			pipe_info->ce_hdl = NULL;
 			pipe_info->buf_sz = 0;
+			hif_rx_pool_deinit(hif_sc, pipe_info);
 		}
 	}
 	if (hif_sc->athdiag_procfs_inited) {
@@ -2171,6 +2712,8 @@ int hif_config_ce(struct hif_softc *scn)
 
 		pipe_info->buf_sz = (qdf_size_t) (attr->src_sz_max);
 		qdf_spinlock_create(&pipe_info->recv_bufs_needed_lock);
+		qdf_spinlock_create(&pipe_info->rx_pool_lock);
+		qdf_nbuf_queue_init(&pipe_info->rx_pool);
 		if (attr->dest_nentries > 0) {
 			atomic_set(&pipe_info->recv_bufs_needed,
 				   init_buffer_count(attr->dest_nentries - 1));
@@ -71,6 +71,20 @@ enum ol_ath_hif_pkt_ecodes {
 struct HIF_CE_state;
 
 /* Per-pipe state. */
+/**
+ * struct hif_rx_pool_ent - mapping of a receive buffer held by the upper layer
+ * @nbuf: the buffer, NULL for an unused entry
+ * @paddr: DMA address the buffer data was mapped at
+ * @map_len: length of the mapping
+ * @data_off: offset of the mapped data from the buffer head
+ */
+struct hif_rx_pool_ent {
+	qdf_nbuf_t nbuf;
+	qdf_dma_addr_t paddr;
+	uint32_t map_len;
+	uint32_t data_off;
+};
+
 struct HIF_CE_pipe_info {
 	/* Handle of underlying Copy Engine */
 	struct CE_handle *ce_hdl;
@@ -94,6 +108,18 @@ struct HIF_CE_pipe_info {
 	uint32_t nbuf_alloc_err_count;
 	uint32_t nbuf_dma_err_count;
 	uint32_t nbuf_ce_enqueue_err_count;
+
+	/* Pool of DMA mapped receive buffers recycled by the upper layer */
+	qdf_nbuf_queue_t rx_pool;
+	qdf_spinlock_t rx_pool_lock;
+	/* max buffers kept in rx_pool; 0 when recycling is disabled */
+	uint32_t rx_pool_max;
+	uint32_t rx_pool_hit_count;
+	uint32_t rx_pool_miss_count;
+	/* mappings of buffers delivered with the mapping kept, by nbuf */
+	struct hif_rx_pool_ent *rx_pool_ents;
+	uint32_t rx_pool_ents_bits;
+	uint32_t rx_pool_ents_cnt;
 };
 
 /**
@@ -536,6 +536,146 @@ ce_buffer_addr_hi_set(struct CE_src_desc *shadow_src_desc,
 
 #define SLOTS_PER_DATAPATH_TX 2
 
+/**
+ * ce_send_fast_desc_fill() - fill the source descriptor pair for one msdu
+ * @ce_state: copy engine state
+ * @msdu: msdu to be posted
+ * @transfer_id: transfer_id
+ * @download_len: packet download length
+ * @write_index: source ring index of the first descriptor of the pair
+ *
+ * Fills the HTC/HTT header descriptor and the payload descriptor of @msdu.
+ * The caller is expected to hold ce_index_lock, to have checked that
+ * SLOTS_PER_DATAPATH_TX entries are available and to update the h/w write
+ * index once it is done posting.
+ *
+ * Return: source ring write index following the posted descriptors
+ */
+static inline unsigned int
+ce_send_fast_desc_fill(struct CE_state *ce_state, qdf_nbuf_t msdu,
+		       unsigned int transfer_id, uint32_t download_len,
+		       unsigned int write_index)
+{
+	struct hif_softc *scn = ce_state->scn;
+	struct hif_opaque_softc *hif_hdl = GET_HIF_OPAQUE_HDL(scn);
+	struct CE_ring_state *src_ring = ce_state->src_ring;
+	unsigned int nentries_mask = src_ring->nentries_mask;
+	struct CE_src_desc *src_ring_base =
+		(struct CE_src_desc *)src_ring->base_addr_owner_space;
+	struct CE_src_desc *shadow_base =
+		(struct CE_src_desc *)src_ring->shadow_base;
+	struct CE_src_desc *src_desc =
+		CE_SRC_RING_TO_DESC(src_ring_base, write_index);
+	struct CE_src_desc *shadow_src_desc =
+		CE_SRC_RING_TO_DESC(shadow_base, write_index);
+	unsigned int frag_len;
+	uint64_t dma_addr;
+	uint32_t user_flags;
+
+	hif_pm_runtime_get_noresume(hif_hdl);
+
+	/*
+	 * First fill out the ring descriptor for the HTC HTT frame
+	 * header. These are uncached writes. Should we use a local
+	 * structure instead?
+	 */
+	/* HTT/HTC header can be passed as a argument */
+	dma_addr = qdf_nbuf_get_frag_paddr(msdu, 0);
+	shadow_src_desc->buffer_addr = (uint32_t)(dma_addr &
+						  0xFFFFFFFF);
+	user_flags = qdf_nbuf_data_attr_get(msdu) & DESC_DATA_FLAG_MASK;
+	ce_buffer_addr_hi_set(shadow_src_desc, dma_addr, user_flags);
+	shadow_src_desc->meta_data = transfer_id;
+	shadow_src_desc->nbytes = qdf_nbuf_get_frag_len(msdu, 0);
+	download_len -= shadow_src_desc->nbytes;
+	/*
+	 * HTC HTT header is a word stream, so byte swap if CE byte
+	 * swap enabled
+	 */
+	shadow_src_desc->byte_swap = ((ce_state->attr_flags &
+				CE_ATTR_BYTE_SWAP_DATA) != 0);
+	/* For the first one, it still does not need to write */
+	shadow_src_desc->gather = 1;
+	*src_desc = *shadow_src_desc;
+	/* By default we could initialize the transfer context to this
+	 * value
+	 */
+	src_ring->per_transfer_context[write_index] =
+		CE_SENDLIST_ITEM_CTXT;
+	write_index = CE_RING_IDX_INCR(nentries_mask, write_index);
+
+	src_desc = CE_SRC_RING_TO_DESC(src_ring_base, write_index);
+	shadow_src_desc = CE_SRC_RING_TO_DESC(shadow_base, write_index);
+	/*
+	 * Now fill out the ring descriptor for the actual data
+	 * packet
+	 */
+	dma_addr = qdf_nbuf_get_frag_paddr(msdu, 1);
+	shadow_src_desc->buffer_addr = (uint32_t)(dma_addr &
+						  0xFFFFFFFF);
+	/*
+	 * Clear packet offset for all but the first CE desc.
+	 */
+	user_flags &= ~QDF_CE_TX_PKT_OFFSET_BIT_M;
+	ce_buffer_addr_hi_set(shadow_src_desc, dma_addr, user_flags);
+	shadow_src_desc->meta_data = transfer_id;
+
+	/* get actual packet length */
+	frag_len = qdf_nbuf_get_frag_len(msdu, 1);
+
+	/* download remaining bytes of payload */
+	shadow_src_desc->nbytes =  download_len;
+	if (shadow_src_desc->nbytes > frag_len)
+		shadow_src_desc->nbytes = frag_len;
+
+	/*  Data packet is a byte stream, so disable byte swap */
+	shadow_src_desc->byte_swap = 0;
+	/* For the last one, gather is not set */
+	shadow_src_desc->gather    = 0;
+	*src_desc = *shadow_src_desc;
+	src_ring->per_transfer_context[write_index] = msdu;
+	write_index = CE_RING_IDX_INCR(nentries_mask, write_index);
+
+	DPTRACE(qdf_dp_trace(msdu,
+		QDF_DP_TRACE_CE_FAST_PACKET_PTR_RECORD,
+		qdf_nbuf_data_addr(msdu),
+		sizeof(qdf_nbuf_data(msdu)), QDF_TX));
+
+	return write_index;
+}
+
+/**
+ * ce_send_fast_write_idx_update() - ring the source ring doorbell
+ * @ce_state: copy engine state
+ * @write_index: new source ring write index
+ *
+ * Called with ce_index_lock held, once the descriptors are filled.
+ *
+ * Return: None
+ */
+static inline void
+ce_send_fast_write_idx_update(struct CE_state *ce_state,
+			      unsigned int write_index)
+{
+	struct hif_softc *scn = ce_state->scn;
+	struct hif_opaque_softc *hif_hdl = GET_HIF_OPAQUE_HDL(scn);
+
+	ce_state->src_ring->write_index = write_index;
+
+	if (hif_pm_runtime_get(hif_hdl) == 0) {
+		hif_record_ce_desc_event(scn, ce_state->id,
+					 FAST_TX_WRITE_INDEX_UPDATE,
+					 NULL, NULL, write_index);
+
+		/* Don't call WAR_XXX from here
+		 * Just call XXX instead, that has the reqd. intel
+		 */
+		war_ce_src_ring_write_idx_set(scn, ce_state->ctrl_addr,
+				write_index);
+		hif_pm_runtime_put(hif_hdl);
+	}
+}
+
 /**
  * ce_send_fast() CE layer Tx buffer posting function
  * @copyeng: copy engine handle
@@ -543,9 +683,7 @@ ce_buffer_addr_hi_set(struct CE_src_desc *shadow_src_desc,
  * @transfer_id: transfer_id
  * @download_len: packet download length
  *
- * Assumption : Called with an array of MSDU's
  * Function:
- * For each msdu in the array
  * 1. Check no. of available entries
  * 2. Create src ring entries (allocated in consistent memory
  * 3. Write index to h/w
@@ -557,15 +695,11 @@ int ce_send_fast(struct CE_handle *copyeng, qdf_nbuf_t msdu,
 {
 	struct CE_state *ce_state = (struct CE_state *)copyeng;
 	struct hif_softc *scn = ce_state->scn;
-	struct hif_opaque_softc *hif_hdl = GET_HIF_OPAQUE_HDL(scn);
 	struct CE_ring_state *src_ring = ce_state->src_ring;
 	u_int32_t ctrl_addr = ce_state->ctrl_addr;
 	unsigned int nentries_mask = src_ring->nentries_mask;
 	unsigned int write_index;
 	unsigned int sw_index;
-	unsigned int frag_len;
-	uint64_t dma_addr;
-	uint32_t user_flags;
 
 	qdf_spin_lock_bh(&ce_state->ce_index_lock);
 	Q_TARGET_ACCESS_BEGIN(scn);
@@ -589,107 +723,91 @@ int ce_send_fast(struct CE_handle *copyeng, qdf_nbuf_t msdu,
 		return 0;
 	}
 
-	{
-		struct CE_src_desc *src_ring_base =
-			(struct CE_src_desc *)src_ring->base_addr_owner_space;
-		struct CE_src_desc *shadow_base =
-			(struct CE_src_desc *)src_ring->shadow_base;
-		struct CE_src_desc *src_desc =
-			CE_SRC_RING_TO_DESC(src_ring_base, write_index);
-		struct CE_src_desc *shadow_src_desc =
-			CE_SRC_RING_TO_DESC(shadow_base, write_index);
+	write_index = ce_send_fast_desc_fill(ce_state, msdu, transfer_id,
+					     download_len, write_index);
+	ce_send_fast_write_idx_update(ce_state, write_index);
 
-		hif_pm_runtime_get_noresume(hif_hdl);
+	Q_TARGET_ACCESS_END(scn);
+	qdf_spin_unlock_bh(&ce_state->ce_index_lock);
 
-		/*
-		 * First fill out the ring descriptor for the HTC HTT frame
-		 * header. These are uncached writes. Should we use a local
-		 * structure instead?
-		 */
-		/* HTT/HTC header can be passed as a argument */
-		dma_addr = qdf_nbuf_get_frag_paddr(msdu, 0);
-		shadow_src_desc->buffer_addr = (uint32_t)(dma_addr &
-							  0xFFFFFFFF);
-		user_flags = qdf_nbuf_data_attr_get(msdu) & DESC_DATA_FLAG_MASK;
-		ce_buffer_addr_hi_set(shadow_src_desc, dma_addr, user_flags);
-			shadow_src_desc->meta_data = transfer_id;
-		shadow_src_desc->nbytes = qdf_nbuf_get_frag_len(msdu, 0);
-		download_len -= shadow_src_desc->nbytes;
-		/*
-		 * HTC HTT header is a word stream, so byte swap if CE byte
-		 * swap enabled
-		 */
-		shadow_src_desc->byte_swap = ((ce_state->attr_flags &
-					CE_ATTR_BYTE_SWAP_DATA) != 0);
-		/* For the first one, it still does not need to write */
-		shadow_src_desc->gather = 1;
-		*src_desc = *shadow_src_desc;
-		/* By default we could initialize the transfer context to this
-		 * value
-		 */
-		src_ring->per_transfer_context[write_index] =
-			CE_SENDLIST_ITEM_CTXT;
-		write_index = CE_RING_IDX_INCR(nentries_mask, write_index);
+	/* sent 1 packet */
+	return 1;
+}
 
-		src_desc = CE_SRC_RING_TO_DESC(src_ring_base, write_index);
-		shadow_src_desc = CE_SRC_RING_TO_DESC(shadow_base, write_index);
-		/*
-		 * Now fill out the ring descriptor for the actual data
-		 * packet
-		 */
-		dma_addr = qdf_nbuf_get_frag_paddr(msdu, 1);
-		shadow_src_desc->buffer_addr = (uint32_t)(dma_addr &
-							  0xFFFFFFFF);
-		/*
-		 * Clear packet offset for all but the first CE desc.
-		 */
-		user_flags &= ~QDF_CE_TX_PKT_OFFSET_BIT_M;
-		ce_buffer_addr_hi_set(shadow_src_desc, dma_addr, user_flags);
-		shadow_src_desc->meta_data = transfer_id;
+/**
+ * ce_send_fast_burst() CE layer Tx burst posting function
+ * @copyeng: copy engine handle
+ * @msdus: array of msdus to be sent
+ * @num_msdus: number of msdus in the array
+ * @transfer_id: transfer_id
+ * @download_len: packet download length
+ *
+ * Assumption : Called with an array of MSDU's
+ * Function:
+ * 1. Check no. of available entries once for the whole burst
+ * 2. Create src ring entries for as many msdus as fit in the ring
+ * 3. Write index to h/w once
+ *
+ * msdus that do not fit in the ring are left to the caller, starting at
+ * msdus[return value].
+ *
+ * Return: No. of packets that could be sent
+ */
+int ce_send_fast_burst(struct CE_handle *copyeng, qdf_nbuf_t *msdus,
+		       unsigned int num_msdus, unsigned int transfer_id,
+		       uint32_t download_len)
+{
+	struct CE_state *ce_state = (struct CE_state *)copyeng;
+	struct hif_softc *scn = ce_state->scn;
+	struct CE_ring_state *src_ring = ce_state->src_ring;
+	u_int32_t ctrl_addr = ce_state->ctrl_addr;
+	unsigned int nentries_mask = src_ring->nentries_mask;
+	unsigned int write_index;
+	unsigned int sw_index;
+	unsigned int num_sent;
+	int avail;
 
-		/* get actual packet length */
-		frag_len = qdf_nbuf_get_frag_len(msdu, 1);
+	if (qdf_unlikely(!num_msdus))
+		return 0;
 
-		/* download remaining bytes of payload */
-		shadow_src_desc->nbytes =  download_len;
-		if (shadow_src_desc->nbytes > frag_len)
-			shadow_src_desc->nbytes = frag_len;
+	qdf_spin_lock_bh(&ce_state->ce_index_lock);
+	Q_TARGET_ACCESS_BEGIN(scn);
 
-		/*  Data packet is a byte stream, so disable byte swap */
-		shadow_src_desc->byte_swap = 0;
-		/* For the last one, gather is not set */
-		shadow_src_desc->gather    = 0;
-		*src_desc = *shadow_src_desc;
-		src_ring->per_transfer_context[write_index] = msdu;
-		write_index = CE_RING_IDX_INCR(nentries_mask, write_index);
+	src_ring->sw_index = CE_SRC_RING_READ_IDX_GET_FROM_DDR(scn, ctrl_addr);
+	write_index = src_ring->write_index;
+	sw_index = src_ring->sw_index;
 
-		DPTRACE(qdf_dp_trace(msdu,
-			QDF_DP_TRACE_CE_FAST_PACKET_PTR_RECORD,
-			qdf_nbuf_data_addr(msdu),
-			sizeof(qdf_nbuf_data(msdu)), QDF_TX));
-	}
+	hif_record_ce_desc_event(scn, ce_state->id,
+				FAST_TX_SOFTWARE_INDEX_UPDATE,
+				NULL, NULL, write_index);
 
-	src_ring->write_index = write_index;
+	avail = CE_RING_DELTA(nentries_mask, write_index, sw_index - 1);
+	if (qdf_unlikely(avail < SLOTS_PER_DATAPATH_TX)) {
+		HIF_ERROR("Source ring full, required %d, available %d",
+		      SLOTS_PER_DATAPATH_TX, avail);
+		OL_ATH_CE_PKT_ERROR_COUNT_INCR(scn, CE_RING_DELTA_FAIL);
+		Q_TARGET_ACCESS_END(scn);
+		qdf_spin_unlock_bh(&ce_state->ce_index_lock);
+		return 0;
+	}
 
-	if (hif_pm_runtime_get(hif_hdl) == 0) {
-		hif_record_ce_desc_event(scn, ce_state->id,
-					 FAST_TX_WRITE_INDEX_UPDATE,
-					 NULL, NULL, write_index);
+	/* reserve the ring slots for the whole burst up front */
+	if (num_msdus > avail / SLOTS_PER_DATAPATH_TX)
+		num_msdus = avail / SLOTS_PER_DATAPATH_TX;
 
-		/* Don't call WAR_XXX from here
-		 * Just call XXX instead, that has the reqd. intel
-		 */
-		war_ce_src_ring_write_idx_set(scn, ctrl_addr,
-				write_index);
-		hif_pm_runtime_put(hif_hdl);
-	}
+	for (num_sent = 0; num_sent < num_msdus; num_sent++)
+		write_index = ce_send_fast_desc_fill(ce_state,
+						     msdus[num_sent],
+						     transfer_id, download_len,
+						     write_index);
 
+	/* one doorbell for the whole burst */
+	ce_send_fast_write_idx_update(ce_state, write_index);
 
 	Q_TARGET_ACCESS_END(scn);
 	qdf_spin_unlock_bh(&ce_state->ce_index_lock);
 
-	/* sent 1 packet */
-	return 1;
+	return num_sent;
 }
 
 /**
@@ -994,6 +1112,88 @@ ce_recv_buf_enqueue(struct CE_handle *copyeng,
 	return status;
 }
 
+/**
+ * ce_recv_buf_enqueue_multiple() - enqueue several recv buffers at once
+ * @copyeng: copy engine handle
+ * @per_recv_context: array of nbuf virtual addresses
+ * @buffer: array of nbuf physical addresses
+ * @num_bufs: number of buffers in the arrays
+ *
+ * Same as ce_recv_buf_enqueue(), but ce_index_lock is taken once and the
+ * destination ring write index is written to the target once for the
+ * whole batch.
+ *
+ * Return: number of buffers enqueued
+ */
+unsigned int
+ce_recv_buf_enqueue_multiple(struct CE_handle *copyeng,
+			     void **per_recv_context, qdf_dma_addr_t *buffer,
+			     unsigned int num_bufs)
+{
+	struct CE_state *CE_state = (struct CE_state *)copyeng;
+	struct CE_ring_state *dest_ring = CE_state->dest_ring;
+	uint32_t ctrl_addr = CE_state->ctrl_addr;
+	unsigned int nentries_mask = dest_ring->nentries_mask;
+	struct CE_dest_desc *dest_ring_base =
+		(struct CE_dest_desc *)dest_ring->base_addr_owner_space;
+	unsigned int write_index;
+	unsigned int sw_index;
+	unsigned int next_index;
+	unsigned int i;
+	struct hif_softc *scn = CE_state->scn;
+	bool fastpath_rx = ce_is_fastpath_enabled(scn) &&
+			   CE_state->htt_rx_data;
+
+	qdf_spin_lock_bh(&CE_state->ce_index_lock);
+	write_index = dest_ring->write_index;
+	sw_index = dest_ring->sw_index;
+
+	if (Q_TARGET_ACCESS_BEGIN(scn) < 0) {
+		qdf_spin_unlock_bh(&CE_state->ce_index_lock);
+		return 0;
+	}
+
+	for (i = 0; i < num_bufs; i++) {
+		struct CE_dest_desc *dest_desc;
+		uint64_t dma_addr = buffer[i];
+
+		if ((CE_RING_DELTA(nentries_mask, write_index,
+				   sw_index - 1) <= 0) && !fastpath_rx)
+			break;
+
+		dest_desc = CE_DEST_RING_TO_DESC(dest_ring_base, write_index);
+
+		/* Update low 32 bit destination descriptor */
+		dest_desc->buffer_addr = (uint32_t)(dma_addr & 0xFFFFFFFF);
+#ifdef QCA_WIFI_3_0
+		dest_desc->buffer_addr_hi =
+			(uint32_t)((dma_addr >> 32) & 0x1F);
+#endif
+		dest_desc->nbytes = 0;
+
+		dest_ring->per_transfer_context[write_index] =
+			per_recv_context[i];
+
+		hif_record_ce_desc_event(scn, CE_state->id, HIF_RX_DESC_POST,
+				(union ce_desc *) dest_desc,
+				per_recv_context[i], write_index);
+
+		next_index = CE_RING_IDX_INCR(nentries_mask, write_index);
+		if (next_index != sw_index)
+			write_index = next_index;
+	}
+
+	/* Update Destination Ring Write Index once for the whole batch */
+	if (write_index != dest_ring->write_index) {
+		CE_DEST_RING_WRITE_IDX_SET(scn, ctrl_addr, write_index);
+		dest_ring->write_index = write_index;
+	}
+
+	Q_TARGET_ACCESS_END(scn);
+	qdf_spin_unlock_bh(&CE_state->ce_index_lock);
+	return i;
+}
+
 void
 ce_send_watermarks_set(struct CE_handle *copyeng,
 		       unsigned int low_alert_nentries,
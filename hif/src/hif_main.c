@@ -949,8 +949,7 @@ int hif_send_single(struct hif_opaque_softc *osc, qdf_nbuf_t msdu, uint32_t
  * hif_send_fast() - API to access hif specific function
  * ce_send_fast.
  * @osc: HIF Context
- * @msdu : array of msdus to be sent
- * @num_msdus : number of msdus in an array
+ * @nbuf : msdu to be sent
  * @transfer_id: transfer id
  * @download_len: download length
  *
@@ -963,6 +962,26 @@ int hif_send_fast(struct hif_opaque_softc *osc, qdf_nbuf_t nbuf,
 	return ce_send_fast((struct CE_handle *)ce_tx_hdl, nbuf,
 			transfer_id, download_len);
 }
+
+/**
+ * hif_send_fast_burst() - API to access hif specific function
+ * ce_send_fast_burst.
+ * @osc: HIF Context
+ * @msdus : array of msdus to be sent
+ * @num_msdus : number of msdus in an array
+ * @transfer_id: transfer id
+ * @download_len: download length
+ *
+ * Return: No. of packets that could be sent
+ */
+int hif_send_fast_burst(struct hif_opaque_softc *osc, qdf_nbuf_t *msdus,
+		uint32_t num_msdus, uint32_t transfer_id,
+		uint32_t download_len)
+{
+	void *ce_tx_hdl = hif_get_ce_handle(osc, CE_HTT_TX_CE);
+	return ce_send_fast_burst((struct CE_handle *)ce_tx_hdl, msdus,
+			num_msdus, transfer_id, download_len);
+}
 #endif
 
 /**
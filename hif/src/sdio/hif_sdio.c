@@ -124,6 +124,48 @@ QDF_STATUS hif_send_head(struct hif_opaque_softc *hif_ctx, uint8_t pipe,
 				nbytes, buf);
 }
 
+/**
+ * hif_get_max_gather_frags() - max fragments accepted by hif_send_gather
+ * @hif_ctx: HIF context
+ * @pipe: pipe the gathered transfer will be sent on
+ *
+ * Return: number of fragments, 0 if gathered sends are not supported
+ */
+uint32_t hif_get_max_gather_frags(struct hif_opaque_softc *hif_ctx,
+				  uint8_t pipe)
+{
+	struct hif_sdio_softc *scn = HIF_GET_SDIO_SOFTC(hif_ctx);
+	struct hif_sdio_dev *hif_device = scn->hif_handle;
+	struct hif_sdio_device *htc_sdio_device = hif_dev_from_hif(hif_device);
+
+	return hif_dev_max_gather_frags(htc_sdio_device);
+}
+
+/**
+ * hif_send_gather() - send tx data gathered from several buffers
+ * @hif_ctx: HIF context
+ * @pipe: pipe to send on
+ * @transfer_id: transfer id reported back with the completion
+ * @nbytes: total length of all fragments
+ * @frags: fragments to send, in order
+ * @nfrags: number of fragments
+ * @ctx_buf: nbuf handed back to the tx completion handler
+ *
+ * Return: QDF_STATUS_SUCCESS on success or an error status
+ */
+QDF_STATUS hif_send_gather(struct hif_opaque_softc *hif_ctx, uint8_t pipe,
+			   uint32_t transfer_id, uint32_t nbytes,
+			   struct hif_gather_frag *frags, uint32_t nfrags,
+			   qdf_nbuf_t ctx_buf)
+{
+	struct hif_sdio_softc *scn = HIF_GET_SDIO_SOFTC(hif_ctx);
+	struct hif_sdio_dev *hif_device = scn->hif_handle;
+	struct hif_sdio_device *htc_sdio_device = hif_dev_from_hif(hif_device);
+
+	return hif_dev_send_gather(htc_sdio_device, transfer_id, pipe,
+				   nbytes, frags, nfrags, ctx_buf);
+}
+
 /**
  * hif_map_service_to_pipe() - maps ul/dl pipe to service id.
  * @hif_ctx: HIF hdl
@@ -271,6 +271,8 @@ void hif_dev_destroy(struct hif_sdio_device *pdev)
 				("(%s)HIF_DEVICE_SET_HTC_CONTEXT failed!!!\n",
 				 __func__));
 	}
+	if (pdev->GatherPadBuf)
+		qdf_mem_free(pdev->GatherPadBuf);
 	qdf_mem_free(pdev);
 }
 
@@ -466,6 +468,18 @@ QDF_STATUS hif_dev_setup(struct hif_sdio_device *pdev)
 	pdev->BlockMask = pdev->BlockSize - 1;
 	A_ASSERT((pdev->BlockSize & pdev->BlockMask) == 0);
 
+	/* scatter requests are optional, used for gathered sends only */
+	status = hif_configure_device(hif_device,
+				      HIF_CONFIGURE_QUERY_SCATTER_REQUEST_SUPPORT,
+				      &pdev->HifScatterInfo,
+				      sizeof(pdev->HifScatterInfo));
+	if (status == QDF_STATUS_SUCCESS) {
+		pdev->GatherPadBuf = qdf_mem_malloc(pdev->BlockSize);
+		pdev->ScatterEnabled = (pdev->GatherPadBuf != NULL);
+	}
+	AR_DEBUG_PRINTF(ATH_DEBUG_TRC, ("HIF scatter support: %d\n",
+					pdev->ScatterEnabled));
+
 	/* assume we can process HIF interrupt events asynchronously */
 	pdev->HifIRQProcessingMode = HIF_DEVICE_IRQ_ASYNC_SYNC;
 
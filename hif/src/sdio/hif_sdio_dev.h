@@ -54,6 +54,14 @@ QDF_STATUS hif_dev_send_buffer(struct hif_sdio_device *htc_sdio_device,
 			     unsigned int transfer_id, uint8_t pipe,
 			     unsigned int nbytes, qdf_nbuf_t buf);
 
+uint32_t hif_dev_max_gather_frags(struct hif_sdio_device *htc_sdio_device);
+
+QDF_STATUS hif_dev_send_gather(struct hif_sdio_device *htc_sdio_device,
+			     unsigned int transfer_id, uint8_t pipe,
+			     unsigned int nbytes,
+			     struct hif_gather_frag *frags, uint32_t nfrags,
+			     qdf_nbuf_t ctx_buf);
+
 QDF_STATUS hif_dev_map_service_to_pipe(struct hif_sdio_device *pdev,
 				       uint16_t service_id,
 				       uint8_t *ul_pipe,
@@ -112,6 +112,9 @@ struct hif_sdio_device {
 	int RecheckIRQStatusCnt;
 	uint32_t RecvStateFlags;
 	void *pTarget;
+	struct HIF_DEVICE_SCATTER_SUPPORT_INFO HifScatterInfo;
+	bool ScatterEnabled;
+	uint8_t *GatherPadBuf;  /* block padding source for gathered sends */
 };
 
 #define LOCK_HIF_DEV(device)    qdf_spin_lock(&(device)->Lock);
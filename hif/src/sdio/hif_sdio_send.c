@@ -195,3 +195,122 @@ QDF_STATUS hif_dev_send_buffer(struct hif_sdio_device *pdev,
 
 	return status;
 }
+
+/**
+ * hif_dev_max_gather_frags() - max fragments accepted by hif_dev_send_gather
+ * @pdev: sdio device context
+ *
+ * One scatter entry is kept back for the block padding.
+ *
+ * Return: number of fragments, 0 if scatter requests are not supported
+ */
+uint32_t hif_dev_max_gather_frags(struct hif_sdio_device *pdev)
+{
+	if (!pdev->ScatterEnabled)
+		return 0;
+
+	return pdev->HifScatterInfo.max_scatter_entries - 1;
+}
+
+/**
+ * hif_dev_gather_completion() - completion of a gathered send
+ * @req: scatter request that carried the send
+ *
+ * Return: none
+ */
+static void hif_dev_gather_completion(struct _HIF_SCATTER_REQ *req)
+{
+	struct hif_sdio_device *pdev = (struct hif_sdio_device *)req->context;
+	qdf_nbuf_t buf = (qdf_nbuf_t)req->scatter_list[0].caller_contexts[0];
+	unsigned int transfer_id = req->caller_flags;
+
+	if (req->completion_status != QDF_STATUS_SUCCESS)
+		AR_DEBUG_PRINTF(ATH_DEBUG_ERR,
+				("%s: gathered send failed: %d\n", __func__,
+				 req->completion_status));
+
+	pdev->HifScatterInfo.free_req_func(pdev->HIFDevice, req);
+
+	if (pdev->hif_callbacks.txCompletionHandler)
+		pdev->hif_callbacks.txCompletionHandler(pdev->hif_callbacks.
+					Context, buf, transfer_id, 0);
+}
+
+/**
+ * hif_dev_send_gather() - send several buffers as one mailbox write
+ * @pdev: sdio device context
+ * @transfer_id: transfer id
+ * @pipe: ul/dl pipe
+ * @nbytes: total length of all fragments
+ * @frags: fragments to send, in order
+ * @nfrags: number of fragments
+ * @ctx_buf: nbuf handed back to the tx completion handler
+ *
+ * The fragments and the block padding go out as one CMD53 scatter
+ * request, so nothing is copied into an intermediate buffer. The
+ * transfer is placed at the end of the extended mailbox window, the same
+ * way hif_read_write() places a linear send.
+ *
+ * Return: 0 for success and non-zero for failure
+ */
+QDF_STATUS hif_dev_send_gather(struct hif_sdio_device *pdev,
+			       unsigned int transfer_id, uint8_t pipe,
+			       unsigned int nbytes,
+			       struct hif_gather_frag *frags, uint32_t nfrags,
+			       qdf_nbuf_t ctx_buf)
+{
+	struct _HIF_SCATTER_REQ *req;
+	uint8_t mbox_index = hif_dev_map_pipe_to_mail_box(pdev, pipe);
+	struct hif_device_mbox_info *mbox_info = &pdev->MailBoxInfo;
+	uint32_t padded_length;
+	uint32_t i;
+	QDF_STATUS status;
+
+	padded_length = DEV_CALC_SEND_PADDED_LEN(pdev, nbytes);
+
+	if (nfrags == 0 || nfrags > hif_dev_max_gather_frags(pdev) ||
+	    padded_length >
+	    pdev->HifScatterInfo.max_tx_size_per_scatter_req ||
+	    padded_length > mbox_info->mbox_prop[mbox_index].extended_size)
+		return QDF_STATUS_E_NOSUPPORT;
+
+	req = pdev->HifScatterInfo.allocate_req_func(pdev->HIFDevice);
+	if (req == NULL)
+		return QDF_STATUS_E_RESOURCES;
+
+	for (i = 0; i < nfrags; i++) {
+		req->scatter_list[i].buffer = frags[i].vaddr;
+		req->scatter_list[i].length = frags[i].len;
+	}
+	if (padded_length != nbytes) {
+		req->scatter_list[i].buffer = pdev->GatherPadBuf;
+		req->scatter_list[i].length = padded_length - nbytes;
+		i++;
+	}
+	req->valid_scatter_entries = i;
+	req->scatter_list[0].caller_contexts[0] = ctx_buf;
+
+	/*
+	 * Place the padded transfer at the end of the extended mailbox and
+	 * skip the dummy bytes, as hif_read_write() does for a linear send;
+	 * the scatter path takes the address as is.
+	 */
+	req->address = mbox_info->mbox_prop[mbox_index].extended_address +
+		(mbox_info->mbox_prop[mbox_index].extended_size -
+		 padded_length) + (padded_length - nbytes);
+	req->request = HIF_WR_ASYNC_BLOCK_INC;
+	req->total_length = padded_length;
+	req->caller_flags = transfer_id;
+	req->context = pdev;
+	req->completion_routine = hif_dev_gather_completion;
+
+	status = pdev->HifScatterInfo.read_write_scatter_func(pdev->HIFDevice,
+							       req);
+	if (status == QDF_STATUS_E_PENDING)
+		status = QDF_STATUS_SUCCESS;
+	/* a request rejected with an error is never completed, free it here */
+	if (status != QDF_STATUS_SUCCESS)
+		pdev->HifScatterInfo.free_req_func(pdev->HIFDevice, req);
+
+	return status;
+}
@@ -92,10 +92,15 @@ static void usb_hif_usb_transmit_complete(struct urb *urb)
 	buf = urb_context->buf;
 	send_context = urb_context->send_context;
 
-	if (send_context->new_alloc)
+	if (send_context == NULL) {
+		/* gathered transfer, see hif_send_gather() */
+		urb->sg = NULL;
+		urb->num_sgs = 0;
+	} else if (send_context->new_alloc) {
 		qdf_mem_free(send_context);
-	else
+	} else {
 		qdf_nbuf_pull_head(buf, send_context->head_data_len);
+	}
 
 	urb_context->buf = NULL;
 	usb_hif_cleanup_transmit_urb(urb_context);
@@ -281,6 +286,110 @@ QDF_STATUS hif_send_head(struct hif_opaque_softc *scn, uint8_t pipe_id,
 	return status;
 }
 
+/**
+ * hif_get_max_gather_frags() - max fragments accepted by hif_send_gather
+ * @scn: pointer to hif_opaque_softc structure
+ * @pipe_id: HIF pipe the gathered transfer will be sent on
+ *
+ * One scatter list entry is kept back for the max packet boundary pad.
+ *
+ * Return: number of fragments one tx urb can carry, 0 if the host
+ * controller cannot DMA from a scatter list
+ */
+uint32_t hif_get_max_gather_frags(struct hif_opaque_softc *scn,
+				  uint8_t pipe_id)
+{
+	HIF_DEVICE_USB *device = HIF_GET_USB_DEVICE(scn);
+
+	if (device->udev->bus->sg_tablesize < 2)
+		return 0;
+
+	return QDF_MIN(device->udev->bus->sg_tablesize - 1,
+		       HIF_USB_MAX_GATHER_FRAGS);
+}
+
+/**
+ * hif_send_gather() - send a transfer gathered from several buffers
+ * @scn: pointer to hif_opaque_softc structure
+ * @pipe_id: HIF pipe on which data is to be sent
+ * @transfer_id: endpoint ID on which data is to be sent
+ * @nbytes: total length of all fragments
+ * @frags: fragments to send, in order
+ * @nfrags: number of fragments
+ * @ctx_buf: nbuf handed back to the tx completion handler, its data
+ *	must start with the HTC header of the first message
+ *
+ * The fragments are described to the host controller as one scatter
+ * gather bulk urb, so nothing is copied into an intermediate buffer.
+ *
+ * Return: QDF_STATUS_SUCCESS on success and error QDF status on failure
+ */
+QDF_STATUS hif_send_gather(struct hif_opaque_softc *scn, uint8_t pipe_id,
+			   uint32_t transfer_id, uint32_t nbytes,
+			   struct hif_gather_frag *frags, uint32_t nfrags,
+			   qdf_nbuf_t ctx_buf)
+{
+	HIF_DEVICE_USB *device = HIF_GET_USB_DEVICE(scn);
+	HIF_USB_PIPE *pipe = &device->pipes[pipe_id];
+	HIF_URB_CONTEXT *urb_context;
+	struct urb *urb;
+	int usb_status;
+	uint32_t i, num_sgs, len;
+
+	if (nfrags == 0 || nfrags > hif_get_max_gather_frags(scn, pipe_id))
+		return QDF_STATUS_E_NOSUPPORT;
+
+	urb_context = usb_hif_alloc_urb_from_pipe(pipe);
+	if (NULL == urb_context) {
+		HIF_ERROR("%s pipe:%d no urbs left. URB Cnt : %d",
+			__func__, pipe_id, pipe->urb_cnt);
+		return QDF_STATUS_E_RESOURCES;
+	}
+
+	num_sgs = nfrags;
+	len = nbytes;
+	/* hit a max packet boundary, pad by one byte like the linear path */
+	if ((nbytes % pipe->max_packet_size) == 0) {
+		num_sgs++;
+		len++;
+	}
+
+	sg_init_table(urb_context->sg, num_sgs);
+	for (i = 0; i < nfrags; i++)
+		sg_set_buf(&urb_context->sg[i], frags[i].vaddr, frags[i].len);
+	if (num_sgs != nfrags)
+		sg_set_buf(&urb_context->sg[i], &urb_context->sg_pad, 1);
+
+	urb_context->send_context = NULL;
+	urb_context->buf = ctx_buf;
+	urb = urb_context->urb;
+
+	usb_fill_bulk_urb(urb,
+			  device->udev,
+			  pipe->usb_pipe_handle,
+			  NULL, len,
+			  usb_hif_usb_transmit_complete, urb_context);
+	urb->sg = urb_context->sg;
+	urb->num_sgs = num_sgs;
+
+	HIF_DBG("athusb bulk gather submit:%d, %d frags, %d bytes",
+		pipe->logical_pipe_num, nfrags, nbytes);
+
+	usb_hif_enqueue_pending_transfer(pipe, urb_context);
+	usb_status = usb_submit_urb(urb, GFP_ATOMIC);
+	if (usb_status) {
+		HIF_ERROR("athusb : usb bulk gather failed %d", usb_status);
+		urb->sg = NULL;
+		urb->num_sgs = 0;
+		urb_context->buf = NULL;
+		usb_hif_remove_pending_transfer(urb_context);
+		usb_hif_cleanup_transmit_urb(urb_context);
+		return QDF_STATUS_E_FAILURE;
+	}
+
+	return QDF_STATUS_SUCCESS;
+}
+
 /**
  * hif_get_free_queue_number() - get # of free TX resources in a given HIF pipe
  * @scn: pointer to hif_opaque_softc structure
@@ -40,6 +40,9 @@
 #define TX_URB_COUNT    32
 #define RX_URB_COUNT    32
 
+/* max fragments of one gathered tx urb, see hif_send_gather() */
+#define HIF_USB_MAX_GATHER_FRAGS 16
+
 #define HIF_USB_RX_BUFFER_SIZE  (1792 + 8)
 #define HIF_USB_RX_BUNDLE_ONE_PKT_SIZE  (1792 + 8)
 
@@ -78,6 +81,9 @@ typedef struct _HIF_URB_CONTEXT {
 	qdf_nbuf_t buf;
 	struct urb *urb;
 	struct hif_usb_send_context *send_context;
+	/* gathered fragments plus the max packet boundary pad byte */
+	struct scatterlist sg[HIF_USB_MAX_GATHER_FRAGS + 1];
+	uint8_t sg_pad;
 } HIF_URB_CONTEXT;
 
 #define HIF_USB_PIPE_FLAG_TX    (1 << 0)
@@ -141,6 +141,7 @@ void htc_dump(HTC_HANDLE HTCHandle, uint8_t CmdId, bool start)
 static void htc_cleanup(HTC_TARGET *target)
 {
 	HTC_PACKET *pPacket;
+	int i;
 	/* qdf_nbuf_t netbuf; */
 
 	if (target->hif_dev != NULL) {
@@ -163,6 +164,8 @@ static void htc_cleanup(HTC_TARGET *target)
 		qdf_mem_free(pPacket);
 		pPacket = pPacketTmp;
 	}
+
+	htc_tx_bundle_gather_deinit(target);
 #ifdef TODO_FIXME
 	while (true) {
 		pPacket = htc_alloc_control_tx_packet(target);
@@ -182,6 +185,8 @@ static void htc_cleanup(HTC_TARGET *target)
 	qdf_spinlock_destroy(&target->HTCRxLock);
 	qdf_spinlock_destroy(&target->HTCTxLock);
 	qdf_spinlock_destroy(&target->HTCCreditLock);
+	for (i = 0; i < ENDPOINT_MAX; i++)
+		qdf_spinlock_destroy(&target->endpoint[i].TxLock);
 
 	/* free our instance */
 	qdf_mem_free(target);
@@ -266,6 +271,9 @@ HTC_HANDLE htc_create(void *ol_sc, HTC_INIT_INFO *pInfo, qdf_device_t osdev,
 	qdf_spinlock_create(&target->HTCRxLock);
 	qdf_spinlock_create(&target->HTCTxLock);
 	qdf_spinlock_create(&target->HTCCreditLock);
+	for (i = 0; i < ENDPOINT_MAX; i++)
+		qdf_spinlock_create(&target->endpoint[i].TxLock);
+	qdf_atomic_init(&target->ce_send_cnt);
 
 	do {
 		qdf_mem_copy(&target->HTCInitInfo, pInfo,
@@ -301,6 +309,8 @@ HTC_HANDLE htc_create(void *ol_sc, HTC_INIT_INFO *pInfo, qdf_device_t osdev,
 		qdf_mem_zero(&htcCallbacks, sizeof(struct hif_msg_callbacks));
 		htcCallbacks.Context = target;
 		htcCallbacks.rxCompletionHandler = htc_rx_completion_handler;
+		htcCallbacks.rxCompletionHandlerMultiple =
+			htc_rx_completion_handler_multiple;
 		htcCallbacks.txCompletionHandler = htc_tx_completion_handler;
 		htcCallbacks.txResourceAvailHandler = htc_tx_resource_avail_handler;
 		htcCallbacks.fwEventHandler = htc_fw_event_handler;
@@ -604,9 +614,17 @@ static void reset_endpoint_states(HTC_TARGET *target)
 		pEndpoint->Id = i;
 		INIT_HTC_PACKET_QUEUE(&pEndpoint->TxQueue);
 		INIT_HTC_PACKET_QUEUE(&pEndpoint->TxLookupQueue);
+		qdf_mem_zero(pEndpoint->TxLookupHash,
+			     sizeof(pEndpoint->TxLookupHash));
 		INIT_HTC_PACKET_QUEUE(&pEndpoint->RxBufferHoldQueue);
+		pEndpoint->RxRecycle = false;
 		pEndpoint->target = target;
 		pEndpoint->TxCreditFlowEnabled = (bool)htc_credit_flow;
+		pEndpoint->TxBundleSize = 0;
+		pEndpoint->TxBundleAvgDepth = 0;
+		pEndpoint->TxBundleMsgLatencyUs = 0;
+		pEndpoint->TxBundleProbe = NULL;
+		pEndpoint->TxBundleCapped = 0;
 		qdf_atomic_init(&pEndpoint->TxProcessCount);
 	}
 }
@@ -669,6 +687,7 @@ A_STATUS htc_start(HTC_HANDLE HTCHandle)
 				HTC_SETUP_COMPLETE_FLAGS_ENABLE_BUNDLE_RECV;
 			hif_set_bundle_mode(target->hif_dev, true,
 				HTC_MAX_MSG_PER_BUNDLE_RX);
+			htc_tx_bundle_gather_init(target);
 		}
 
 		SET_HTC_PACKET_INFO_TX(pSendPacket,
@@ -828,7 +847,7 @@ bool htc_get_endpoint_statistics(HTC_HANDLE HTCHandle,
 	A_ASSERT(Endpoint < ENDPOINT_MAX);
 
 	/* lock out TX and RX while we sample and/or clear */
-	LOCK_HTC_TX(target);
+	LOCK_HTC_EP_TX(&target->endpoint[Endpoint]);
 	LOCK_HTC_RX(target);
 
 	if (sample) {
@@ -845,7 +864,7 @@ bool htc_get_endpoint_statistics(HTC_HANDLE HTCHandle,
 	}
 
 	UNLOCK_HTC_RX(target);
-	UNLOCK_HTC_TX(target);
+	UNLOCK_HTC_EP_TX(&target->endpoint[Endpoint]);
 
 	return true;
 #else
@@ -928,6 +947,31 @@ void htc_dump_bundle_stats(HTC_HANDLE HTCHandle)
 					 ((target->tx_bundle_stats[i]*100)/
 					  total), "%"));
 	}
+
+	for (i = ENDPOINT_0; i < ENDPOINT_MAX; i++) {
+		HTC_ENDPOINT *pEndpoint = &target->endpoint[i];
+
+		if (!pEndpoint->TxBundleSize)
+			continue;
+		AR_DEBUG_PRINTF(ATH_DEBUG_ANY,
+				("EP%d bundle size %d avg depth %d msg latency %dus\n",
+				 i, pEndpoint->TxBundleSize,
+				 pEndpoint->TxBundleAvgDepth >>
+				 HTC_TX_BUNDLE_AVG_SHIFT,
+				 pEndpoint->TxBundleMsgLatencyUs));
+	}
+}
+
+uint32_t htc_get_tx_bundle_histogram(HTC_HANDLE HTCHandle, uint32_t *hist,
+				     uint32_t len)
+{
+	HTC_TARGET *target = GET_HTC_TARGET_FROM_HANDLE(HTCHandle);
+
+	if (len > HTC_MAX_MSG_PER_BUNDLE_TX)
+		len = HTC_MAX_MSG_PER_BUNDLE_TX;
+	qdf_mem_copy(hist, target->tx_bundle_stats, len * sizeof(*hist));
+
+	return len;
 }
 
 void htc_clear_bundle_stats(HTC_HANDLE HTCHandle)
@@ -939,6 +983,35 @@ void htc_clear_bundle_stats(HTC_HANDLE HTCHandle)
 }
 #endif
 
+QDF_STATUS htc_get_tx_bundle_info(HTC_HANDLE HTCHandle,
+				  HTC_ENDPOINT_ID Endpoint,
+				  struct htc_tx_bundle_info *info)
+{
+	HTC_TARGET *target = GET_HTC_TARGET_FROM_HANDLE(HTCHandle);
+	HTC_ENDPOINT *pEndpoint;
+
+	if (Endpoint >= ENDPOINT_MAX || !info)
+		return QDF_STATUS_E_INVAL;
+
+	pEndpoint = &target->endpoint[Endpoint];
+	LOCK_HTC_EP_TX(pEndpoint);
+	info->bundle_size = pEndpoint->TxBundleSize;
+	info->avg_queue_depth =
+		pEndpoint->TxBundleAvgDepth >> HTC_TX_BUNDLE_AVG_SHIFT;
+	info->msg_latency_us = pEndpoint->TxBundleMsgLatencyUs;
+	UNLOCK_HTC_EP_TX(pEndpoint);
+
+	return QDF_STATUS_SUCCESS;
+}
+
+void htc_set_tx_bundle_latency_target(HTC_HANDLE HTCHandle,
+				      uint32_t latency_us)
+{
+	HTC_TARGET *target = GET_HTC_TARGET_FROM_HANDLE(HTCHandle);
+
+	target->TxBundleLatencyTargetUs = latency_us;
+}
+
 /**
  * htc_vote_link_down - API to vote for link down
  * @htc_handle: HTC handle
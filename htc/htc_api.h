@@ -650,6 +650,28 @@ bool htc_is_endpoint_active(HTC_HANDLE HTCHandle,
 int htc_get_num_recv_buffers(HTC_HANDLE HTCHandle,
 			     HTC_ENDPOINT_ID Endpoint);
 
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   @desc: Let HIF recycle the receive buffers indicated to an endpoint
+   @function name: htc_rx_nbuf_recycle_enable
+   @input:  HTCHandle - HTC handle
+	Endpoint - connected endpoint
+	pool_size - receive buffers HIF may keep mapped for reposting
+   @output:
+   @return: A_OK on success, A_ERROR if the bus can't recycle
+   @notes:  every netbuf indicated to the endpoint afterwards must be freed
+	with htc_rx_nbuf_free(), or released with htc_rx_nbuf_release()
+	before it is handed to code that frees it with qdf_nbuf_free().
+   @example:
+   @see also: htc_rx_nbuf_free, htc_rx_nbuf_release
+ +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*/
+A_STATUS htc_rx_nbuf_recycle_enable(HTC_HANDLE HTCHandle,
+				    HTC_ENDPOINT_ID Endpoint,
+				    uint32_t pool_size);
+void htc_rx_nbuf_free(HTC_HANDLE HTCHandle, HTC_ENDPOINT_ID Endpoint,
+		      qdf_nbuf_t netbuf);
+void htc_rx_nbuf_release(HTC_HANDLE HTCHandle, HTC_ENDPOINT_ID Endpoint,
+			 qdf_nbuf_t netbuf);
+
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
    @desc: Set the target failure handling callback in HTC layer
    @function name: htc_set_target_failure_callback
@@ -747,6 +769,55 @@ void htc_dump_bundle_stats(HTC_HANDLE HTCHandle);
  * Return: None
  */
 void htc_clear_bundle_stats(HTC_HANDLE HTCHandle);
+
+/**
+ * htc_get_tx_bundle_histogram() - copy the tx bundle size histogram
+ * @HTCHandle: htc handle
+ * @hist: array receiving the number of bundles of 1..@len messages
+ * @len: number of entries in @hist
+ *
+ * Return: number of entries copied to @hist
+ */
+uint32_t htc_get_tx_bundle_histogram(HTC_HANDLE HTCHandle, uint32_t *hist,
+				     uint32_t len);
 #endif
 
+/**
+ * struct htc_tx_bundle_info - adaptive tx bundling state of an endpoint
+ * @bundle_size: max messages per bundle last chosen, 0 if never bundled
+ * @avg_queue_depth: average ready queue depth seen when bundling
+ * @msg_latency_us: average bus latency of a bundled message
+ */
+struct htc_tx_bundle_info {
+	uint32_t bundle_size;
+	uint32_t avg_queue_depth;
+	uint32_t msg_latency_us;
+};
+
+/**
+ * htc_get_tx_bundle_info() - get the adaptive tx bundling state
+ * @HTCHandle: htc handle
+ * @Endpoint: endpoint to query
+ * @info: filled with the bundling state of @Endpoint
+ *
+ * Return: QDF_STATUS_SUCCESS or QDF_STATUS_E_INVAL for a bad endpoint
+ */
+QDF_STATUS htc_get_tx_bundle_info(HTC_HANDLE HTCHandle,
+				  HTC_ENDPOINT_ID Endpoint,
+				  struct htc_tx_bundle_info *info);
+
+/**
+ * htc_set_tx_bundle_latency_target() - bound the bus time of a tx bundle
+ * @HTCHandle: htc handle
+ * @latency_us: target bus time of one bundle, 0 to size bundles on
+ *	queue depth only
+ *
+ * Endpoints out of tx credits ignore the target and bundle as deep as
+ * their queue allows.
+ *
+ * Return: None
+ */
+void htc_set_tx_bundle_latency_target(HTC_HANDLE HTCHandle,
+				      uint32_t latency_us);
+
 #endif /* _HTC_API_H_ */
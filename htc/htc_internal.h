@@ -67,7 +67,13 @@ extern "C" {
  */
 #define HTC_MAX_TX_BUNDLE_SEND_LIMIT        255
 
-#define HTC_PACKET_CONTAINER_ALLOCATION     32
+/* max rx packets held back before they are indicated to their endpoint */
+#define HTC_RX_BATCH_MAX                    32
+/* rx pipes that may be reaped, and so batch, at the same time */
+#define HTC_RX_BATCH_PIPES                  4
+/* a full batch for every concurrent rx pipe plus the unbatched paths */
+#define HTC_PACKET_CONTAINER_ALLOCATION     \
+	(HTC_RX_BATCH_MAX * (HTC_RX_BATCH_PIPES + 1))
 #define NUM_CONTROL_TX_BUFFERS              2
 #define HTC_CONTROL_BUFFER_SIZE             (HTC_MAX_CONTROL_MESSAGE_LENGTH + HTC_HDR_LENGTH)
 #define HTC_CONTROL_BUFFER_ALIGN            32
@@ -81,6 +87,8 @@ extern "C" {
 #define HTC_SERVICE_TX_PACKET_TAG  HTC_TX_PACKET_TAG_INTERNAL
 
 #define HTC_CREDIT_HISTORY_MAX              1024
+/* buckets of the per endpoint netbuf to tx packet index, power of 2 */
+#define HTC_TX_LOOKUP_HASH_SIZE             64
 
 #define HTC_IS_EPPING_ENABLED(_x)           ((_x) == QDF_GLOBAL_EPPING_MODE)
 
@@ -124,9 +132,12 @@ typedef struct _HTC_ENDPOINT {
 #endif
 
 	HTC_PACKET_QUEUE TxLookupQueue;         /* lookup queue to match netbufs to htc packets */
+	HTC_PACKET *TxLookupHash[HTC_TX_LOOKUP_HASH_SIZE]; /* TxLookupQueue indexed by netbuf */
 	HTC_PACKET_QUEUE RxBufferHoldQueue;             /* temporary hold queue for back compatibility */
+	bool RxRecycle;                 /* rx netbufs are freed with htc_rx_nbuf_free */
 	uint8_t SeqNo;          /* TX seq no (helpful) for debugging */
 	qdf_atomic_t TxProcessCount;            /* serialization */
+	qdf_spinlock_t TxLock;          /* TX queues, credits and lookup of this endpoint */
 	struct _HTC_TARGET *target;
 	int TxCredits;          /* TX credits available on this endpoint */
 	int TxCreditSize;               /* size in bytes of each credit (set by HTC) */
@@ -135,6 +146,13 @@ typedef struct _HTC_ENDPOINT {
 	HTC_ENDPOINT_STATS endpoint_stats;     /* endpoint statistics */
 #endif
 	bool TxCreditFlowEnabled;
+	/* adaptive TX bundling, see htc_tx_bundle_adapt() */
+	uint8_t TxBundleSize;           /* max msgs of the last bundle, 0 if none */
+	uint32_t TxBundleAvgDepth;      /* ready queue depth, HTC_TX_BUNDLE_AVG_SHIFT fixed point */
+	uint32_t TxBundleMsgLatencyUs;  /* average bundle latency per message */
+	HTC_PACKET *TxBundleProbe;      /* bundle whose latency is being measured */
+	uint64_t TxBundleProbeTs;       /* send time of TxBundleProbe */
+	uint32_t TxBundleCapped;        /* bundles skipped since the last decay */
 } HTC_ENDPOINT;
 
 #ifdef HTC_EP_STAT_PROFILING
@@ -162,7 +180,7 @@ typedef struct _HTC_TARGET {
 	HTC_ENDPOINT endpoint[ENDPOINT_MAX];
 	qdf_spinlock_t HTCLock;
 	qdf_spinlock_t HTCRxLock;
-	qdf_spinlock_t HTCTxLock;
+	qdf_spinlock_t HTCTxLock;       /* target wide TX state, e.g. bundle free list */
 	qdf_spinlock_t HTCCreditLock;
 	uint32_t HTCStateFlags;
 	void *host_handle;
@@ -186,10 +204,16 @@ typedef struct _HTC_TARGET {
 	qdf_device_t osdev;
 	struct ol_ath_htc_stats htc_pkt_stats;
 	HTC_PACKET *pBundleFreeList;
-	uint32_t ce_send_cnt;
+	qdf_atomic_t ce_send_cnt;               /* updated by every endpoint */
 	uint32_t TX_comp_cnt;
 	uint8_t MaxMsgsPerHTCBundle;
 	qdf_work_t queue_kicker;
+	/* zero-copy TX bundling, TxBundleMaxFrags is 0 when bundles are copied */
+	uint32_t TxBundleMaxFrags;
+	struct hif_gather_frag *TxBundleFrags;  /* per endpoint gather lists */
+	uint8_t *TxBundlePad;                   /* credit padding source */
+	qdf_dma_addr_t TxBundlePadPaddr;        /* 0 unless the bus gathers by DMA */
+	uint32_t TxBundleLatencyTargetUs;       /* 0: bundle size not latency bound */
 
 #ifdef HIF_SDIO
 	A_UINT16 AltDataCreditSize;
@@ -215,6 +239,11 @@ typedef struct _HTC_TARGET {
 #define HTC_RX_BUNDLE_ENABLED(target) 0
 #endif
 
+/* weight of a new sample in the TX bundle averages is 1 / (1 << shift) */
+#define HTC_TX_BUNDLE_AVG_SHIFT 3
+/* bundling chances skipped by the latency cap before its estimate halves */
+#define HTC_TX_BUNDLE_DECAY_INTERVAL 64
+
 #define HTC_ENABLE_BUNDLE(target) (target->MaxMsgsPerHTCBundle > 1)
 
 #ifdef RX_SG_SUPPORT
@@ -232,6 +261,14 @@ typedef struct _HTC_TARGET {
 #define UNLOCK_HTC_RX(t)        qdf_spin_unlock_bh(&(t)->HTCRxLock);
 #define LOCK_HTC_TX(t)          qdf_spin_lock_bh(&(t)->HTCTxLock);
 #define UNLOCK_HTC_TX(t)        qdf_spin_unlock_bh(&(t)->HTCTxLock);
+/*
+ * TX lock order: an endpoint TX lock may be held while taking HTCTxLock or
+ * HTCCreditLock, never the other way round. At most one endpoint TX lock is
+ * held at a time; operations spanning endpoints, such as credit report
+ * processing, take and release each endpoint lock in turn.
+ */
+#define LOCK_HTC_EP_TX(ep)      qdf_spin_lock_bh(&(ep)->TxLock);
+#define UNLOCK_HTC_EP_TX(ep)    qdf_spin_unlock_bh(&(ep)->TxLock);
 #define LOCK_HTC_CREDIT(t)      qdf_spin_lock_bh(&(t)->HTCCreditLock);
 #define UNLOCK_HTC_CREDIT(t)    qdf_spin_unlock_bh(&(t)->HTCCreditLock);
 
@@ -258,11 +295,16 @@ typedef struct _HTC_TARGET {
 
 QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
 				   uint8_t pipeID);
+QDF_STATUS htc_rx_completion_handler_multiple(void *Context,
+					      qdf_nbuf_t *netbufs,
+					      uint32_t num, uint8_t pipeID);
 QDF_STATUS htc_tx_completion_handler(void *Context, qdf_nbuf_t netbuf,
 				   unsigned int transferID, uint32_t toeplitz_hash_result);
 
 HTC_PACKET *allocate_htc_bundle_packet(HTC_TARGET *target);
 void free_htc_bundle_packet(HTC_TARGET *target, HTC_PACKET *pPacket);
+void htc_tx_bundle_gather_init(HTC_TARGET *target);
+void htc_tx_bundle_gather_deinit(HTC_TARGET *target);
 
 HTC_PACKET *allocate_htc_packet_container(HTC_TARGET *target);
 void free_htc_packet_container(HTC_TARGET *target, HTC_PACKET *pPacket);
@@ -290,17 +332,17 @@ void htc_credit_record(htc_credit_exchange_type type, uint32_t tx_credit,
 
 static inline void htc_send_complete_poll_timer_stop(HTC_ENDPOINT *
 						     pEndpoint) {
-	LOCK_HTC_TX(pEndpoint->target);
+	LOCK_HTC_EP_TX(pEndpoint);
 	if (pEndpoint->ul_poll_timer_active) {
 		/* qdf_timer_stop(&pEndpoint->ul_poll_timer); */
 		pEndpoint->ul_poll_timer_active = 0;
 	}
-	UNLOCK_HTC_TX(pEndpoint->target);
+	UNLOCK_HTC_EP_TX(pEndpoint);
 }
 
 static inline void htc_send_complete_poll_timer_start(HTC_ENDPOINT *
 						      pEndpoint) {
-	LOCK_HTC_TX(pEndpoint->target);
+	LOCK_HTC_EP_TX(pEndpoint);
 	if (pEndpoint->ul_outstanding_cnt
 	    && !pEndpoint->ul_poll_timer_active) {
 		/*
@@ -309,7 +351,7 @@ static inline void htc_send_complete_poll_timer_start(HTC_ENDPOINT *
 		 */
 		pEndpoint->ul_poll_timer_active = 1;
 	}
-	UNLOCK_HTC_TX(pEndpoint->target);
+	UNLOCK_HTC_EP_TX(pEndpoint);
 }
 
 static inline void
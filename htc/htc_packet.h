@@ -124,6 +124,7 @@ typedef struct _HTC_PACKET {
 				can pass the network buffer corresponding to the HTC packet
 				lower layers may optimized the transfer knowing this is
 				a network buffer */
+	struct _HTC_PACKET *pTxLookupNext; /* next in the endpoint TxLookupHash bucket */
 } HTC_PACKET;
 
 #define COMPLETE_HTC_PACKET(p, status)	     \
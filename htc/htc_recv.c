@@ -139,6 +139,67 @@ static void recv_packet_completion(HTC_TARGET *target, HTC_ENDPOINT *pEndpoint,
 	do_recv_completion(pEndpoint, &container);
 }
 
+/**
+ * struct htc_rx_batch - rx packets waiting to be indicated together
+ * @pEndpoint: endpoint all packets in @queue belong to
+ * @queue: packets to indicate, in arrival order
+ * @pkts: containers of the packets in @queue, recycled after indication
+ * @count: number of packets in the batch
+ */
+struct htc_rx_batch {
+	HTC_ENDPOINT *pEndpoint;
+	HTC_PACKET_QUEUE queue;
+	HTC_PACKET *pkts[HTC_RX_BATCH_MAX];
+	int count;
+};
+
+static void free_htc_packet_containers(HTC_TARGET *target,
+				       HTC_PACKET **pkts, int count);
+
+/**
+ * htc_rx_batch_flush() - indicate the batched packets to their endpoint
+ * @target: HTC target
+ * @batch: batch to flush, left empty
+ *
+ * Return: None
+ */
+static void htc_rx_batch_flush(HTC_TARGET *target, struct htc_rx_batch *batch)
+{
+	if (!batch->count)
+		return;
+
+	do_recv_completion(batch->pEndpoint, &batch->queue);
+	/* recover the packet containers */
+	free_htc_packet_containers(target, batch->pkts, batch->count);
+	INIT_HTC_PACKET_QUEUE(&batch->queue);
+	batch->pEndpoint = NULL;
+	batch->count = 0;
+}
+
+/**
+ * htc_rx_batch_add() - add a received packet to the batch
+ * @target: HTC target
+ * @batch: batch to add to
+ * @pEndpoint: endpoint the packet was received on
+ * @pPacket: received packet
+ *
+ * The batch only holds packets of one endpoint, so it is flushed first
+ * when @pPacket belongs to another endpoint; this keeps the indication
+ * order identical to the arrival order.
+ *
+ * Return: None
+ */
+static void htc_rx_batch_add(HTC_TARGET *target, struct htc_rx_batch *batch,
+			     HTC_ENDPOINT *pEndpoint, HTC_PACKET *pPacket)
+{
+	if (batch->pEndpoint != pEndpoint || batch->count == HTC_RX_BATCH_MAX)
+		htc_rx_batch_flush(target, batch);
+
+	batch->pEndpoint = pEndpoint;
+	batch->pkts[batch->count++] = pPacket;
+	HTC_PACKET_ENQUEUE(&batch->queue, pPacket);
+}
+
 void htc_control_rx_complete(void *Context, HTC_PACKET *pPacket)
 {
 	/* TODO, can't really receive HTC control messages yet.... */
@@ -170,6 +231,75 @@ int htc_get_num_recv_buffers(HTC_HANDLE HTCHandle, HTC_ENDPOINT_ID Endpoint)
 	return HTC_PACKET_QUEUE_DEPTH(&pEndpoint->RxBufferHoldQueue);
 }
 
+/**
+ * htc_rx_nbuf_recycle_enable() - recycle the rx buffers of an endpoint
+ * @HTCHandle: HTC handle
+ * @Endpoint: connected endpoint
+ * @pool_size: receive buffers HIF may keep for reposting
+ *
+ * From now on every netbuf indicated to @Endpoint must be freed with
+ * htc_rx_nbuf_free(), or taken out of recycling with htc_rx_nbuf_release()
+ * before it is passed to code that frees it with qdf_nbuf_free().
+ *
+ * Return: A_OK, or A_ERROR if the bus does not support recycling
+ */
+A_STATUS htc_rx_nbuf_recycle_enable(HTC_HANDLE HTCHandle,
+				    HTC_ENDPOINT_ID Endpoint,
+				    uint32_t pool_size)
+{
+	HTC_TARGET *target = GET_HTC_TARGET_FROM_HANDLE(HTCHandle);
+	HTC_ENDPOINT *pEndpoint = &target->endpoint[Endpoint];
+	QDF_STATUS status;
+
+	status = hif_rx_nbuf_pool_enable(target->hif_dev, pEndpoint->DL_PipeID,
+					 pool_size);
+	if (status != QDF_STATUS_SUCCESS && status != QDF_STATUS_E_ALREADY)
+		return A_ERROR;
+
+	pEndpoint->RxRecycle = true;
+	return A_OK;
+}
+
+/**
+ * htc_rx_nbuf_free() - free a netbuf indicated to an endpoint
+ * @HTCHandle: HTC handle
+ * @Endpoint: endpoint @netbuf was indicated to
+ * @netbuf: received netbuf
+ *
+ * Return: None
+ */
+void htc_rx_nbuf_free(HTC_HANDLE HTCHandle, HTC_ENDPOINT_ID Endpoint,
+		      qdf_nbuf_t netbuf)
+{
+	HTC_TARGET *target = GET_HTC_TARGET_FROM_HANDLE(HTCHandle);
+	HTC_ENDPOINT *pEndpoint = &target->endpoint[Endpoint];
+
+	if (pEndpoint->RxRecycle)
+		hif_rx_nbuf_recycle(target->hif_dev, pEndpoint->DL_PipeID,
+				    netbuf);
+	else
+		qdf_nbuf_free(netbuf);
+}
+
+/**
+ * htc_rx_nbuf_release() - take a netbuf of an endpoint out of recycling
+ * @HTCHandle: HTC handle
+ * @Endpoint: endpoint @netbuf was indicated to
+ * @netbuf: received netbuf, may then be freed with qdf_nbuf_free()
+ *
+ * Return: None
+ */
+void htc_rx_nbuf_release(HTC_HANDLE HTCHandle, HTC_ENDPOINT_ID Endpoint,
+			 qdf_nbuf_t netbuf)
+{
+	HTC_TARGET *target = GET_HTC_TARGET_FROM_HANDLE(HTCHandle);
+	HTC_ENDPOINT *pEndpoint = &target->endpoint[Endpoint];
+
+	if (pEndpoint->RxRecycle)
+		hif_rx_nbuf_release(target->hif_dev, pEndpoint->DL_PipeID,
+				    netbuf);
+}
+
 HTC_PACKET *allocate_htc_packet_container(HTC_TARGET *target)
 {
 	HTC_PACKET *pPacket;
@@ -206,6 +336,28 @@ void free_htc_packet_container(HTC_TARGET *target, HTC_PACKET *pPacket)
 	UNLOCK_HTC_RX(target);
 }
 
+/**
+ * free_htc_packet_containers() - return several containers to the pool
+ * @target: HTC target
+ * @pkts: containers to free
+ * @count: number of entries in @pkts
+ *
+ * Return: None
+ */
+static void free_htc_packet_containers(HTC_TARGET *target,
+				       HTC_PACKET **pkts, int count)
+{
+	int i;
+
+	LOCK_HTC_RX(target);
+	for (i = 0; i < count; i++) {
+		pkts[i]->ListLink.pNext =
+			(DL_LIST *) target->pHTCPacketStructPool;
+		target->pHTCPacketStructPool = pkts[i];
+	}
+	UNLOCK_HTC_RX(target);
+}
+
 #ifdef RX_SG_SUPPORT
 qdf_nbuf_t rx_sg_to_single_netbuf(HTC_TARGET *target)
 {
@@ -262,12 +414,25 @@ _failed:
 #define HTC_MSG_NACK_SUSPEND 7
 #endif
 
-QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
-				   uint8_t pipeID)
+/**
+ * htc_rx_netbuf() - process a message received from HIF
+ * @target: HTC target
+ * @netbuf: received message, consumed
+ * @pipe_id: pipe @netbuf was received on
+ * @batch: batch to add the resulting packet to, NULL to indicate it
+ *	right away
+ *
+ * Messages HTC consumes itself go back to HIF for recycling. Messages
+ * indicated to an endpoint that did not enable recycling are released
+ * from HIF first, since the endpoint frees them with qdf_nbuf_free().
+ *
+ * Return: QDF_STATUS_SUCCESS or an error status
+ */
+static QDF_STATUS htc_rx_netbuf(HTC_TARGET *target, qdf_nbuf_t netbuf,
+				uint8_t pipe_id, struct htc_rx_batch *batch)
 {
 	QDF_STATUS status = QDF_STATUS_SUCCESS;
 	HTC_FRAME_HDR *HtcHdr;
-	HTC_TARGET *target = (HTC_TARGET *) Context;
 	uint8_t *netdata;
 	uint32_t netlen;
 	HTC_ENDPOINT *pEndpoint;
@@ -279,6 +444,8 @@ QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
 #ifdef RX_SG_SUPPORT
 	LOCK_HTC_RX(target);
 	if (target->IsRxSgInprogress) {
+		/* the fragments are copied and freed */
+		hif_rx_nbuf_release(target->hif_dev, pipe_id, netbuf);
 		target->CurRxSgTotalLen += qdf_nbuf_len(netbuf);
 		qdf_nbuf_queue_add(&target->RxSgQueue, netbuf);
 		if (target->CurRxSgTotalLen == target->ExpRxSgTotalLen) {
@@ -332,6 +499,7 @@ QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
 
 		if (netlen < (payloadLen + HTC_HDR_LENGTH)) {
 #ifdef RX_SG_SUPPORT
+			hif_rx_nbuf_release(target->hif_dev, pipe_id, netbuf);
 			LOCK_HTC_RX(target);
 			target->IsRxSgInprogress = true;
 			qdf_nbuf_queue_init(&target->RxSgQueue);
@@ -480,7 +648,7 @@ QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
 				break;
 			}
 
-			qdf_nbuf_free(netbuf);
+			hif_rx_nbuf_recycle(target->hif_dev, pipe_id, netbuf);
 			netbuf = NULL;
 			break;
 		}
@@ -490,6 +658,11 @@ QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
 		 * we form the packets here
 		 * TODO_FIXME */
 		pPacket = allocate_htc_packet_container(target);
+		if (NULL == pPacket && batch && batch->count) {
+			/* containers held by batches, recover ours and retry */
+			htc_rx_batch_flush(target, batch);
+			pPacket = allocate_htc_packet_container(target);
+		}
 		if (NULL == pPacket) {
 			status = QDF_STATUS_E_RESOURCES;
 			break;
@@ -502,10 +675,16 @@ QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
 
 		qdf_nbuf_pull_head(netbuf, HTC_HEADER_LEN);
 		qdf_nbuf_set_pktlen(netbuf, pPacket->ActualLength);
+		if (!pEndpoint->RxRecycle)
+			hif_rx_nbuf_release(target->hif_dev, pipe_id, netbuf);
 
-		recv_packet_completion(target, pEndpoint, pPacket);
-		/* recover the packet container */
-		free_htc_packet_container(target, pPacket);
+		if (batch) {
+			htc_rx_batch_add(target, batch, pEndpoint, pPacket);
+		} else {
+			recv_packet_completion(target, pEndpoint, pPacket);
+			/* recover the packet container */
+			free_htc_packet_container(target, pPacket);
+		}
 		netbuf = NULL;
 
 	} while (false);
@@ -514,14 +693,55 @@ QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
 _out:
 #endif
 
-	if (netbuf != NULL) {
-		qdf_nbuf_free(netbuf);
-	}
+	if (netbuf != NULL)
+		hif_rx_nbuf_recycle(target->hif_dev, pipe_id, netbuf);
 
 	return status;
 
 }
 
+QDF_STATUS htc_rx_completion_handler(void *Context, qdf_nbuf_t netbuf,
+				   uint8_t pipeID)
+{
+	return htc_rx_netbuf((HTC_TARGET *) Context, netbuf, pipeID, NULL);
+}
+
+/**
+ * htc_rx_completion_handler_multiple() - process messages reaped together
+ * @Context: HTC target
+ * @netbufs: received messages, in arrival order
+ * @num: number of entries in @netbufs
+ * @pipeID: pipe the messages were received on
+ *
+ * Consecutive messages of one endpoint are indicated with a single call
+ * to its EpRecvPktMultiple handler, if it registered one.
+ *
+ * Return: QDF_STATUS_SUCCESS, or the last error status seen
+ */
+QDF_STATUS htc_rx_completion_handler_multiple(void *Context,
+					      qdf_nbuf_t *netbufs,
+					      uint32_t num, uint8_t pipeID)
+{
+	HTC_TARGET *target = (HTC_TARGET *) Context;
+	QDF_STATUS status = QDF_STATUS_SUCCESS;
+	QDF_STATUS ret;
+	struct htc_rx_batch batch;
+	uint32_t i;
+
+	batch.pEndpoint = NULL;
+	batch.count = 0;
+	INIT_HTC_PACKET_QUEUE(&batch.queue);
+
+	for (i = 0; i < num; i++) {
+		ret = htc_rx_netbuf(target, netbufs[i], pipeID, &batch);
+		if (QDF_IS_STATUS_ERROR(ret))
+			status = ret;
+	}
+	htc_rx_batch_flush(target, &batch);
+
+	return status;
+}
+
 A_STATUS htc_add_receive_pkt_multiple(HTC_HANDLE HTCHandle,
 				      HTC_PACKET_QUEUE *pPktQueue)
 {
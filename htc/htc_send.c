@@ -29,6 +29,7 @@
 #include "htc_internal.h"
 #include <qdf_mem.h>            /* qdf_mem_malloc */
 #include <qdf_nbuf.h>           /* qdf_nbuf_t */
+#include <qdf_time.h>           /* qdf_get_monotonic_boottime */
 
 
 /* #define USB_HIF_SINGLE_PIPE_DATA_SCHED */
@@ -53,6 +54,66 @@ static unsigned ep_debug_mask =
 	(1 << ENDPOINT_0) | (1 << ENDPOINT_1) | (1 << ENDPOINT_2);
 #endif
 
+/**
+ * htc_tx_lookup_hash() - TxLookupHash bucket of a netbuf
+ * @netbuf: netbuf handed to HIF
+ *
+ * Return: bucket index
+ */
+static inline uint32_t htc_tx_lookup_hash(qdf_nbuf_t netbuf)
+{
+	uintptr_t key = (uintptr_t)netbuf;
+
+	/* netbufs are slab objects, drop the bits their alignment fixes */
+	return ((key >> 6) ^ (key >> 12)) & (HTC_TX_LOOKUP_HASH_SIZE - 1);
+}
+
+/**
+ * htc_tx_lookup_add() - track a packet handed to HIF
+ * @pEndpoint: endpoint the packet is sent on
+ * @pPacket: packet, its netbuf context must be set
+ *
+ * The packet is queued to TxLookupQueue and indexed by netbuf so that its
+ * completion is matched without walking the queue. Called with the HTC tx
+ * lock held.
+ *
+ * Return: None
+ */
+static inline void htc_tx_lookup_add(HTC_ENDPOINT *pEndpoint,
+				     HTC_PACKET *pPacket)
+{
+	HTC_PACKET **bucket = &pEndpoint->TxLookupHash[htc_tx_lookup_hash(
+				GET_HTC_PACKET_NET_BUF_CONTEXT(pPacket))];
+
+	HTC_PACKET_ENQUEUE(&pEndpoint->TxLookupQueue, pPacket);
+	pPacket->pTxLookupNext = *bucket;
+	*bucket = pPacket;
+}
+
+/**
+ * htc_tx_lookup_remove() - stop tracking a packet handed to HIF
+ * @pEndpoint: endpoint the packet was sent on
+ * @pPacket: packet added with htc_tx_lookup_add()
+ *
+ * Called with the HTC tx lock held.
+ *
+ * Return: None
+ */
+static inline void htc_tx_lookup_remove(HTC_ENDPOINT *pEndpoint,
+					HTC_PACKET *pPacket)
+{
+	HTC_PACKET **link = &pEndpoint->TxLookupHash[htc_tx_lookup_hash(
+				GET_HTC_PACKET_NET_BUF_CONTEXT(pPacket))];
+
+	while (*link && *link != pPacket)
+		link = &(*link)->pTxLookupNext;
+	if (*link)
+		*link = pPacket->pTxLookupNext;
+	pPacket->pTxLookupNext = NULL;
+
+	HTC_PACKET_REMOVE(&pEndpoint->TxLookupQueue, pPacket);
+}
+
 /* HTC Control Path Credit History */
 uint32_t g_htc_credit_history_idx = 0;
 HTC_CREDIT_HISTORY htc_credit_history_buffer[HTC_CREDIT_HISTORY_MAX];
@@ -94,7 +155,8 @@ void htc_dump_counter_info(HTC_HANDLE HTCHandle)
 
 	AR_DEBUG_PRINTF(ATH_DEBUG_ERR,
 			("\n%s: ce_send_cnt = %d, TX_comp_cnt = %d\n",
-			 __func__, target->ce_send_cnt, target->TX_comp_cnt));
+			 __func__, qdf_atomic_read(&target->ce_send_cnt),
+			 target->TX_comp_cnt));
 }
 
 void htc_get_control_endpoint_tx_host_credits(HTC_HANDLE HTCHandle, int *credits)
@@ -109,15 +171,15 @@ void htc_get_control_endpoint_tx_host_credits(HTC_HANDLE HTCHandle, int *credits
 	}
 
 	*credits = 0;
-	LOCK_HTC_TX(target);
 	for (i = 0; i < ENDPOINT_MAX; i++) {
 		pEndpoint = &target->endpoint[i];
 		if (pEndpoint->service_id == WMI_CONTROL_SVC) {
+			LOCK_HTC_EP_TX(pEndpoint);
 			*credits = pEndpoint->TxCredits;
+			UNLOCK_HTC_EP_TX(pEndpoint);
 			break;
 		}
 	}
-	UNLOCK_HTC_TX(target);
 }
 
 static inline void restore_tx_packet(HTC_TARGET *target, HTC_PACKET *pPacket)
@@ -339,6 +401,76 @@ htc_issue_tx_bundle_stats_inc(HTC_TARGET *target)
 }
 #endif
 
+/**
+ * htc_tx_bundle_probe_start() - start measuring the latency of a bundle
+ * @pEndpoint: endpoint the bundle is sent on
+ * @pPacketTx: bundle packet about to be handed to HIF
+ *
+ * Only one bundle per endpoint is measured at a time, the others are
+ * sent unobserved.
+ *
+ * Return: None
+ */
+static inline void htc_tx_bundle_probe_start(HTC_ENDPOINT *pEndpoint,
+					     HTC_PACKET *pPacketTx)
+{
+	LOCK_HTC_EP_TX(pEndpoint);
+	if (!pEndpoint->TxBundleProbe) {
+		pEndpoint->TxBundleProbe = pPacketTx;
+		pEndpoint->TxBundleProbeTs = qdf_get_monotonic_boottime();
+	}
+	UNLOCK_HTC_EP_TX(pEndpoint);
+}
+
+/**
+ * htc_tx_bundle_probe_cancel() - forget a bundle that failed to send
+ * @pEndpoint: endpoint the bundle was sent on
+ * @pPacketTx: bundle packet
+ *
+ * Return: None
+ */
+static inline void htc_tx_bundle_probe_cancel(HTC_ENDPOINT *pEndpoint,
+					      HTC_PACKET *pPacketTx)
+{
+	LOCK_HTC_EP_TX(pEndpoint);
+	if (pEndpoint->TxBundleProbe == pPacketTx)
+		pEndpoint->TxBundleProbe = NULL;
+	UNLOCK_HTC_EP_TX(pEndpoint);
+}
+
+/**
+ * htc_tx_bundle_probe_done() - account the latency of a completed bundle
+ * @pEndpoint: endpoint the bundle was sent on
+ * @pPacketTx: completed bundle packet
+ * @msgs: number of messages carried by the bundle
+ *
+ * Return: None
+ */
+static void htc_tx_bundle_probe_done(HTC_ENDPOINT *pEndpoint,
+				     HTC_PACKET *pPacketTx, int msgs)
+{
+	uint32_t sample;
+
+	LOCK_HTC_EP_TX(pEndpoint);
+	if (pEndpoint->TxBundleProbe != pPacketTx || msgs <= 0) {
+		UNLOCK_HTC_EP_TX(pEndpoint);
+		return;
+	}
+	pEndpoint->TxBundleProbe = NULL;
+	sample = (uint32_t)(qdf_get_monotonic_boottime() -
+			    pEndpoint->TxBundleProbeTs) / msgs;
+	if (!sample)
+		sample = 1;
+	if (!pEndpoint->TxBundleMsgLatencyUs)
+		pEndpoint->TxBundleMsgLatencyUs = sample;
+	else
+		pEndpoint->TxBundleMsgLatencyUs =
+			(pEndpoint->TxBundleMsgLatencyUs *
+			 ((1 << HTC_TX_BUNDLE_AVG_SHIFT) - 1) + sample) >>
+			HTC_TX_BUNDLE_AVG_SHIFT;
+	UNLOCK_HTC_EP_TX(pEndpoint);
+}
+
 #if defined(HIF_USB) || defined(HIF_SDIO)
 #ifdef ENABLE_BUNDLE_TX
 static A_STATUS htc_send_bundled_netbuf(HTC_TARGET *target,
@@ -359,9 +491,9 @@ static A_STATUS htc_send_bundled_netbuf(HTC_TARGET *target,
 			       pBundleBuffer,
 			       data_len,
 			       pEndpoint->Id, HTC_TX_PACKET_TAG_BUNDLED);
-	LOCK_HTC_TX(target);
-	HTC_PACKET_ENQUEUE(&pEndpoint->TxLookupQueue, pPacketTx);
-	UNLOCK_HTC_TX(target);
+	LOCK_HTC_EP_TX(pEndpoint);
+	htc_tx_lookup_add(pEndpoint, pPacketTx);
+	UNLOCK_HTC_EP_TX(pEndpoint);
 #if DEBUG_BUNDLE
 	qdf_print(" Send bundle EP%d buffer size:0x%x, total:0x%x, count:%d.\n",
 		  pEndpoint->Id,
@@ -383,6 +515,273 @@ static A_STATUS htc_send_bundled_netbuf(HTC_TARGET *target,
 	return status;
 }
 
+/**
+ * htc_tx_bundle_pad_needs_map() - whether the bus gathers by DMA address
+ * @target: HTC target
+ *
+ * Return: true if the credit padding must be DMA mapped for the bus
+ */
+static bool htc_tx_bundle_pad_needs_map(HTC_TARGET *target)
+{
+	switch (hif_get_bus_type(target->hif_dev)) {
+	case QDF_BUS_TYPE_USB:
+	case QDF_BUS_TYPE_SDIO:
+		return false;
+	default:
+		return true;
+	}
+}
+
+/**
+ * htc_tx_bundle_gather_init() - enable zero-copy TX bundling if HIF can
+ * @target: HTC target
+ *
+ * When the bus can send one transfer gathered from several buffers, TX
+ * bundles are described to HIF as a list of the original frames and
+ * their credit padding instead of being copied into the bundle buffer.
+ *
+ * Return: None
+ */
+void htc_tx_bundle_gather_init(HTC_TARGET *target)
+{
+	uint8_t ul_pipe, dl_pipe;
+	uint32_t max_frags;
+
+	if (!HTC_TX_BUNDLE_ENABLED(target) || target->TxBundleFrags)
+		return;
+
+	hif_get_default_pipe(target->hif_dev, &ul_pipe, &dl_pipe);
+	max_frags = hif_get_max_gather_frags(target->hif_dev, ul_pipe);
+	/* a gather list must at least hold two messages and their padding */
+	if (max_frags < 2 * HTC_MIN_MSG_PER_BUNDLE)
+		return;
+
+	target->TxBundlePad = qdf_mem_malloc(target->TargetCreditSize);
+	target->TxBundleFrags = qdf_mem_malloc(ENDPOINT_MAX * max_frags *
+					       sizeof(struct hif_gather_frag));
+	if (!target->TxBundlePad || !target->TxBundleFrags) {
+		htc_tx_bundle_gather_deinit(target);
+		return;
+	}
+
+	/*
+	 * USB and SDIO take the padding by its virtual address, only a copy
+	 * engine gathers by bus address and needs the padding mapped.
+	 */
+	if (htc_tx_bundle_pad_needs_map(target)) {
+		uint32_t paddr = 0;
+
+		if (qdf_mem_map_nbytes_single(target->osdev,
+					      target->TxBundlePad,
+					      QDF_DMA_TO_DEVICE,
+					      target->TargetCreditSize,
+					      &paddr) != QDF_STATUS_SUCCESS) {
+			htc_tx_bundle_gather_deinit(target);
+			return;
+		}
+		target->TxBundlePadPaddr = paddr;
+	}
+
+	target->TxBundleMaxFrags = max_frags;
+	AR_DEBUG_PRINTF(ATH_DEBUG_INIT,
+			("HTC zero-copy TX bundling, %d fragments per bundle\n",
+			 max_frags));
+}
+
+/**
+ * htc_tx_bundle_gather_deinit() - free the zero-copy TX bundling resources
+ * @target: HTC target
+ *
+ * Return: None
+ */
+void htc_tx_bundle_gather_deinit(HTC_TARGET *target)
+{
+	if (target->TxBundlePadPaddr)
+		qdf_mem_unmap_nbytes_single(target->osdev,
+					    target->TxBundlePadPaddr,
+					    QDF_DMA_TO_DEVICE,
+					    target->TargetCreditSize);
+	if (target->TxBundlePad)
+		qdf_mem_free(target->TxBundlePad);
+	if (target->TxBundleFrags)
+		qdf_mem_free(target->TxBundleFrags);
+	target->TxBundlePad = NULL;
+	target->TxBundlePadPaddr = 0;
+	target->TxBundleFrags = NULL;
+	target->TxBundleMaxFrags = 0;
+}
+
+/**
+ * htc_send_bundled_gather() - send a bundle as a gather list
+ * @target: HTC target
+ * @pEndpoint: endpoint the bundle is sent on
+ * @pBundleBuffer: end of the bundle as if it had been copied
+ * @pPacketTx: bundle packet holding the bundled messages
+ * @frags: message fragments and credit padding, in wire order
+ * @nfrags: number of fragments
+ *
+ * The bundle netbuf carries only a copy of the first HTC header, which
+ * is what the USB completion path uses to find the endpoint. If HIF has
+ * no resources for the gathered transfer, the fragments are copied into
+ * the bundle netbuf and sent the usual way, so nothing is dropped.
+ *
+ * Return: A_OK on success or an A_STATUS error
+ */
+static A_STATUS htc_send_bundled_gather(HTC_TARGET *target,
+					HTC_ENDPOINT *pEndpoint,
+					unsigned char *pBundleBuffer,
+					HTC_PACKET *pPacketTx,
+					struct hif_gather_frag *frags,
+					uint32_t nfrags)
+{
+	qdf_size_t data_len;
+	QDF_STATUS status;
+	qdf_nbuf_t bundleBuf;
+	unsigned char *pCopy;
+	uint32_t i;
+
+	bundleBuf = GET_HTC_PACKET_NET_BUF_CONTEXT(pPacketTx);
+	data_len = pBundleBuffer - qdf_nbuf_data(bundleBuf);
+	qdf_mem_copy(qdf_nbuf_data(bundleBuf), frags[0].vaddr, HTC_HDR_LENGTH);
+	qdf_nbuf_put_tail(bundleBuf, HTC_HDR_LENGTH);
+	SET_HTC_PACKET_INFO_TX(pPacketTx,
+			       target,
+			       qdf_nbuf_data(bundleBuf),
+			       data_len,
+			       pEndpoint->Id, HTC_TX_PACKET_TAG_BUNDLED);
+	LOCK_HTC_EP_TX(pEndpoint);
+	htc_tx_lookup_add(pEndpoint, pPacketTx);
+	UNLOCK_HTC_EP_TX(pEndpoint);
+#if DEBUG_BUNDLE
+	qdf_print(" Send gather EP%d buffer size:0x%x, total:0x%x, frags:%d.\n",
+		  pEndpoint->Id,
+		  pEndpoint->TxCreditSize,
+		  data_len, nfrags);
+#endif
+
+	status = hif_send_gather(target->hif_dev, pEndpoint->UL_PipeID,
+				 pEndpoint->Id, data_len, frags, nfrags,
+				 bundleBuf);
+	if (status == QDF_STATUS_SUCCESS) {
+		htc_send_update_tx_bundle_stats(target, data_len,
+						pEndpoint->TxCreditSize);
+		return A_OK;
+	}
+
+	LOCK_HTC_EP_TX(pEndpoint);
+	htc_tx_lookup_remove(pEndpoint, pPacketTx);
+	UNLOCK_HTC_EP_TX(pEndpoint);
+	qdf_nbuf_trim_tail(bundleBuf, HTC_HDR_LENGTH);
+
+	pCopy = qdf_nbuf_data(bundleBuf);
+	for (i = 0; i < nfrags; i++) {
+		qdf_mem_copy(pCopy, frags[i].vaddr, frags[i].len);
+		pCopy += frags[i].len;
+	}
+
+	return htc_send_bundled_netbuf(target, pEndpoint, pCopy, pPacketTx);
+}
+
+/**
+ * htc_send_bundle() - send a bundle built by htc_issue_packets_bundle()
+ * @target: HTC target
+ * @pEndpoint: endpoint the bundle is sent on
+ * @pBundleBuffer: end of the bundle data
+ * @pPacketTx: bundle packet holding the bundled messages
+ * @frags: gather list, NULL if the messages were copied
+ * @nfrags: number of entries in @frags
+ * @last_credit_pad: padding of the last message that is not sent
+ *
+ * Return: A_OK on success or an A_STATUS error
+ */
+static A_STATUS htc_send_bundle(HTC_TARGET *target,
+				HTC_ENDPOINT *pEndpoint,
+				unsigned char *pBundleBuffer,
+				HTC_PACKET *pPacketTx,
+				struct hif_gather_frag *frags,
+				uint32_t nfrags, int last_credit_pad)
+{
+	A_STATUS status;
+
+	htc_tx_bundle_probe_start(pEndpoint, pPacketTx);
+
+	if (!frags) {
+		status = htc_send_bundled_netbuf(target, pEndpoint,
+						 pBundleBuffer, pPacketTx);
+	} else {
+		/* the padding of the last message is its own fragment */
+		if (last_credit_pad)
+			nfrags--;
+
+		status = htc_send_bundled_gather(target, pEndpoint,
+						 pBundleBuffer, pPacketTx,
+						 frags, nfrags);
+	}
+
+	if (status != A_OK)
+		htc_tx_bundle_probe_cancel(pEndpoint, pPacketTx);
+
+	return status;
+}
+
+/**
+ * htc_tx_bundle_adapt() - choose the size of the next bundles of an endpoint
+ * @target: HTC target
+ * @pEndpoint: endpoint about to bundle
+ * @depth: number of messages ready to be bundled
+ *
+ * The size follows the average ready queue depth, so that a bundle does
+ * not wait for room it will not fill. While the endpoint still holds
+ * credits it is also capped to keep the measured bus time of a bundle
+ * under TxBundleLatencyTargetUs; a credit starved endpoint is waiting on
+ * the target anyway and bundles as much as it can to save bus cycles.
+ *
+ * A cap below HTC_MIN_MSG_PER_BUNDLE stops bundling, and with it the
+ * latency samples that would lift the cap again. The estimate is halved
+ * every HTC_TX_BUNDLE_DECAY_INTERVAL bundles skipped this way, so the
+ * endpoint eventually sends a probe bundle and measures the bus again.
+ *
+ * Return: max number of credit sized messages per bundle
+ */
+static int htc_tx_bundle_adapt(HTC_TARGET *target, HTC_ENDPOINT *pEndpoint,
+			       int depth)
+{
+	int size = target->MaxMsgsPerHTCBundle;
+	uint32_t avg, cap;
+	bool starved;
+
+	LOCK_HTC_EP_TX(pEndpoint);
+	pEndpoint->TxBundleAvgDepth += depth -
+		(pEndpoint->TxBundleAvgDepth >> HTC_TX_BUNDLE_AVG_SHIFT);
+	avg = (pEndpoint->TxBundleAvgDepth +
+	       (1 << (HTC_TX_BUNDLE_AVG_SHIFT - 1))) >> HTC_TX_BUNDLE_AVG_SHIFT;
+	if (avg < size)
+		size = avg < HTC_MIN_MSG_PER_BUNDLE ?
+		       HTC_MIN_MSG_PER_BUNDLE : avg;
+
+	starved = IS_TX_CREDIT_FLOW_ENABLED(pEndpoint) &&
+		  pEndpoint->TxCredits < pEndpoint->TxCreditsPerMaxMsg;
+	if (target->TxBundleLatencyTargetUs &&
+	    pEndpoint->TxBundleMsgLatencyUs && !starved) {
+		cap = target->TxBundleLatencyTargetUs /
+		      pEndpoint->TxBundleMsgLatencyUs;
+		if (cap < size)
+			size = cap;
+		if (cap < HTC_MIN_MSG_PER_BUNDLE &&
+		    ++pEndpoint->TxBundleCapped >=
+		    HTC_TX_BUNDLE_DECAY_INTERVAL) {
+			pEndpoint->TxBundleCapped = 0;
+			pEndpoint->TxBundleMsgLatencyUs >>= 1;
+		}
+	}
+	if (size < 1)
+		size = 1;
+	pEndpoint->TxBundleSize = size;
+	UNLOCK_HTC_EP_TX(pEndpoint);
+
+	return size;
+}
+
 /**
  * htc_issue_packets_bundle() - HTC function to send bundle packets from a queue
  * @target: HTC target on which packets need to be sent
@@ -404,9 +803,20 @@ static void htc_issue_packets_bundle(HTC_TARGET *target,
 	int creditPad, creditRemainder, transferLength, bundlesSpaceRemaining =
 		0;
 	HTC_PACKET_QUEUE *pQueueSave = NULL;
+	struct hif_gather_frag *frags = NULL;
+	uint32_t nfrags = 0;
+	int bundle_size;
+
+	bundle_size = htc_tx_bundle_adapt(target, pEndpoint,
+					  HTC_PACKET_QUEUE_DEPTH(pPktQueue));
+	if (bundle_size < HTC_MIN_MSG_PER_BUNDLE)
+		return;
+
+	if (target->TxBundleMaxFrags)
+		frags = &target->TxBundleFrags[pEndpoint->Id *
+					       target->TxBundleMaxFrags];
 
-	bundlesSpaceRemaining =
-		target->MaxMsgsPerHTCBundle * pEndpoint->TxCreditSize;
+	bundlesSpaceRemaining = bundle_size * pEndpoint->TxCreditSize;
 	pPacketTx = allocate_htc_bundle_packet(target);
 	if (!pPacketTx) {
 		/* good time to panic */
@@ -436,18 +846,25 @@ static void htc_issue_packets_bundle(HTC_TARGET *target,
 			transferLength += creditPad;
 		}
 
-		if (bundlesSpaceRemaining < transferLength) {
+		netbuf = GET_HTC_PACKET_NET_BUF_CONTEXT(pPacket);
+		frag_count = qdf_nbuf_get_num_frags(netbuf);
+
+		if (bundlesSpaceRemaining < transferLength ||
+		    (frags && nfrags + frag_count + 1 >
+		     target->TxBundleMaxFrags)) {
 			/* send out previous buffer */
-			htc_send_bundled_netbuf(target, pEndpoint,
-						pBundleBuffer - last_credit_pad,
-						pPacketTx);
+			htc_send_bundle(target, pEndpoint,
+					pBundleBuffer - last_credit_pad,
+					pPacketTx, frags, nfrags,
+					last_credit_pad);
 			if (HTC_PACKET_QUEUE_DEPTH(pPktQueue) <
 			    HTC_MIN_MSG_PER_BUNDLE) {
+				/* let the caller send it unbundled */
+				HTC_PACKET_ENQUEUE_TO_HEAD(pPktQueue, pPacket);
 				return;
 			}
 			bundlesSpaceRemaining =
-				target->MaxMsgsPerHTCBundle *
-				pEndpoint->TxCreditSize;
+				bundle_size * pEndpoint->TxCreditSize;
 			pPacketTx = allocate_htc_bundle_packet(target);
 			if (!pPacketTx) {
 				/* good time to panic */
@@ -459,10 +876,10 @@ static void htc_issue_packets_bundle(HTC_TARGET *target,
 			bundleBuf = GET_HTC_PACKET_NET_BUF_CONTEXT(pPacketTx);
 			pBundleBuffer = qdf_nbuf_data(bundleBuf);
 			pQueueSave = (HTC_PACKET_QUEUE *) pPacketTx->pContext;
+			nfrags = 0;
 		}
 
 		bundlesSpaceRemaining -= transferLength;
-		netbuf = GET_HTC_PACKET_NET_BUF_CONTEXT(pPacket);
 
 		if (hif_get_bus_type(target->hif_dev) != QDF_BUS_TYPE_USB) {
 				pHtcHdr =
@@ -482,7 +899,6 @@ static void htc_issue_packets_bundle(HTC_TARGET *target,
 				HTC_FRAME_HDR_RESERVED));
 			pHtcHdr->reserved = creditPad;
 		}
-		frag_count = qdf_nbuf_get_num_frags(netbuf);
 		nbytes = pPacket->ActualLength + HTC_HDR_LENGTH;
 		for (i = 0; i < frag_count && nbytes > 0; i++) {
 			int frag_len = qdf_nbuf_get_frag_len(netbuf, i);
@@ -491,11 +907,26 @@ static void htc_issue_packets_bundle(HTC_TARGET *target,
 			if (frag_len > nbytes) {
 				frag_len = nbytes;
 			}
-			qdf_mem_copy(pBundleBuffer, frag_addr, frag_len);
+			if (frags) {
+				frags[nfrags].vaddr = frag_addr;
+				frags[nfrags].paddr =
+					qdf_nbuf_get_frag_paddr(netbuf, i);
+				frags[nfrags].len = frag_len;
+				nfrags++;
+			} else {
+				qdf_mem_copy(pBundleBuffer, frag_addr,
+					     frag_len);
+			}
 			nbytes -= frag_len;
 			pBundleBuffer += frag_len;
 		}
 		HTC_PACKET_ENQUEUE(pQueueSave, pPacket);
+		if (frags && creditPad) {
+			frags[nfrags].vaddr = target->TxBundlePad;
+			frags[nfrags].paddr = target->TxBundlePadPaddr;
+			frags[nfrags].len = creditPad;
+			nfrags++;
+		}
 		pBundleBuffer += creditPad;
 
 		if (hif_get_bus_type(target->hif_dev) == QDF_BUS_TYPE_USB) {
@@ -506,15 +937,23 @@ static void htc_issue_packets_bundle(HTC_TARGET *target,
 	}
 	if (pBundleBuffer != qdf_nbuf_data(bundleBuf)) {
 		/* send out remaining buffer */
-		htc_send_bundled_netbuf(target, pEndpoint,
-					pBundleBuffer - last_credit_pad,
-					pPacketTx);
+		htc_send_bundle(target, pEndpoint,
+				pBundleBuffer - last_credit_pad,
+				pPacketTx, frags, nfrags, last_credit_pad);
 	} else {
 		free_htc_bundle_packet(target, pPacketTx);
 	}
 }
 #endif /* ENABLE_BUNDLE_TX */
 #else
+void htc_tx_bundle_gather_init(HTC_TARGET *target)
+{
+}
+
+void htc_tx_bundle_gather_deinit(HTC_TARGET *target)
+{
+}
+
 static void htc_issue_packets_bundle(HTC_TARGET *target,
 				     HTC_ENDPOINT *pEndpoint,
 				     HTC_PACKET_QUEUE *pPktQueue)
@@ -615,12 +1054,12 @@ static A_STATUS htc_issue_packets(HTC_TARGET *target,
 						     (pPacket), QDF_DMA_TO_DEVICE);
 			}
 		}
-		LOCK_HTC_TX(target);
+		LOCK_HTC_EP_TX(pEndpoint);
 		/* store in look up queue to match completions */
-		HTC_PACKET_ENQUEUE(&pEndpoint->TxLookupQueue, pPacket);
+		htc_tx_lookup_add(pEndpoint, pPacket);
 		INC_HTC_EP_STAT(pEndpoint, TxIssued, 1);
 		pEndpoint->ul_outstanding_cnt++;
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 
 		hif_send_complete_check(target->hif_dev, pEndpoint->UL_PipeID, false);
 		status = hif_send_head(target->hif_dev,
@@ -635,7 +1074,7 @@ static A_STATUS htc_issue_packets(HTC_TARGET *target,
 #endif
 		htc_issue_tx_bundle_stats_inc(target);
 
-		target->ce_send_cnt++;
+		qdf_atomic_inc(&target->ce_send_cnt);
 
 		if (qdf_unlikely(A_FAILED(status))) {
 			if (status != A_NO_RESOURCE) {
@@ -645,16 +1084,16 @@ static A_STATUS htc_issue_packets(HTC_TARGET *target,
 						("hif_send Failed status:%d \n",
 						 status));
 			}
-			LOCK_HTC_TX(target);
-			target->ce_send_cnt--;
+			qdf_atomic_dec(&target->ce_send_cnt);
+			LOCK_HTC_EP_TX(pEndpoint);
 			pEndpoint->ul_outstanding_cnt--;
-			HTC_PACKET_REMOVE(&pEndpoint->TxLookupQueue, pPacket);
+			htc_tx_lookup_remove(pEndpoint, pPacket);
 			/* reclaim credits */
 				pEndpoint->TxCredits +=
 					pPacket->PktInfo.AsTx.CreditsUsed;
 			/* put it back into the callers queue */
 			HTC_PACKET_ENQUEUE_TO_HEAD(pPktQueue, pPacket);
-			UNLOCK_HTC_TX(target);
+			UNLOCK_HTC_EP_TX(pEndpoint);
 			break;
 		}
 
@@ -1109,7 +1548,7 @@ static HTC_SEND_QUEUE_RESULT htc_try_send(HTC_TARGET *target,
 		tx_resources = 0;
 	}
 
-	LOCK_HTC_TX(target);
+	LOCK_HTC_EP_TX(pEndpoint);
 
 	if (!HTC_QUEUE_EMPTY(&sendQueue)) {
 		/* transfer packets to tail */
@@ -1124,7 +1563,7 @@ static HTC_SEND_QUEUE_RESULT htc_try_send(HTC_TARGET *target,
 		/* another thread or task is draining the TX queues on this endpoint
 		 * that thread will reset the tx processing count when the queue is drained */
 		qdf_atomic_dec(&pEndpoint->TxProcessCount);
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 		AR_DEBUG_PRINTF(ATH_DEBUG_SEND, ("-htc_try_send (busy) \n"));
 		return HTC_SEND_QUEUE_OK;
 	}
@@ -1181,7 +1620,7 @@ static HTC_SEND_QUEUE_RESULT htc_try_send(HTC_TARGET *target,
 			break;
 		}
 
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 
 		/* send what we can */
 		result = htc_issue_packets(target, pEndpoint, &sendQueue);
@@ -1196,7 +1635,7 @@ static HTC_SEND_QUEUE_RESULT htc_try_send(HTC_TARGET *target,
 
 			HTC_PACKET_QUEUE_TRANSFER_TO_HEAD(&pEndpoint->TxQueue,
 							  &sendQueue);
-			LOCK_HTC_TX(target);
+			LOCK_HTC_EP_TX(pEndpoint);
 			break;
 		}
 
@@ -1206,14 +1645,14 @@ static HTC_SEND_QUEUE_RESULT htc_try_send(HTC_TARGET *target,
 							  pEndpoint->UL_PipeID);
 		}
 
-		LOCK_HTC_TX(target);
+		LOCK_HTC_EP_TX(pEndpoint);
 
 	}
 
 	/* done with this endpoint, we can clear the count */
 	qdf_atomic_init(&pEndpoint->TxProcessCount);
 
-	UNLOCK_HTC_TX(target);
+	UNLOCK_HTC_EP_TX(pEndpoint);
 
 	AR_DEBUG_PRINTF(ATH_DEBUG_SEND, ("-htc_try_send:  \n"));
 
@@ -1272,7 +1711,7 @@ static A_STATUS htc_send_pkts_sched_queue(HTC_TARGET *target,
 	pEndpoint = &target->endpoint[eid];
 	pTxQueue = &pEndpoint->TxQueue;
 
-	LOCK_HTC_TX(target);
+	LOCK_HTC_EP_TX(pEndpoint);
 
 	goodPkts =
 		pEndpoint->MaxTxQueueDepth -
@@ -1306,7 +1745,7 @@ static A_STATUS htc_send_pkts_sched_queue(HTC_TARGET *target,
 		ITERATE_END;
 	}
 
-	UNLOCK_HTC_TX(target);
+	UNLOCK_HTC_EP_TX(pEndpoint);
 
 	return A_OK;
 }
@@ -1343,9 +1782,9 @@ A_STATUS htc_send_pkts_multiple(HTC_HANDLE HTCHandle, HTC_PACKET_QUEUE *pPktQueu
 	}
 
 #ifdef HTC_EP_STAT_PROFILING
-	LOCK_HTC_TX(target);
+	LOCK_HTC_EP_TX(pEndpoint);
 	INC_HTC_EP_STAT(pEndpoint, TxPosted, HTC_PACKET_QUEUE_DEPTH(pPktQueue));
-	UNLOCK_HTC_TX(target);
+	UNLOCK_HTC_EP_TX(pEndpoint);
 #endif
 
 	/* provide room in each packet's netbuf for the HTC frame header */
@@ -1362,7 +1801,7 @@ A_STATUS htc_send_pkts_multiple(HTC_HANDLE HTCHandle, HTC_PACKET_QUEUE *pPktQueu
 			       HTC_FRAME_HDR_PAYLOADLEN) | SM(pPacket->Endpoint,
 							      HTC_FRAME_HDR_ENDPOINTID));
 
-		LOCK_HTC_TX(target);
+		LOCK_HTC_EP_TX(pEndpoint);
 
 		pPacket->PktInfo.AsTx.SeqNo = pEndpoint->SeqNo;
 		pEndpoint->SeqNo++;
@@ -1371,7 +1810,7 @@ A_STATUS htc_send_pkts_multiple(HTC_HANDLE HTCHandle, HTC_PACKET_QUEUE *pPktQueu
 			    SM(pPacket->PktInfo.AsTx.SeqNo,
 			       HTC_FRAME_HDR_CONTROLBYTES1));
 
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 		/*
 		 * Now that the HTC frame header has been added, the netbuf can be
 		 * mapped.  This only applies to non-data frames, since data frames
@@ -1497,7 +1936,7 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, qdf_nbuf_t netbuf, int Epid,
 	 * unexpected event that other polling calls don't catch it).
 	 */
 
-	LOCK_HTC_TX(target);
+	LOCK_HTC_EP_TX(pEndpoint);
 
 	HTC_WRITE32(((uint32_t *) pHtcHdr) + 1,
 		    SM(pEndpoint->SeqNo, HTC_FRAME_HDR_CONTROLBYTES1));
@@ -1512,7 +1951,7 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, qdf_nbuf_t netbuf, int Epid,
 			       pEndpoint->UL_PipeID,
 			       pEndpoint->Id, ActualLength, netbuf, data_attr);
 
-	UNLOCK_HTC_TX(target);
+	UNLOCK_HTC_EP_TX(pEndpoint);
 	return status;
 }
 #else                           /*ATH_11AC_TXCOMPACT */
@@ -1572,7 +2011,7 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 						pEndpoint->UL_PipeID, 0);
 		}
 
-		LOCK_HTC_TX(target);
+		LOCK_HTC_EP_TX(pEndpoint);
 
 		pPacket->PktInfo.AsTx.SeqNo = pEndpoint->SeqNo;
 		pEndpoint->SeqNo++;
@@ -1584,12 +2023,12 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 		/* append new packet to pEndpoint->TxQueue */
 		HTC_PACKET_ENQUEUE(&pEndpoint->TxQueue, pPacket);
 		if (HTC_TX_BUNDLE_ENABLED(target) && (more_data)) {
-			UNLOCK_HTC_TX(target);
+			UNLOCK_HTC_EP_TX(pEndpoint);
 			return A_OK;
 		}
 	} else {
-		LOCK_HTC_TX(target);
 		pEndpoint = &target->endpoint[1];
+		LOCK_HTC_EP_TX(pEndpoint);
 	}
 
 	/* increment tx processing count on entry */
@@ -1601,7 +2040,7 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 		 * drained.
 		 */
 		qdf_atomic_dec(&pEndpoint->TxProcessCount);
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 		return A_OK;
 	}
 
@@ -1624,7 +2063,7 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 			}
 		}
 #endif
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 	}
 
 	else if (HTC_TX_BUNDLE_ENABLED(target)) {
@@ -1645,7 +2084,7 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 				     HTC_MAX_TX_BUNDLE_SEND_LIMIT);
 		}
 
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 	}
 	else {
 		/*
@@ -1656,7 +2095,7 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 			hif_get_free_queue_number(target->hif_dev,
 						  pEndpoint->UL_PipeID);
 		get_htc_send_packets(target, pEndpoint, &sendQueue, tx_resources);
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 	}
 	QDF_NBUF_UPDATE_TX_PKT_COUNT(netbuf, QDF_NBUF_TX_PKT_HTC);
 	DPTRACE(qdf_dp_trace(netbuf, QDF_DP_TRACE_HTC_PACKET_PTR_RECORD,
@@ -1678,12 +2117,12 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 		}
 		netbuf = GET_HTC_PACKET_NET_BUF_CONTEXT(pPacket);
 
-		LOCK_HTC_TX(target);
+		LOCK_HTC_EP_TX(pEndpoint);
 		/* store in look up queue to match completions */
-		HTC_PACKET_ENQUEUE(&pEndpoint->TxLookupQueue, pPacket);
+		htc_tx_lookup_add(pEndpoint, pPacket);
 		INC_HTC_EP_STAT(pEndpoint, TxIssued, 1);
 		pEndpoint->ul_outstanding_cnt++;
-		UNLOCK_HTC_TX(target);
+		UNLOCK_HTC_EP_TX(pEndpoint);
 
 		status = hif_send_head(target->hif_dev,
 				       pEndpoint->UL_PipeID,
@@ -1700,10 +2139,10 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 		htc_issue_tx_bundle_stats_inc(target);
 
 		if (qdf_unlikely(A_FAILED(status))) {
-			LOCK_HTC_TX(target);
+			LOCK_HTC_EP_TX(pEndpoint);
 			pEndpoint->ul_outstanding_cnt--;
 			/* remove this packet from the tx completion queue */
-			HTC_PACKET_REMOVE(&pEndpoint->TxLookupQueue, pPacket);
+			htc_tx_lookup_remove(pEndpoint, pPacket);
 
 			/*
 			 * Don't bother reclaiming credits - HTC flow control
@@ -1721,7 +2160,7 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 			/* put the sendQueue back at the front of pEndpoint->TxQueue */
 			HTC_PACKET_QUEUE_TRANSFER_TO_HEAD(&pEndpoint->TxQueue,
 							  &sendQueue);
-			UNLOCK_HTC_TX(target);
+			UNLOCK_HTC_EP_TX(pEndpoint);
 			break;  /* still need to reset TxProcessCount */
 		}
 	}
@@ -1745,71 +2184,32 @@ A_STATUS htc_send_data_pkt(HTC_HANDLE HTCHandle, HTC_PACKET *pPacket,
 /*
  * In the adapted HIF layer, qdf_nbuf_t are passed between HIF and HTC,
  * since upper layers expects HTC_PACKET containers we use the completed netbuf
- * and lookup its corresponding HTC packet buffer from a lookup list.
- * This is extra overhead that can be fixed by re-aligning HIF interfaces
- * with HTC.
+ * and lookup its corresponding HTC packet buffer in the endpoint
+ * TxLookupHash, which stays O(1) with out of order completions.
  *
  */
 static HTC_PACKET *htc_lookup_tx_packet(HTC_TARGET *target,
 					HTC_ENDPOINT *pEndpoint,
 					qdf_nbuf_t netbuf)
 {
-	HTC_PACKET *pPacket = NULL;
-	HTC_PACKET *pFoundPacket = NULL;
-	HTC_PACKET_QUEUE lookupQueue;
+	HTC_PACKET *pPacket;
 
-	INIT_HTC_PACKET_QUEUE(&lookupQueue);
-	LOCK_HTC_TX(target);
+	LOCK_HTC_EP_TX(pEndpoint);
 
 	/* mark that HIF has indicated the send complete for another packet */
 	pEndpoint->ul_outstanding_cnt--;
 
-	/* Dequeue first packet directly because of in-order completion */
-	pPacket = htc_packet_dequeue(&pEndpoint->TxLookupQueue);
-	if (qdf_unlikely(!pPacket)) {
-		UNLOCK_HTC_TX(target);
-		return NULL;
-	}
-	if (netbuf == (qdf_nbuf_t) GET_HTC_PACKET_NET_BUF_CONTEXT(pPacket)) {
-		UNLOCK_HTC_TX(target);
-		return pPacket;
-	} else {
-		HTC_PACKET_ENQUEUE(&lookupQueue, pPacket);
-	}
-
-	/*
-	 * Move TX lookup queue to temp queue because most of packets that are not index 0
-	 * are not top 10 packets.
-	 */
-	HTC_PACKET_QUEUE_TRANSFER_TO_TAIL(&lookupQueue,
-					  &pEndpoint->TxLookupQueue);
-	UNLOCK_HTC_TX(target);
-
-	ITERATE_OVER_LIST_ALLOW_REMOVE(&lookupQueue.QueueHead, pPacket,
-				       HTC_PACKET, ListLink) {
+	pPacket = pEndpoint->TxLookupHash[htc_tx_lookup_hash(netbuf)];
+	while (pPacket &&
+	       netbuf != (qdf_nbuf_t) GET_HTC_PACKET_NET_BUF_CONTEXT(pPacket))
+		pPacket = pPacket->pTxLookupNext;
 
-		if (NULL == pPacket) {
-			pFoundPacket = pPacket;
-			break;
-		}
-		/* check for removal */
-		if (netbuf ==
-		    (qdf_nbuf_t) GET_HTC_PACKET_NET_BUF_CONTEXT(pPacket)) {
-			/* found it */
-			HTC_PACKET_REMOVE(&lookupQueue, pPacket);
-			pFoundPacket = pPacket;
-			break;
-		}
+	if (pPacket)
+		htc_tx_lookup_remove(pEndpoint, pPacket);
 
-	}
-	ITERATE_END;
+	UNLOCK_HTC_EP_TX(pEndpoint);
 
-	LOCK_HTC_TX(target);
-	HTC_PACKET_QUEUE_TRANSFER_TO_HEAD(&pEndpoint->TxLookupQueue,
-					  &lookupQueue);
-	UNLOCK_HTC_TX(target);
-
-	return pFoundPacket;
+	return pPacket;
 }
 
 /**
@@ -1856,6 +2256,9 @@ QDF_STATUS htc_tx_completion_handler(void *Context,
 			HTC_PACKET *pPacketTemp;
 			HTC_PACKET_QUEUE *pQueueSave =
 				(HTC_PACKET_QUEUE *) pPacket->pContext;
+
+			htc_tx_bundle_probe_done(pEndpoint, pPacket,
+					HTC_PACKET_QUEUE_DEPTH(pQueueSave));
 			HTC_PACKET_QUEUE_ITERATE_ALLOW_REMOVE(pQueueSave,
 							      pPacketTemp) {
 				pPacket->Status = A_OK;
@@ -1974,7 +2377,9 @@ void htc_flush_endpoint_tx(HTC_TARGET *target, HTC_ENDPOINT *pEndpoint,
 {
 	HTC_PACKET *pPacket;
 
-	LOCK_HTC_TX(target);
+	LOCK_HTC_EP_TX(pEndpoint);
+	/* a bundle still in flight may be freed and its packet reused */
+	pEndpoint->TxBundleProbe = NULL;
 	while (HTC_PACKET_QUEUE_DEPTH(&pEndpoint->TxQueue)) {
 		pPacket = htc_packet_dequeue(&pEndpoint->TxQueue);
 
@@ -1984,7 +2389,7 @@ void htc_flush_endpoint_tx(HTC_TARGET *target, HTC_ENDPOINT *pEndpoint,
 			send_packet_completion(target, pPacket);
 		}
 	}
-	UNLOCK_HTC_TX(target);
+	UNLOCK_HTC_EP_TX(pEndpoint);
 }
 
 /* HTC API to flush an endpoint's TX queue*/
@@ -2031,14 +2436,12 @@ void htc_process_credit_rpt(HTC_TARGET *target, HTC_CREDIT_REPORT *pRpt,
 	HTC_ENDPOINT *pEndpoint;
 	int totalCredits = 0;
 	uint8_t rpt_credits, rpt_ep_id;
+	bool kick;
 
 	AR_DEBUG_PRINTF(ATH_DEBUG_SEND,
 			("+htc_process_credit_rpt, Credit Report Entries:%d \n",
 			 NumEntries));
 
-	/* lock out TX while we update credits */
-	LOCK_HTC_TX(target);
-
 	for (i = 0; i < NumEntries; i++, pRpt++) {
 
 		rpt_ep_id = HTC_GET_FIELD(pRpt, HTC_CREDIT_REPORT, ENDPOINTID);
@@ -2051,6 +2454,9 @@ void htc_process_credit_rpt(HTC_TARGET *target, HTC_CREDIT_REPORT *pRpt,
 		rpt_credits = HTC_GET_FIELD(pRpt, HTC_CREDIT_REPORT, CREDITS);
 
 		pEndpoint = &target->endpoint[rpt_ep_id];
+
+		/* lock out TX on this endpoint while we update its credits */
+		LOCK_HTC_EP_TX(pEndpoint);
 #if DEBUG_CREDIT
 		if (ep_debug_mask & (1 << pEndpoint->Id)) {
 			AR_DEBUG_PRINTF(ATH_DEBUG_ERR,
@@ -2097,9 +2503,11 @@ void htc_process_credit_rpt(HTC_TARGET *target, HTC_CREDIT_REPORT *pRpt,
 			UNLOCK_HTC_CREDIT(target);
 		}
 
-		if (pEndpoint->TxCredits
-		    && HTC_PACKET_QUEUE_DEPTH(&pEndpoint->TxQueue)) {
-			UNLOCK_HTC_TX(target);
+		kick = pEndpoint->TxCredits &&
+		       HTC_PACKET_QUEUE_DEPTH(&pEndpoint->TxQueue);
+		UNLOCK_HTC_EP_TX(pEndpoint);
+
+		if (kick) {
 #ifdef ATH_11AC_TXCOMPACT
 			htc_try_send(target, pEndpoint, NULL);
 #else
@@ -2109,7 +2517,6 @@ void htc_process_credit_rpt(HTC_TARGET *target, HTC_CREDIT_REPORT *pRpt,
 				htc_try_send(target, pEndpoint, NULL);
 			}
 #endif
-			LOCK_HTC_TX(target);
 		}
 		totalCredits += rpt_credits;
 	}
@@ -2118,8 +2525,6 @@ void htc_process_credit_rpt(HTC_TARGET *target, HTC_CREDIT_REPORT *pRpt,
 			("  Report indicated %d credits to distribute \n",
 			 totalCredits));
 
-	UNLOCK_HTC_TX(target);
-
 	AR_DEBUG_PRINTF(ATH_DEBUG_SEND, ("-htc_process_credit_rpt \n"));
 }
 
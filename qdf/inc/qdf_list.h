@@ -111,6 +111,8 @@ QDF_STATUS qdf_list_peek_front(qdf_list_t *list, qdf_list_node_t **node1);
 QDF_STATUS qdf_list_remove_node(qdf_list_t *list,
 				qdf_list_node_t *node_to_remove);
 
+void qdf_list_del_init(qdf_list_t *list, qdf_list_node_t *node);
+
 bool qdf_list_empty(qdf_list_t *list);
 
 #endif /* __QDF_LIST_H */
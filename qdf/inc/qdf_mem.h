@@ -210,7 +210,7 @@ static inline uint32_t qdf_mem_map_nbytes_single(qdf_device_t osdev, void *buf,
  * Return: none
  */
 static inline void qdf_mem_unmap_nbytes_single(qdf_device_t osdev,
-					       uint32_t phy_addr,
+					       qdf_dma_addr_t phy_addr,
 					       qdf_dma_dir_t dir,
 					       int nbytes)
 {
@@ -271,6 +271,47 @@ static inline void qdf_mempool_free(qdf_device_t osdev, qdf_mempool_t pool,
 	__qdf_mempool_free(osdev, pool, buf);
 }
 
+/**
+ * qdf_mempool_alloc_bulk - Allocate several elements of a memory pool
+ * @osdev: platform device object
+ * @pool: Handle to memory pool
+ * @bufs: array receiving the elements
+ * @num: number of elements wanted
+ * Return: number of elements stored in @bufs, less than @num if the pool
+ * ran empty
+ */
+static inline int qdf_mempool_alloc_bulk(qdf_device_t osdev,
+					 qdf_mempool_t pool, void **bufs,
+					 int num)
+{
+	return __qdf_mempool_alloc_bulk(osdev, pool, bufs, num);
+}
+
+/**
+ * qdf_mempool_free_bulk - Free several memory pool elements
+ * @osdev: Platform device object
+ * @pool: Handle to memory pool
+ * @bufs: elements to be freed
+ * @num: number of elements in @bufs
+ * Return: none
+ */
+static inline void qdf_mempool_free_bulk(qdf_device_t osdev,
+					 qdf_mempool_t pool, void **bufs,
+					 int num)
+{
+	__qdf_mempool_free_bulk(osdev, pool, bufs, num);
+}
+
+/**
+ * qdf_mempool_print_stats - Print the usage of a memory pool
+ * @pool: Handle to memory pool
+ * Return: none
+ */
+static inline void qdf_mempool_print_stats(qdf_mempool_t pool)
+{
+	__qdf_mempool_print_stats(pool);
+}
+
 void qdf_mem_dma_sync_single_for_device(qdf_device_t osdev,
 					qdf_dma_addr_t bus_addr,
 					qdf_size_t size,
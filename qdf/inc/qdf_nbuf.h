@@ -569,6 +569,8 @@ void qdf_net_buf_debug_add_node(qdf_nbuf_t net_buf, size_t size,
 			uint8_t *file_name, uint32_t line_num);
 void qdf_net_buf_debug_delete_node(qdf_nbuf_t net_buf);
 void qdf_net_buf_debug_release_skb(qdf_nbuf_t net_buf);
+void qdf_net_buf_debug_age_report(uint32_t min_age_ms);
+void qdf_net_buf_debug_set_age_report(uint32_t period_ms, uint32_t min_age_ms);
 
 /* nbuf allocation rouines */
 
@@ -605,6 +607,15 @@ static inline void qdf_net_buf_debug_release_skb(qdf_nbuf_t net_buf)
 	return;
 }
 
+static inline void qdf_net_buf_debug_age_report(uint32_t min_age_ms)
+{
+}
+
+static inline void qdf_net_buf_debug_set_age_report(uint32_t period_ms,
+						    uint32_t min_age_ms)
+{
+}
+
 /* Nbuf allocation rouines */
 
 static inline qdf_nbuf_t
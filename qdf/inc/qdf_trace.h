@@ -99,7 +99,15 @@ typedef enum {
 /* Preprocessor definitions and constants */
 #define ASSERT_BUFFER_SIZE (512)
 
-#define MAX_QDF_TRACE_RECORDS 4000
+#define MAX_QDF_TRACE_RECORDS 4096
+/*
+ * MTRACE records kept by each CPU, rounded down to a power of two. Every
+ * possible CPU gets a ring of its own; most records come from the single
+ * MC thread, so its CPU must be able to hold the full history.
+ */
+#ifndef QDF_TRACE_RECORDS_PER_CPU
+#define QDF_TRACE_RECORDS_PER_CPU MAX_QDF_TRACE_RECORDS
+#endif
 #define INVALID_QDF_TRACE_ADDR 0xffffffff
 #define DEFAULT_QDF_TRACE_DUMP_COUNT 0
 
@@ -138,19 +146,23 @@ typedef struct qdf_trace_record_s {
 } qdf_trace_record_t, *tp_qdf_trace_record;
 
 /**
- * typedef struct s_qdf_trace_data - MTRACE logs are stored in ring buffer
- * @head: position of first record
- * @tail: position of last record
- * @num: count of total record
- * @num_since_last_dump: count from last dump
+ * struct qdf_trace_cpu_ring - one CPU's MTRACE ring
+ * @tail: records ever written on this CPU; slot is tail % entries
+ * @buf: records of this CPU, NULL if they could not be allocated
+ */
+struct qdf_trace_cpu_ring {
+	uint32_t tail;
+	tp_qdf_trace_record buf;
+};
+
+/**
+ * typedef struct s_qdf_trace_data - MTRACE logs are stored in per-CPU rings
+ * @entries: records per CPU ring, a power of two
  * @enable: config for controlling the trace
  * @dump_count: Dump after number of records reach this number
  */
 typedef struct s_qdf_trace_data {
-	uint32_t head;
-	uint32_t tail;
-	uint32_t num;
-	uint16_t num_since_last_dump;
+	uint32_t entries;
 	uint8_t enable;
 	uint16_t dump_count;
 } t_qdf_trace_data;
@@ -164,7 +176,16 @@ typedef struct s_qdf_trace_data {
 #define DPTRACE(p)
 #endif
 
-#define MAX_QDF_DP_TRACE_RECORDS       4000
+#define MAX_QDF_DP_TRACE_RECORDS       4096
+/*
+ * DP trace records kept by each CPU, rounded down to a power of two.
+ * Every possible CPU gets a ring of its own, so the trace takes this
+ * many records times the number of possible CPUs; lower it for memory
+ * constrained targets at the cost of a shorter history per CPU.
+ */
+#ifndef QDF_DP_TRACE_RECORDS_PER_CPU
+#define QDF_DP_TRACE_RECORDS_PER_CPU   MAX_QDF_DP_TRACE_RECORDS
+#endif
 #define QDF_DP_TRACE_RECORD_SIZE       16
 #define INVALID_QDF_DP_TRACE_ADDR      0xffffffff
 #define QDF_DP_TRACE_VERBOSITY_HIGH    3
@@ -303,27 +324,35 @@ struct qdf_dp_trace_record_s {
 	uint32_t pid;
 };
 
+/**
+ * struct qdf_dp_trace_cpu_ring - one CPU's DP trace ring
+ * @tail: records ever written on this CPU; slot is tail % entries
+ * @tx_count: tx packets seen on this CPU by qdf_dp_trace_set_track
+ * @rx_count: rx packets seen on this CPU by qdf_dp_trace_set_track
+ * @buf: records of this CPU, NULL if they could not be allocated
+ */
+struct qdf_dp_trace_cpu_ring {
+	uint32_t tail;
+	uint32_t tx_count;
+	uint32_t rx_count;
+	struct qdf_dp_trace_record_s *buf;
+};
+
 /**
  * struct qdf_dp_trace_data - Parameters to configure/control DP trace
- * @head: Position of first record
- * @tail: Position of last record
- * @num:  Current index
+ * @entries: records per CPU ring, a power of two
  * @proto_bitmap: defines which protocol to be traced
  * @no_of_record: defines every nth packet to be traced
  * @verbosity : defines verbosity level
  * @enable: enable/disable DP trace
- * @count: current packet number
+ * @live_mode: print every record as it is added
  */
 struct s_qdf_dp_trace_data {
-	uint32_t head;
-	uint32_t tail;
-	uint32_t num;
+	uint32_t entries;
 	uint8_t proto_bitmap;
 	uint8_t no_of_record;
 	uint8_t verbosity;
 	bool enable;
-	uint32_t tx_count;
-	uint32_t rx_count;
 	bool live_mode;
 };
 
@@ -367,6 +396,7 @@ typedef void (*tp_qdf_trace_cb)(void *p_mac, tp_qdf_trace_record, uint16_t);
 void qdf_trace(uint8_t module, uint8_t code, uint16_t session, uint32_t data);
 void qdf_trace_register(QDF_MODULE_ID, tp_qdf_trace_cb);
 QDF_STATUS qdf_trace_spin_lock_init(void);
+void qdf_trace_deinit(void);
 void qdf_trace_init(void);
 void qdf_trace_enable(uint32_t, uint8_t enable);
 void qdf_trace_dump_all(void *, uint8_t, uint8_t, uint32_t, uint32_t);
@@ -377,6 +407,7 @@ void qdf_dp_trace_log_pkt(uint8_t session_id, struct sk_buff *skb,
 				enum qdf_proto_dir dir);
 void qdf_dp_trace_init(void);
 void qdf_dp_trace_spin_lock_init(void);
+void qdf_dp_trace_deinit(void);
 void qdf_dp_trace_set_value(uint8_t proto_bitmap, uint8_t no_of_records,
 			 uint8_t verbosity);
 void qdf_dp_trace_set_track(qdf_nbuf_t nbuf, enum qdf_proto_dir dir);
@@ -415,6 +446,10 @@ void qdf_dp_trace_init(void)
 {
 }
 static inline
+void qdf_dp_trace_deinit(void)
+{
+}
+static inline
 void qdf_dp_trace_set_track(qdf_nbuf_t nbuf, enum qdf_proto_dir dir)
 {
 }
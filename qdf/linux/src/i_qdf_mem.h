@@ -45,6 +45,7 @@
 #include <linux/hardirq.h>
 #include <linux/vmalloc.h>
 #include <linux/pci.h> /* pci_alloc_consistent */
+#include <linux/percpu.h>
 #if CONFIG_MCL
 #include <cds_queue.h>
 #else
@@ -71,6 +72,27 @@ typedef struct mempool_elem {
 	STAILQ_ENTRY(mempool_elem) mempool_entry;
 } mempool_elem_t;
 
+/* free elements a CPU keeps for itself */
+#define QDF_MEMPOOL_MAG_SIZE 32
+/* elements moved between a magazine and the shared free list at once */
+#define QDF_MEMPOOL_MAG_BATCH (QDF_MEMPOOL_MAG_SIZE / 2)
+/* pools get magazines from this many elements per possible CPU */
+#define QDF_MEMPOOL_MAG_MIN_ELEMS (4 * QDF_MEMPOOL_MAG_SIZE)
+
+/**
+ * struct __qdf_mempool_mag - per-CPU cache of free pool elements
+ * @count: elements in @elems
+ * @elems: free elements, the most recently freed last
+ * @hits: allocations served by the magazine
+ * @misses: allocations that found the magazine empty
+ */
+struct __qdf_mempool_mag {
+	u_int32_t count;
+	void *elems[QDF_MEMPOOL_MAG_SIZE];
+	u_int32_t hits;
+	u_int32_t misses;
+};
+
 /**
  * typedef __qdf_mempool_ctxt_t - Memory pool context
  * @pool_id: pool identifier
@@ -81,7 +103,11 @@ typedef struct mempool_elem {
  * @free_list: free pool list
  * @lock: spinlock object
  * @max_elem: Maximum number of elements in tha pool
- * @free_cnt: Number of free elements available
+ * @free_cnt: Number of free elements available in @free_list
+ * @max_out: most elements ever out of @free_list, including the ones
+ *	cached in magazines
+ * @mags: per-CPU magazines in front of @free_list, NULL for pools smaller
+ *	than QDF_MEMPOOL_MAG_MIN_ELEMS per possible CPU
  */
 typedef struct __qdf_mempool_ctxt {
 	int pool_id;
@@ -93,6 +119,8 @@ typedef struct __qdf_mempool_ctxt {
 	spinlock_t lock;
 	u_int32_t max_elem;
 	u_int32_t free_cnt;
+	u_int32_t max_out;
+	struct __qdf_mempool_mag __percpu *mags;
 } __qdf_mempool_ctxt_t;
 
 #endif /* __KERNEL__ */
@@ -160,7 +188,7 @@ static inline uint32_t __qdf_mem_map_nbytes_single(qdf_device_t osdev,
  * @return - none
  */
 static inline void __qdf_mem_unmap_nbytes_single(qdf_device_t osdev,
-						 uint32_t phy_addr,
+						 qdf_dma_addr_t phy_addr,
 						 qdf_dma_dir_t dir, int nbytes)
 {
 	dma_unmap_single(osdev->dev, phy_addr, nbytes, dir);
@@ -174,6 +202,11 @@ int __qdf_mempool_init(qdf_device_t osdev, __qdf_mempool_t *pool, int pool_cnt,
 void __qdf_mempool_destroy(qdf_device_t osdev, __qdf_mempool_t pool);
 void *__qdf_mempool_alloc(qdf_device_t osdev, __qdf_mempool_t pool);
 void __qdf_mempool_free(qdf_device_t osdev, __qdf_mempool_t pool, void *buf);
+int __qdf_mempool_alloc_bulk(qdf_device_t osdev, __qdf_mempool_t pool,
+			     void **bufs, int num);
+void __qdf_mempool_free_bulk(qdf_device_t osdev, __qdf_mempool_t pool,
+			     void **bufs, int num);
+void __qdf_mempool_print_stats(__qdf_mempool_t pool);
 
 #define __qdf_mempool_elem_size(_pool) ((_pool)->elem_size);
 #endif
@@ -182,6 +182,26 @@ QDF_STATUS qdf_list_remove_node(qdf_list_t *list,
 }
 EXPORT_SYMBOL(qdf_list_remove_node);
 
+/**
+ * qdf_list_del_init() - remove a node known to be in the list
+ * @list: Pointer to list
+ * @node: Pointer to node which needs to be removed
+ *
+ * Unlike qdf_list_remove_node() the node is not searched for, so the
+ * caller must know it is in @list. The node is left as an empty list,
+ * so a later check of it can tell that it was removed.
+ * It is expected that the list being removed from is locked
+ * when this function is being called.
+ *
+ * Return: None
+ */
+void qdf_list_del_init(qdf_list_t *list, qdf_list_node_t *node)
+{
+	list_del_init(node);
+	list->count--;
+}
+EXPORT_SYMBOL(qdf_list_del_init);
+
 /**
  * qdf_list_peek_front() - peek front node from list
  * @list: Pointer to list
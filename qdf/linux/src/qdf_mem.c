@@ -47,8 +47,26 @@
 
 #ifdef MEMORY_DEBUG
 #include <qdf_list.h>
-qdf_list_t qdf_mem_list;
-qdf_spinlock_t qdf_mem_list_lock;
+#include <linux/hash.h>
+#include <linux/list_sort.h>
+
+#define QDF_MEM_DEBUG_SHARD_BITS 4
+#define QDF_MEM_DEBUG_SHARDS (1 << QDF_MEM_DEBUG_SHARD_BITS)
+
+/**
+ * struct qdf_mem_debug_shard - slice of the tracked allocations
+ * @list: allocations whose address hashes to this shard
+ * @lock: protects @list
+ *
+ * Allocations are spread over shards by address so that concurrent
+ * allocs and frees rarely contend for the same lock.
+ */
+struct qdf_mem_debug_shard {
+	qdf_list_t list;
+	qdf_spinlock_t lock;
+} ____cacheline_aligned_in_smp;
+
+static struct qdf_mem_debug_shard qdf_mem_shards[QDF_MEM_DEBUG_SHARDS];
 
 static uint8_t WLAN_MEM_HEADER[] = { 0x61, 0x62, 0x63, 0x64, 0x65, 0x66,
 					0x67, 0x68 };
@@ -70,6 +88,18 @@ struct s_qdf_mem_struct {
 	unsigned int size;
 	uint8_t header[8];
 };
+
+/**
+ * qdf_mem_shard() - shard tracking an allocation
+ * @mem_struct: debug header of the allocation
+ *
+ * Return: shard
+ */
+static inline struct qdf_mem_debug_shard *
+qdf_mem_shard(struct s_qdf_mem_struct *mem_struct)
+{
+	return &qdf_mem_shards[hash_ptr(mem_struct, QDF_MEM_DEBUG_SHARD_BITS)];
+}
 #endif
 
 /* Preprocessor Definitions and Constants */
@@ -153,6 +183,20 @@ int __qdf_mempool_init(qdf_device_t osdev, __qdf_mempool_t *pool_addr,
 		return -ENOMEM;
 	}
 
+	/*
+	 * Elements cached by other CPUs cannot be allocated, keep small
+	 * pools on the shared free list alone.
+	 */
+	if (elem_cnt >= QDF_MEMPOOL_MAG_MIN_ELEMS * num_possible_cpus()) {
+		new_pool->mags = alloc_percpu(struct __qdf_mempool_mag);
+		if (new_pool->mags == NULL) {
+			kfree(new_pool->pool_mem);
+			kfree(new_pool);
+			osdev->mem_pool[pool_id] = NULL;
+			return -ENOMEM;
+		}
+	}
+
 	spin_lock_init(&new_pool->lock);
 
 	/* Initialize free list */
@@ -166,6 +210,7 @@ int __qdf_mempool_init(qdf_device_t osdev, __qdf_mempool_t *pool_addr,
 			(new_pool->elem_size * i)), mempool_entry);
 
 
+	new_pool->max_elem = elem_cnt;
 	new_pool->free_cnt = elem_cnt;
 	*pool_addr = new_pool;
 	return 0;
@@ -194,23 +239,164 @@ void __qdf_mempool_destroy(qdf_device_t osdev, __qdf_mempool_t pool)
 	pool_id = pool->pool_id;
 
 	/* TBD: Check if free count matches elem_cnt if debug is enabled */
+	if (pool->mags)
+		free_percpu(pool->mags);
 	kfree(pool->pool_mem);
 	kfree(pool);
 	osdev->mem_pool[pool_id] = NULL;
 }
 EXPORT_SYMBOL(__qdf_mempool_destroy);
 
+/**
+ * __qdf_mempool_shared_get() - take an element from the shared free list
+ * @pool: Handle to memory pool
+ *
+ * Return: element or NULL if the pool is empty
+ */
+static void *__qdf_mempool_shared_get(__qdf_mempool_t pool)
+{
+	mempool_elem_t *elem;
+
+	spin_lock_bh(&pool->lock);
+	elem = STAILQ_FIRST(&pool->free_list);
+	if (elem != NULL) {
+		STAILQ_REMOVE_HEAD(&pool->free_list, mempool_entry);
+		pool->free_cnt--;
+		if (pool->max_elem - pool->free_cnt > pool->max_out)
+			pool->max_out = pool->max_elem - pool->free_cnt;
+	}
+	spin_unlock_bh(&pool->lock);
+
+	return elem;
+}
+
+/**
+ * __qdf_mempool_shared_put() - give an element back to the shared free list
+ * @pool: Handle to memory pool
+ * @buf: Element to be freed
+ *
+ * Freed elements go to the head, where the next allocation finds them
+ * still cache hot.
+ *
+ * Return: none
+ */
+static void __qdf_mempool_shared_put(__qdf_mempool_t pool, void *buf)
+{
+	spin_lock_bh(&pool->lock);
+	STAILQ_INSERT_HEAD(&pool->free_list, (mempool_elem_t *)buf,
+			   mempool_entry);
+	pool->free_cnt++;
+	spin_unlock_bh(&pool->lock);
+}
+
+/**
+ * __qdf_mempool_mag_refill() - move elements from the shared free list to
+ * a magazine
+ * @pool: Handle to memory pool
+ * @mag: empty magazine of the current CPU, bottom halves disabled
+ *
+ * Return: none
+ */
+static void __qdf_mempool_mag_refill(__qdf_mempool_t pool,
+				     struct __qdf_mempool_mag *mag)
+{
+	mempool_elem_t *elem;
+
+	spin_lock(&pool->lock);
+	while (mag->count < QDF_MEMPOOL_MAG_BATCH) {
+		elem = STAILQ_FIRST(&pool->free_list);
+		if (elem == NULL)
+			break;
+		STAILQ_REMOVE_HEAD(&pool->free_list, mempool_entry);
+		pool->free_cnt--;
+		mag->elems[mag->count++] = elem;
+	}
+	if (pool->max_elem - pool->free_cnt > pool->max_out)
+		pool->max_out = pool->max_elem - pool->free_cnt;
+	spin_unlock(&pool->lock);
+}
+
+/**
+ * __qdf_mempool_mag_drain() - move elements from a magazine to the shared
+ * free list
+ * @pool: Handle to memory pool
+ * @mag: full magazine of the current CPU, bottom halves disabled
+ *
+ * The least recently freed elements go, the cache hot ones stay.
+ *
+ * Return: none
+ */
+static void __qdf_mempool_mag_drain(__qdf_mempool_t pool,
+				    struct __qdf_mempool_mag *mag)
+{
+	int i;
+
+	spin_lock(&pool->lock);
+	for (i = 0; i < QDF_MEMPOOL_MAG_BATCH; i++)
+		STAILQ_INSERT_HEAD(&pool->free_list,
+				   (mempool_elem_t *)mag->elems[i],
+				   mempool_entry);
+	pool->free_cnt += QDF_MEMPOOL_MAG_BATCH;
+	spin_unlock(&pool->lock);
+
+	mag->count -= QDF_MEMPOOL_MAG_BATCH;
+	memmove(mag->elems, &mag->elems[QDF_MEMPOOL_MAG_BATCH],
+		mag->count * sizeof(mag->elems[0]));
+}
+
+/**
+ * __qdf_mempool_mag_get() - take an element from the current CPU's magazine
+ * @pool: Handle to memory pool
+ * @mag: magazine of the current CPU, bottom halves disabled
+ *
+ * Return: element or NULL if the pool is empty
+ */
+static inline void *__qdf_mempool_mag_get(__qdf_mempool_t pool,
+					  struct __qdf_mempool_mag *mag)
+{
+	if (mag->count) {
+		mag->hits++;
+	} else {
+		mag->misses++;
+		__qdf_mempool_mag_refill(pool, mag);
+		if (!mag->count)
+			return NULL;
+	}
+
+	return mag->elems[--mag->count];
+}
+
+/**
+ * __qdf_mempool_mag_put() - give an element to the current CPU's magazine
+ * @pool: Handle to memory pool
+ * @mag: magazine of the current CPU, bottom halves disabled
+ * @buf: Element to be freed
+ *
+ * Return: none
+ */
+static inline void __qdf_mempool_mag_put(__qdf_mempool_t pool,
+					 struct __qdf_mempool_mag *mag,
+					 void *buf)
+{
+	if (mag->count == QDF_MEMPOOL_MAG_SIZE)
+		__qdf_mempool_mag_drain(pool, mag);
+	mag->elems[mag->count++] = buf;
+}
+
 /**
  * __qdf_mempool_alloc() - Allocate an element memory pool
  *
  * @osdev: platform device object
  * @Handle: to memory pool
  *
+ * Elements come from the current CPU's magazine, which is refilled in
+ * batches from the shared free list.
+ *
  * Return: Pointer to the allocated element or NULL if the pool is empty
  */
 void *__qdf_mempool_alloc(qdf_device_t osdev, __qdf_mempool_t pool)
 {
-	void *buf = NULL;
+	void *buf;
 
 	if (!pool)
 		return NULL;
@@ -218,16 +404,12 @@ void *__qdf_mempool_alloc(qdf_device_t osdev, __qdf_mempool_t pool)
 	if (prealloc_disabled)
 		return  qdf_mem_malloc(pool->elem_size);
 
-	spin_lock_bh(&pool->lock);
-
-	buf = STAILQ_FIRST(&pool->free_list);
-	if (buf != NULL) {
-		STAILQ_REMOVE_HEAD(&pool->free_list, mempool_entry);
-		pool->free_cnt--;
-	}
+	if (!pool->mags)
+		return __qdf_mempool_shared_get(pool);
 
-	/* TBD: Update free count if debug is enabled */
-	spin_unlock_bh(&pool->lock);
+	local_bh_disable();
+	buf = __qdf_mempool_mag_get(pool, this_cpu_ptr(pool->mags));
+	local_bh_enable();
 
 	return buf;
 }
@@ -250,15 +432,141 @@ void __qdf_mempool_free(qdf_device_t osdev, __qdf_mempool_t pool, void *buf)
 	if (prealloc_disabled)
 		return qdf_mem_free(buf);
 
-	spin_lock_bh(&pool->lock);
-	pool->free_cnt++;
+	if (!pool->mags)
+		return __qdf_mempool_shared_put(pool, buf);
 
-	STAILQ_INSERT_TAIL
-		(&pool->free_list, (mempool_elem_t *)buf, mempool_entry);
-	spin_unlock_bh(&pool->lock);
+	local_bh_disable();
+	__qdf_mempool_mag_put(pool, this_cpu_ptr(pool->mags), buf);
+	local_bh_enable();
 }
 EXPORT_SYMBOL(__qdf_mempool_free);
 
+/**
+ * __qdf_mempool_alloc_bulk() - Allocate several elements of a memory pool
+ * @osdev: platform device object
+ * @pool: Handle to memory pool
+ * @bufs: array receiving the elements
+ * @num: number of elements wanted
+ *
+ * Return: number of elements stored in @bufs, less than @num if the pool
+ * ran empty
+ */
+int __qdf_mempool_alloc_bulk(qdf_device_t osdev, __qdf_mempool_t pool,
+			     void **bufs, int num)
+{
+	struct __qdf_mempool_mag *mag;
+	int i;
+
+	if (!pool)
+		return 0;
+
+	if (prealloc_disabled) {
+		for (i = 0; i < num; i++) {
+			bufs[i] = qdf_mem_malloc(pool->elem_size);
+			if (bufs[i] == NULL)
+				break;
+		}
+		return i;
+	}
+
+	if (!pool->mags) {
+		for (i = 0; i < num; i++) {
+			bufs[i] = __qdf_mempool_shared_get(pool);
+			if (bufs[i] == NULL)
+				break;
+		}
+		return i;
+	}
+
+	local_bh_disable();
+	mag = this_cpu_ptr(pool->mags);
+	for (i = 0; i < num; i++) {
+		bufs[i] = __qdf_mempool_mag_get(pool, mag);
+		if (bufs[i] == NULL)
+			break;
+	}
+	local_bh_enable();
+
+	return i;
+}
+EXPORT_SYMBOL(__qdf_mempool_alloc_bulk);
+
+/**
+ * __qdf_mempool_free_bulk() - Free several memory pool elements
+ * @osdev: Platform device object
+ * @pool: Handle to memory pool
+ * @bufs: elements to be freed
+ * @num: number of elements in @bufs
+ *
+ * Returns: none
+ */
+void __qdf_mempool_free_bulk(qdf_device_t osdev, __qdf_mempool_t pool,
+			     void **bufs, int num)
+{
+	struct __qdf_mempool_mag *mag;
+	int i;
+
+	if (!pool)
+		return;
+
+	if (prealloc_disabled) {
+		for (i = 0; i < num; i++)
+			qdf_mem_free(bufs[i]);
+		return;
+	}
+
+	if (!pool->mags) {
+		for (i = 0; i < num; i++)
+			__qdf_mempool_shared_put(pool, bufs[i]);
+		return;
+	}
+
+	local_bh_disable();
+	mag = this_cpu_ptr(pool->mags);
+	for (i = 0; i < num; i++)
+		__qdf_mempool_mag_put(pool, mag, bufs[i]);
+	local_bh_enable();
+}
+EXPORT_SYMBOL(__qdf_mempool_free_bulk);
+
+/**
+ * __qdf_mempool_print_stats() - Print the usage of a memory pool
+ * @pool: Handle to memory pool
+ *
+ * Prints the high water mark of the pool and the magazine hit rate of
+ * every CPU that allocated from it.
+ *
+ * Returns: none
+ */
+void __qdf_mempool_print_stats(__qdf_mempool_t pool)
+{
+	struct __qdf_mempool_mag *mag;
+	u_int32_t total;
+	int cpu;
+
+	if (!pool || prealloc_disabled)
+		return;
+
+	QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_INFO,
+		  "mempool %d: elems %u free %u max out %u",
+		  pool->pool_id, pool->max_elem, pool->free_cnt,
+		  pool->max_out);
+	if (!pool->mags)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		mag = per_cpu_ptr(pool->mags, cpu);
+		total = mag->hits + mag->misses;
+		if (!total)
+			continue;
+		QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_INFO,
+			  "  cpu %d: cached %u hits %u misses %u hit rate %u%%",
+			  cpu, mag->count, mag->hits, mag->misses,
+			  (u_int32_t)div_u64((u64)mag->hits * 100, total));
+	}
+}
+EXPORT_SYMBOL(__qdf_mempool_print_stats);
+
 /**
  * qdf_mem_alloc_outline() - allocation QDF memory
  * @osdev: platform device object
@@ -322,28 +630,65 @@ EXPORT_SYMBOL(qdf_mem_zero_outline);
  */
 void qdf_mem_init(void)
 {
-	/* Initalizing the list with maximum size of 60000 */
-	qdf_list_create(&qdf_mem_list, 60000);
-	qdf_spinlock_create(&qdf_mem_list_lock);
+	int i;
+
+	/* Initalizing the lists with maximum size of 60000 */
+	for (i = 0; i < QDF_MEM_DEBUG_SHARDS; i++) {
+		qdf_list_create(&qdf_mem_shards[i].list, 60000);
+		qdf_spinlock_create(&qdf_mem_shards[i].lock);
+	}
 	qdf_net_buf_debug_init();
 	return;
 }
 EXPORT_SYMBOL(qdf_mem_init);
 
+/**
+ * qdf_mem_leak_cmp() - order leaked allocations by allocation site
+ * @priv: not used
+ * @a: node of a leaked allocation
+ * @b: node of a leaked allocation
+ *
+ * Return: <0, 0 or >0 as @a sorts before, with or after @b
+ */
+static int qdf_mem_leak_cmp(void *priv, struct list_head *a,
+			    struct list_head *b)
+{
+	struct s_qdf_mem_struct *ma = (struct s_qdf_mem_struct *)a;
+	struct s_qdf_mem_struct *mb = (struct s_qdf_mem_struct *)b;
+	int ret;
+
+	ret = strcmp(ma->file_name, mb->file_name);
+	if (ret)
+		return ret;
+	if (ma->line_num != mb->line_num)
+		return ma->line_num < mb->line_num ? -1 : 1;
+	if (ma->size != mb->size)
+		return ma->size < mb->size ? -1 : 1;
+
+	return 0;
+}
+
 /**
  * qdf_mem_clean() - display memory leak debug info and free leaked pointers
  *
+ * The leaks of all shards are sorted by allocation site, so each site
+ * is reported once with its leak count.
+ *
  * Return: none
  */
 void qdf_mem_clean(void)
 {
-	uint32_t list_size;
-	list_size = qdf_list_size(&qdf_mem_list);
+	uint32_t list_size = 0;
+	int i;
+
+	for (i = 0; i < QDF_MEM_DEBUG_SHARDS; i++)
+		list_size += qdf_list_size(&qdf_mem_shards[i].list);
 	if (list_size) {
 		qdf_list_node_t *node;
 		QDF_STATUS qdf_status;
+		LIST_HEAD(leaks);
 
-		struct s_qdf_mem_struct *mem_struct;
+		struct s_qdf_mem_struct *mem_struct, *tmp;
 		char *prev_mleak_file = "";
 		unsigned int prev_mleak_line_num = 0;
 		unsigned int prev_mleak_sz = 0;
@@ -353,39 +698,43 @@ void qdf_mem_clean(void)
 			  "%s: List is not Empty. list_size %d ",
 			  __func__, (int)list_size);
 
-		do {
-			qdf_spin_lock(&qdf_mem_list_lock);
-			qdf_status =
-				qdf_list_remove_front(&qdf_mem_list, &node);
-			qdf_spin_unlock(&qdf_mem_list_lock);
-			if (QDF_STATUS_SUCCESS == qdf_status) {
-				mem_struct = (struct s_qdf_mem_struct *)node;
-				/* Take care to log only once multiple memory
-				   leaks from the same place */
-				if (strcmp(prev_mleak_file,
-					mem_struct->file_name)
-				    || (prev_mleak_line_num !=
-					mem_struct->line_num)
-				    || (prev_mleak_sz != mem_struct->size)) {
-					if (mleak_cnt != 0) {
-						QDF_TRACE(QDF_MODULE_ID_QDF,
-							  QDF_TRACE_LEVEL_FATAL,
-							  "%d Time Memory Leak@ File %s, @Line %d, size %d",
-							  mleak_cnt,
-							  prev_mleak_file,
-							  prev_mleak_line_num,
-							  prev_mleak_sz);
-					}
-					prev_mleak_file = mem_struct->file_name;
-					prev_mleak_line_num =
-						 mem_struct->line_num;
-					prev_mleak_sz = mem_struct->size;
-					mleak_cnt = 0;
+		for (i = 0; i < QDF_MEM_DEBUG_SHARDS; i++) {
+			do {
+				qdf_spin_lock_irqsave(&qdf_mem_shards[i].lock);
+				qdf_status = qdf_list_remove_front(
+						&qdf_mem_shards[i].list, &node);
+				qdf_spin_unlock_irqrestore(
+						&qdf_mem_shards[i].lock);
+				if (QDF_STATUS_SUCCESS == qdf_status)
+					list_add_tail(node, &leaks);
+			} while (qdf_status == QDF_STATUS_SUCCESS);
+		}
+		list_sort(NULL, &leaks, qdf_mem_leak_cmp);
+
+		list_for_each_entry_safe(mem_struct, tmp, &leaks, node) {
+			/* Take care to log only once multiple memory
+			   leaks from the same place */
+			if (strcmp(prev_mleak_file, mem_struct->file_name)
+			    || (prev_mleak_line_num != mem_struct->line_num)
+			    || (prev_mleak_sz != mem_struct->size)) {
+				if (mleak_cnt != 0) {
+					QDF_TRACE(QDF_MODULE_ID_QDF,
+						  QDF_TRACE_LEVEL_FATAL,
+						  "%d Time Memory Leak@ File %s, @Line %d, size %d",
+						  mleak_cnt,
+						  prev_mleak_file,
+						  prev_mleak_line_num,
+						  prev_mleak_sz);
 				}
-				mleak_cnt++;
-				kfree((void *)mem_struct);
+				prev_mleak_file = mem_struct->file_name;
+				prev_mleak_line_num = mem_struct->line_num;
+				prev_mleak_sz = mem_struct->size;
+				mleak_cnt = 0;
 			}
-		} while (qdf_status == QDF_STATUS_SUCCESS);
+			mleak_cnt++;
+			list_del(&mem_struct->node);
+			kfree((void *)mem_struct);
+		}
 
 		/* Print last memory leak from the module */
 		if (mleak_cnt) {
@@ -408,9 +757,12 @@ EXPORT_SYMBOL(qdf_mem_clean);
  */
 void qdf_mem_exit(void)
 {
+	int i;
+
 	qdf_net_buf_debug_exit();
 	qdf_mem_clean();
-	qdf_list_destroy(&qdf_mem_list);
+	for (i = 0; i < QDF_MEM_DEBUG_SHARDS; i++)
+		qdf_list_destroy(&qdf_mem_shards[i].list);
 }
 EXPORT_SYMBOL(qdf_mem_exit);
 
@@ -475,6 +827,7 @@ void *qdf_mem_malloc_debug(size_t size,
 			 size, (void *)_RET_IP_, line_num);
 
 	if (mem_struct != NULL) {
+		struct qdf_mem_debug_shard *shard;
 		QDF_STATUS qdf_status;
 
 		mem_struct->file_name = file_name;
@@ -487,10 +840,11 @@ void *qdf_mem_malloc_debug(size_t size,
 		qdf_mem_copy((uint8_t *) (mem_struct + 1) + size,
 			     &WLAN_MEM_TAIL[0], sizeof(WLAN_MEM_TAIL));
 
-		qdf_spin_lock_irqsave(&qdf_mem_list_lock);
-		qdf_status = qdf_list_insert_front(&qdf_mem_list,
+		shard = qdf_mem_shard(mem_struct);
+		qdf_spin_lock_irqsave(&shard->lock);
+		qdf_status = qdf_list_insert_front(&shard->list,
 						   &mem_struct->node);
-		qdf_spin_unlock_irqrestore(&qdf_mem_list_lock);
+		qdf_spin_unlock_irqrestore(&shard->lock);
 		if (QDF_STATUS_SUCCESS != qdf_status) {
 			QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_ERROR,
 				  "%s: Unable to insert node into List qdf_status %d",
@@ -551,6 +905,7 @@ static bool qdf_mem_validate_node_for_free(qdf_list_node_t *qdf_node)
 void qdf_mem_free(void *ptr)
 {
 	struct s_qdf_mem_struct *mem_struct;
+	struct qdf_mem_debug_shard *shard;
 
 	/* freeing a null pointer is valid */
 	if (qdf_unlikely(ptr == NULL))
@@ -569,7 +924,8 @@ void qdf_mem_free(void *ptr)
 		return;
 #endif
 
-	qdf_spin_lock_irqsave(&qdf_mem_list_lock);
+	shard = qdf_mem_shard(mem_struct);
+	qdf_spin_lock_irqsave(&shard->lock);
 
 	/*
 	 * invalid memory access when checking the header/tailer
@@ -601,17 +957,17 @@ void qdf_mem_free(void *ptr)
 	 * make the node an empty list before doing the spin unlock
 	 * The empty list check will guarantee that we avoid a race condition.
 	 */
-	list_del_init(&mem_struct->node);
-	qdf_spin_unlock_irqrestore(&qdf_mem_list_lock);
+	qdf_list_del_init(&shard->list, &mem_struct->node);
+	qdf_spin_unlock_irqrestore(&shard->lock);
 	kfree(mem_struct);
 	return;
 
 error:
-	if (!qdf_list_has_node(&qdf_mem_list, &mem_struct->node)) {
+	if (!qdf_list_has_node(&shard->list, &mem_struct->node)) {
 		QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_FATAL,
 			  "%s: Unallocated memory (double free?)",
 			  __func__);
-		qdf_spin_unlock_irqrestore(&qdf_mem_list_lock);
+		qdf_spin_unlock_irqrestore(&shard->lock);
 		QDF_BUG(0);
 	}
 
@@ -619,14 +975,14 @@ error:
 				sizeof(WLAN_MEM_HEADER))) {
 		QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_FATAL,
 			  "Memory Header is corrupted.");
-		qdf_spin_unlock_irqrestore(&qdf_mem_list_lock);
+		qdf_spin_unlock_irqrestore(&shard->lock);
 		QDF_BUG(0);
 	}
 
 	if (!qdf_mem_validate_node_for_free(&mem_struct->node)) {
 		QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_FATAL,
 			  "Memory_struct is corrupted.");
-		qdf_spin_unlock_irqrestore(&qdf_mem_list_lock);
+		qdf_spin_unlock_irqrestore(&shard->lock);
 		QDF_BUG(0);
 	}
 
@@ -635,13 +991,13 @@ error:
 		QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_FATAL,
 			  "Memory Trailer is corrupted. mem_info: Filename %s, line_num %d",
 			  mem_struct->file_name, (int)mem_struct->line_num);
-		qdf_spin_unlock_irqrestore(&qdf_mem_list_lock);
+		qdf_spin_unlock_irqrestore(&shard->lock);
 		QDF_BUG(0);
 	}
 
 	QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_FATAL,
 		  "%s unexpected error", __func__);
-	qdf_spin_unlock_irqrestore(&qdf_mem_list_lock);
+	qdf_spin_unlock_irqrestore(&shard->lock);
 	QDF_BUG(0);
 }
 EXPORT_SYMBOL(qdf_mem_free);
@@ -32,6 +32,7 @@
 
 #include <linux/module.h>
 #include <qdf_perf.h>
+#include <qdf_trace.h>
 
 MODULE_AUTHOR("Qualcomm Atheros Inc.");
 MODULE_DESCRIPTION("Qualcomm Atheros Device Framework Module");
@@ -63,6 +64,8 @@ static void __exit
 qdf_mod_exit(void)
 {
 	qdf_perfmod_exit();
+	qdf_dp_trace_deinit();
+	qdf_trace_deinit();
 }
 module_exit(qdf_mod_exit);
 
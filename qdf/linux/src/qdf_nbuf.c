@@ -40,6 +40,8 @@
 #include <qdf_status.h>
 #include <qdf_lock.h>
 #include <qdf_trace.h>
+#include <qdf_time.h>
+#include <qdf_timer.h>
 #include <net/ieee80211_radiotap.h>
 
 #if defined(FEATURE_TSO)
@@ -1038,6 +1040,8 @@ bool __qdf_nbuf_data_is_ipv6_tcp_pkt(uint8_t *data)
 }
 
 #ifdef MEMORY_DEBUG
+#include <linux/hash.h>
+
 #define QDF_NET_BUF_TRACK_MAX_SIZE    (1024)
 
 /**
@@ -1048,6 +1052,7 @@ bool __qdf_nbuf_data_is_ipv6_tcp_pkt(uint8_t *data)
  * @file_name: File name
  * @line_num: Line number
  * @size: Size
+ * @alloc_ticks: qdf_system_ticks() when the network buffer was tracked
  */
 struct qdf_nbuf_track_t {
 	struct qdf_nbuf_track_t *p_next;
@@ -1055,6 +1060,7 @@ struct qdf_nbuf_track_t {
 	uint8_t *file_name;
 	uint32_t line_num;
 	size_t size;
+	qdf_time_t alloc_ticks;
 };
 
 static spinlock_t g_qdf_net_buf_track_lock[QDF_NET_BUF_TRACK_MAX_SIZE];
@@ -1070,6 +1076,46 @@ static uint32_t qdf_net_buf_track_max_used;
 static uint32_t qdf_net_buf_track_max_free;
 static uint32_t qdf_net_buf_track_max_allocated;
 
+/* cookies moved between a CPU cache and the global freelist at a time */
+#define QDF_NBUF_TRACK_BATCH 32
+/* cookies a CPU cache holds before it gives a batch back */
+#define QDF_NBUF_TRACK_CPU_MAX (2 * QDF_NBUF_TRACK_BATCH)
+
+/**
+ * struct qdf_nbuf_track_cpu_cache - tracking cookies cached by one CPU
+ * @head: cached cookies, linked through p_next
+ * @count: number of cookies in @head
+ * @used: cookies allocated minus cookies freed on this CPU, may be negative
+ *
+ * Cookies are taken from and given back to the CPU cache with only local
+ * interrupts disabled; the global freelist lock is taken once per batch.
+ */
+struct qdf_nbuf_track_cpu_cache {
+	QDF_NBUF_TRACK *head;
+	uint32_t count;
+	int used;
+};
+
+static DEFINE_PER_CPU(struct qdf_nbuf_track_cpu_cache, qdf_nbuf_track_caches);
+
+/**
+ * qdf_nbuf_track_used() - number of tracking cookies in use
+ *
+ * The per-CPU counts are read without synchronization, so the sum is only
+ * a snapshot.
+ *
+ * Return: cookies in use
+ */
+static uint32_t qdf_nbuf_track_used(void)
+{
+	int cpu, used = 0;
+
+	for_each_possible_cpu(cpu)
+		used += per_cpu_ptr(&qdf_nbuf_track_caches, cpu)->used;
+
+	return used > 0 ? used : 0;
+}
+
 /**
  * update_max_used() - update qdf_net_buf_track_max_used tracking variable
  *
@@ -1082,6 +1128,7 @@ static inline void update_max_used(void)
 {
 	int sum;
 
+	qdf_net_buf_track_used_list_count = qdf_nbuf_track_used();
 	if (qdf_net_buf_track_max_used <
 	    qdf_net_buf_track_used_list_count)
 		qdf_net_buf_track_max_used = qdf_net_buf_track_used_list_count;
@@ -1105,10 +1152,81 @@ static inline void update_max_free(void)
 		qdf_net_buf_track_max_free = qdf_net_buf_track_free_list_count;
 }
 
+/* FREEQ_POOLSIZE initial and minimum desired freelist poolsize */
+#define FREEQ_POOLSIZE 2048
+
+/**
+ * qdf_nbuf_track_refill() - move a batch of cookies into a CPU cache
+ * @cache: cache of the current CPU, called with local interrupts disabled
+ *
+ * Return: none
+ */
+static void qdf_nbuf_track_refill(struct qdf_nbuf_track_cpu_cache *cache)
+{
+	QDF_NBUF_TRACK *node;
+
+	spin_lock(&qdf_net_buf_track_free_list_lock);
+	while (qdf_net_buf_track_free_list != NULL &&
+	       cache->count < QDF_NBUF_TRACK_BATCH) {
+		node = qdf_net_buf_track_free_list;
+		qdf_net_buf_track_free_list = node->p_next;
+		qdf_net_buf_track_free_list_count--;
+		node->p_next = cache->head;
+		cache->head = node;
+		cache->count++;
+	}
+	update_max_used();
+	spin_unlock(&qdf_net_buf_track_free_list_lock);
+}
+
+/**
+ * qdf_nbuf_track_drain() - give cookies of a CPU cache back
+ * @cache: CPU cache, of the current CPU with local interrupts disabled
+ * @count: number of cookies to give back
+ *
+ * The cookies go to the global freelist, or back to the kernel when the
+ * freelist is large.
+ *
+ * Return: none
+ */
+static void qdf_nbuf_track_drain(struct qdf_nbuf_track_cpu_cache *cache,
+				 uint32_t count)
+{
+	QDF_NBUF_TRACK *node;
+	uint32_t used;
+
+	/* Try to shrink the freelist if free_list_count > than FREEQ_POOLSIZE
+	 * only shrink the freelist if it is bigger than twice the number of
+	 * nbufs in use. If the driver is stalling in a consistent bursty
+	 * fasion, this will keep 3/4 of thee allocations from the free list
+	 * while also allowing the system to recover memory as less frantic
+	 * traffic occurs.
+	 */
+
+	spin_lock(&qdf_net_buf_track_free_list_lock);
+	used = qdf_nbuf_track_used();
+	while (cache->head && count--) {
+		node = cache->head;
+		cache->head = node->p_next;
+		cache->count--;
+		if (qdf_net_buf_track_free_list_count > FREEQ_POOLSIZE &&
+		    (qdf_net_buf_track_free_list_count > used << 1)) {
+			kmem_cache_free(nbuf_tracking_cache, node);
+		} else {
+			node->p_next = qdf_net_buf_track_free_list;
+			qdf_net_buf_track_free_list = node;
+			qdf_net_buf_track_free_list_count++;
+		}
+	}
+	update_max_free();
+	spin_unlock(&qdf_net_buf_track_free_list_lock);
+}
+
 /**
  * qdf_nbuf_track_alloc() - allocate a cookie to track nbufs allocated by wlan
  *
- * This function pulls from a freelist if possible and uses kmem_cache_alloc.
+ * This function pulls from the CPU cache, refilled in batches from the
+ * freelist, if possible and uses kmem_cache_alloc otherwise.
  * This function also ads fexibility to adjust the allocation and freelist
  * scheems.
  *
@@ -1118,18 +1236,20 @@ static QDF_NBUF_TRACK *qdf_nbuf_track_alloc(void)
 {
 	int flags = GFP_KERNEL;
 	unsigned long irq_flag;
+	struct qdf_nbuf_track_cpu_cache *cache;
 	QDF_NBUF_TRACK *new_node = NULL;
 
-	spin_lock_irqsave(&qdf_net_buf_track_free_list_lock, irq_flag);
-	qdf_net_buf_track_used_list_count++;
-	if (qdf_net_buf_track_free_list != NULL) {
-		new_node = qdf_net_buf_track_free_list;
-		qdf_net_buf_track_free_list =
-			qdf_net_buf_track_free_list->p_next;
-		qdf_net_buf_track_free_list_count--;
+	local_irq_save(irq_flag);
+	cache = this_cpu_ptr(&qdf_nbuf_track_caches);
+	cache->used++;
+	if (cache->head == NULL)
+		qdf_nbuf_track_refill(cache);
+	if (cache->head != NULL) {
+		new_node = cache->head;
+		cache->head = new_node->p_next;
+		cache->count--;
 	}
-	update_max_used();
-	spin_unlock_irqrestore(&qdf_net_buf_track_free_list_lock, irq_flag);
+	local_irq_restore(irq_flag);
 
 	if (new_node != NULL)
 		return new_node;
@@ -1140,47 +1260,32 @@ static QDF_NBUF_TRACK *qdf_nbuf_track_alloc(void)
 	return kmem_cache_alloc(nbuf_tracking_cache, flags);
 }
 
-/* FREEQ_POOLSIZE initial and minimum desired freelist poolsize */
-#define FREEQ_POOLSIZE 2048
-
 /**
  * qdf_nbuf_track_free() - free the nbuf tracking cookie.
  *
  * Matches calls to qdf_nbuf_track_alloc.
- * Either frees the tracking cookie to kernel or an internal
- * freelist based on the size of the freelist.
+ * The cookie goes to the CPU cache; a full CPU cache gives a batch back to
+ * the freelist or, based on the size of the freelist, to the kernel.
  *
  * Return: none
  */
 static void qdf_nbuf_track_free(QDF_NBUF_TRACK *node)
 {
 	unsigned long irq_flag;
+	struct qdf_nbuf_track_cpu_cache *cache;
 
 	if (!node)
 		return;
 
-	/* Try to shrink the freelist if free_list_count > than FREEQ_POOLSIZE
-	 * only shrink the freelist if it is bigger than twice the number of
-	 * nbufs in use. If the driver is stalling in a consistent bursty
-	 * fasion, this will keep 3/4 of thee allocations from the free list
-	 * while also allowing the system to recover memory as less frantic
-	 * traffic occurs.
-	 */
-
-	spin_lock_irqsave(&qdf_net_buf_track_free_list_lock, irq_flag);
-
-	qdf_net_buf_track_used_list_count--;
-	if (qdf_net_buf_track_free_list_count > FREEQ_POOLSIZE &&
-	   (qdf_net_buf_track_free_list_count >
-	    qdf_net_buf_track_used_list_count << 1)) {
-		kmem_cache_free(nbuf_tracking_cache, node);
-	} else {
-		node->p_next = qdf_net_buf_track_free_list;
-		qdf_net_buf_track_free_list = node;
-		qdf_net_buf_track_free_list_count++;
-	}
-	update_max_free();
-	spin_unlock_irqrestore(&qdf_net_buf_track_free_list_lock, irq_flag);
+	local_irq_save(irq_flag);
+	cache = this_cpu_ptr(&qdf_nbuf_track_caches);
+	cache->used--;
+	node->p_next = cache->head;
+	cache->head = node;
+	cache->count++;
+	if (cache->count > QDF_NBUF_TRACK_CPU_MAX)
+		qdf_nbuf_track_drain(cache, QDF_NBUF_TRACK_BATCH);
+	local_irq_restore(irq_flag);
 }
 
 /**
@@ -1245,10 +1350,20 @@ static void qdf_nbuf_track_memory_manager_create(void)
  */
 static void qdf_nbuf_track_memory_manager_destroy(void)
 {
+	struct qdf_nbuf_track_cpu_cache *cache;
 	QDF_NBUF_TRACK *node, *tmp;
 	unsigned long irq_flag;
+	int cpu;
+
+	local_irq_save(irq_flag);
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(&qdf_nbuf_track_caches, cpu);
+		qdf_nbuf_track_drain(cache, cache->count);
+	}
+	local_irq_restore(irq_flag);
 
 	spin_lock_irqsave(&qdf_net_buf_track_free_list_lock, irq_flag);
+	qdf_net_buf_track_used_list_count = qdf_nbuf_track_used();
 	node = qdf_net_buf_track_free_list;
 
 	qdf_print("%s: %d residual freelist size\n",
@@ -1282,6 +1397,162 @@ static void qdf_nbuf_track_memory_manager_destroy(void)
 	kmem_cache_destroy(nbuf_tracking_cache);
 }
 
+#define QDF_NBUF_AGE_SITE_BITS 6
+/* allocation sites a single age report can tell apart */
+#define QDF_NBUF_AGE_MAX_SITES (1 << QDF_NBUF_AGE_SITE_BITS)
+
+/**
+ * struct qdf_nbuf_age_site - long-held nbufs of one allocation site
+ * @file_name: file of the allocation site, NULL for an unused entry
+ * @line_num: line of the allocation site
+ * @count: nbufs still held
+ * @size: total size of those nbufs
+ * @oldest_ms: age of the oldest of them
+ */
+struct qdf_nbuf_age_site {
+	uint8_t *file_name;
+	uint32_t line_num;
+	uint32_t count;
+	size_t size;
+	uint32_t oldest_ms;
+};
+
+static struct qdf_nbuf_age_site qdf_nbuf_age_sites[QDF_NBUF_AGE_MAX_SITES];
+/* serializes age reports, which share qdf_nbuf_age_sites */
+static spinlock_t qdf_nbuf_age_lock;
+static qdf_timer_t qdf_nbuf_age_timer;
+static uint32_t qdf_nbuf_age_period_ms;
+static uint32_t qdf_nbuf_age_min_ms;
+
+/**
+ * qdf_nbuf_age_site_get() - entry of an allocation site in the age report
+ * @file_name: file of the allocation site
+ * @line_num: line of the allocation site
+ *
+ * Return: entry for the site, NULL if the table is full
+ */
+static struct qdf_nbuf_age_site *qdf_nbuf_age_site_get(uint8_t *file_name,
+						       uint32_t line_num)
+{
+	struct qdf_nbuf_age_site *site;
+	uint32_t i, idx;
+
+	idx = hash_long((unsigned long)file_name + line_num,
+			QDF_NBUF_AGE_SITE_BITS);
+	for (i = 0; i < QDF_NBUF_AGE_MAX_SITES; i++) {
+		site = &qdf_nbuf_age_sites[(idx + i) &
+					   (QDF_NBUF_AGE_MAX_SITES - 1)];
+		if (site->file_name == NULL) {
+			site->file_name = file_name;
+			site->line_num = line_num;
+			return site;
+		}
+		if (site->file_name == file_name &&
+		    site->line_num == line_num)
+			return site;
+	}
+
+	return NULL;
+}
+
+/**
+ * qdf_net_buf_debug_age_report() - report nbufs held for a long time
+ * @min_age_ms: only nbufs tracked for at least this long are reported
+ *
+ * Walks the tracking table and prints, per allocation site, how many
+ * nbufs are still held, their total size and the age of the oldest one.
+ *
+ * Return: none
+ */
+void qdf_net_buf_debug_age_report(uint32_t min_age_ms)
+{
+	struct qdf_nbuf_age_site *site;
+	qdf_time_t now = qdf_system_ticks();
+	unsigned long irq_flag;
+	QDF_NBUF_TRACK *p_node;
+	uint32_t i, age_ms, total = 0, not_shown = 0;
+
+	spin_lock_bh(&qdf_nbuf_age_lock);
+	for (i = 0; i < QDF_NET_BUF_TRACK_MAX_SIZE; i++) {
+		spin_lock_irqsave(&g_qdf_net_buf_track_lock[i], irq_flag);
+		for (p_node = gp_qdf_net_buf_track_tbl[i]; p_node;
+		     p_node = p_node->p_next) {
+			age_ms = qdf_system_ticks_to_msecs(now -
+							   p_node->alloc_ticks);
+			if (age_ms < min_age_ms)
+				continue;
+			total++;
+			site = qdf_nbuf_age_site_get(p_node->file_name,
+						     p_node->line_num);
+			if (!site) {
+				not_shown++;
+				continue;
+			}
+			site->count++;
+			site->size += p_node->size;
+			if (site->oldest_ms < age_ms)
+				site->oldest_ms = age_ms;
+		}
+		spin_unlock_irqrestore(&g_qdf_net_buf_track_lock[i], irq_flag);
+	}
+
+	qdf_print("%s: %u nbufs held for %u ms or more\n",
+		  __func__, total, min_age_ms);
+	for (i = 0; i < QDF_NBUF_AGE_MAX_SITES; i++) {
+		site = &qdf_nbuf_age_sites[i];
+		if (site->file_name == NULL)
+			continue;
+		qdf_print("%s: %u nbufs from %s %d, %zu bytes, oldest %u ms\n",
+			  __func__, site->count, site->file_name,
+			  site->line_num, site->size, site->oldest_ms);
+	}
+	if (not_shown)
+		qdf_print("%s: %u nbufs from further sites not shown\n",
+			  __func__, not_shown);
+
+	qdf_mem_zero(qdf_nbuf_age_sites, sizeof(qdf_nbuf_age_sites));
+	spin_unlock_bh(&qdf_nbuf_age_lock);
+}
+EXPORT_SYMBOL(qdf_net_buf_debug_age_report);
+
+/**
+ * qdf_net_buf_age_timeout() - periodic age report
+ * @arg: not used
+ *
+ * Return: none
+ */
+static void qdf_net_buf_age_timeout(void *arg)
+{
+	uint32_t period_ms = qdf_nbuf_age_period_ms;
+
+	if (!period_ms)
+		return;
+
+	qdf_net_buf_debug_age_report(qdf_nbuf_age_min_ms);
+	qdf_timer_mod(&qdf_nbuf_age_timer, period_ms);
+}
+
+/**
+ * qdf_net_buf_debug_set_age_report() - configure the periodic age report
+ * @period_ms: report interval, 0 to stop reporting
+ * @min_age_ms: only nbufs tracked for at least this long are reported
+ *
+ * Must not be called from atomic context.
+ *
+ * Return: none
+ */
+void qdf_net_buf_debug_set_age_report(uint32_t period_ms, uint32_t min_age_ms)
+{
+	qdf_nbuf_age_period_ms = 0;
+	qdf_timer_sync_cancel(&qdf_nbuf_age_timer);
+
+	qdf_nbuf_age_min_ms = min_age_ms;
+	qdf_nbuf_age_period_ms = period_ms;
+	if (period_ms)
+		qdf_timer_mod(&qdf_nbuf_age_timer, period_ms);
+}
+EXPORT_SYMBOL(qdf_net_buf_debug_set_age_report);
+
 /**
  * qdf_net_buf_debug_init() - initialize network buffer debug functionality
  *
@@ -1304,6 +1575,11 @@ void qdf_net_buf_debug_init(void)
 		spin_lock_init(&g_qdf_net_buf_track_lock[i]);
 	}
 
+	spin_lock_init(&qdf_nbuf_age_lock);
+	qdf_nbuf_age_period_ms = 0;
+	qdf_timer_init(NULL, &qdf_nbuf_age_timer, qdf_net_buf_age_timeout,
+		       NULL, QDF_TIMER_TYPE_SW);
+
 	return;
 }
 EXPORT_SYMBOL(qdf_net_buf_debug_init);
@@ -1324,6 +1600,9 @@ void qdf_net_buf_debug_exit(void)
 	QDF_NBUF_TRACK *p_node;
 	QDF_NBUF_TRACK *p_prev;
 
+	qdf_nbuf_age_period_ms = 0;
+	qdf_timer_free(&qdf_nbuf_age_timer);
+
 	for (i = 0; i < QDF_NET_BUF_TRACK_MAX_SIZE; i++) {
 		spin_lock_irqsave(&g_qdf_net_buf_track_lock[i], irq_flag);
 		p_node = gp_qdf_net_buf_track_tbl[i];
@@ -1419,6 +1698,7 @@ void qdf_net_buf_debug_add_node(qdf_nbuf_t net_buf, size_t size,
 			p_node->file_name = file_name;
 			p_node->line_num = line_num;
 			p_node->size = size;
+			p_node->alloc_ticks = qdf_system_ticks();
 			p_node->p_next = gp_qdf_net_buf_track_tbl[i];
 			gp_qdf_net_buf_track_tbl[i] = p_node;
 		} else {
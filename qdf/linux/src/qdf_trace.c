@@ -36,6 +36,10 @@
 #include <ani_global.h>
 #include <wlan_logging_sock_svc.h>
 #include "qdf_time.h"
+#include <linux/percpu.h>
+#include <linux/log2.h>
+#include <linux/vmalloc.h>
+#include <linux/mutex.h>
 /* Preprocessor definitions and constants */
 
 #define QDF_TRACE_BUFFER_SIZE (512)
@@ -86,10 +90,38 @@ module_trace_info g_qdf_trace_info[QDF_MODULE_ID_MAX] = {
 	[QDF_MODULE_ID_HTT] = {QDF_DEFAULT_TRACE_LEVEL, "HTT"},
 };
 
+/**
+ * struct qdf_trace_ring_cursor - position of a dump in one per-CPU ring
+ * @next: next record to show
+ * @end: tail of the ring when the dump started
+ */
+struct qdf_trace_ring_cursor {
+	uint32_t next;
+	uint32_t end;
+};
+
+/**
+ * struct qdf_trace_merge - per-CPU rings merged by a dump
+ * @cursor: dump position in each CPU's ring
+ * @tail: records written so far on a CPU, 0 if the CPU has no ring
+ * @time: timestamp of the record in a slot of a CPU's ring
+ */
+struct qdf_trace_merge {
+	struct qdf_trace_ring_cursor __percpu *cursor;
+	uint32_t (*tail)(int cpu);
+	uint64_t (*time)(int cpu, uint32_t slot);
+};
+
 /* Static and Global variables */
-static spinlock_t ltrace_lock;
 
-static qdf_trace_record_t g_qdf_trace_tbl[MAX_QDF_TRACE_RECORDS];
+/*
+ * each possible CPU records into a ring of its own, so qdf_trace() takes
+ * no lock
+ */
+static DEFINE_PER_CPU(struct qdf_trace_cpu_ring, qdf_trace_rings);
+static DEFINE_PER_CPU(struct qdf_trace_ring_cursor, qdf_trace_cursors);
+/* serializes dumps, which own qdf_trace_cursors while they run */
+static DEFINE_MUTEX(ltrace_dump_lock);
 /* global qdf trace data */
 static t_qdf_trace_data g_qdf_trace_data;
 /*
@@ -105,10 +137,15 @@ static tp_qdf_trace_cb qdf_trace_restore_cb_table[QDF_MODULE_ID_MAX];
 
 #ifdef FEATURE_DP_TRACE
 /* Static and Global variables */
-static spinlock_t l_dp_trace_lock;
 
-static struct qdf_dp_trace_record_s
-			g_qdf_dp_trace_tbl[MAX_QDF_DP_TRACE_RECORDS];
+/*
+ * each possible CPU records into a ring of its own, so adding a record
+ * takes no lock
+ */
+static DEFINE_PER_CPU(struct qdf_dp_trace_cpu_ring, qdf_dp_trace_rings);
+static DEFINE_PER_CPU(struct qdf_trace_ring_cursor, qdf_dp_trace_cursors);
+/* serializes dumps, which own qdf_dp_trace_cursors while they run */
+static DEFINE_MUTEX(l_dp_trace_dump_lock);
 
 /*
  * all the options to configure/control DP trace are
@@ -121,6 +158,76 @@ static struct s_qdf_dp_trace_data g_qdf_dp_trace_data;
  */
 static tp_qdf_dp_trace_cb qdf_dp_trace_cb_table[QDF_DP_TRACE_MAX];
 #endif
+
+/**
+ * qdf_trace_merge_next() - next record of a walk over per-CPU rings
+ * @merge: rings being walked
+ * @entries: records per ring, a power of two
+ * @cpu: set to the CPU whose ring holds the record
+ * @slot: set to the slot of the record in that ring
+ *
+ * Return: false once every ring has been walked
+ */
+static bool qdf_trace_merge_next(const struct qdf_trace_merge *merge,
+				 uint32_t entries, int *cpu, uint32_t *slot)
+{
+	struct qdf_trace_ring_cursor *cursor;
+	uint64_t time, pick_time = 0;
+	int c, pick = -1;
+
+	for_each_possible_cpu(c) {
+		cursor = per_cpu_ptr(merge->cursor, c);
+		if (cursor->next == cursor->end)
+			continue;
+		time = merge->time(c, cursor->next & (entries - 1));
+		if (pick < 0 || time < pick_time) {
+			pick = c;
+			pick_time = time;
+		}
+	}
+	if (pick < 0)
+		return false;
+
+	*cpu = pick;
+	*slot = per_cpu_ptr(merge->cursor, pick)->next++ & (entries - 1);
+	return true;
+}
+
+/**
+ * qdf_trace_merge_start() - start walking per-CPU rings oldest record first
+ * @merge: rings to walk
+ * @entries: records per ring, a power of two
+ * @count: number of newest records to walk, 0 for all of them
+ *
+ * Recording goes on while the rings are walked. Only the records written
+ * before the walk started are visited, but one that is overwritten while
+ * the caller copies it may come out half updated. The caller serializes
+ * walks over the same cursors.
+ *
+ * Return: number of records held by the rings
+ */
+static uint32_t qdf_trace_merge_start(const struct qdf_trace_merge *merge,
+				      uint32_t entries, uint32_t count)
+{
+	struct qdf_trace_ring_cursor *cursor;
+	uint32_t total = 0, skip = 0, slot;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		cursor = per_cpu_ptr(merge->cursor, cpu);
+		cursor->end = merge->tail(cpu);
+		cursor->next = cursor->end - QDF_MIN(cursor->end, entries);
+		total += cursor->end - cursor->next;
+	}
+
+	if (count && count < total)
+		skip = total - count;
+	while (skip-- && qdf_trace_merge_next(merge, entries, &cpu, &slot))
+		;
+
+	return total;
+}
+
 /**
  * qdf_trace_set_level() - Set the trace level for a particular module
  * @module: Module id
@@ -497,12 +604,8 @@ EXPORT_SYMBOL(qdf_trace_enable);
 void qdf_trace_init(void)
 {
 	uint8_t i;
-	g_qdf_trace_data.head = INVALID_QDF_TRACE_ADDR;
-	g_qdf_trace_data.tail = INVALID_QDF_TRACE_ADDR;
-	g_qdf_trace_data.num = 0;
 	g_qdf_trace_data.enable = true;
 	g_qdf_trace_data.dump_count = DEFAULT_QDF_TRACE_DUMP_COUNT;
-	g_qdf_trace_data.num_since_last_dump = 0;
 
 	for (i = 0; i < QDF_MODULE_ID_MAX; i++) {
 		qdf_trace_cb_table[i] = NULL;
@@ -522,12 +625,16 @@ EXPORT_SYMBOL(qdf_trace_init);
  * in circular queue. Before calling this functions make sure you have
  * registered your module with qdf through qdf_trace_register function.
  *
+ * The record goes to this CPU's ring with only preemption disabled. A
+ * record made from an interrupt on top of this one claims the next slot.
+ *
  * Return: None
  */
 void qdf_trace(uint8_t module, uint8_t code, uint16_t session, uint32_t data)
 {
+	struct qdf_trace_cpu_ring *ring;
 	tp_qdf_trace_record rec = NULL;
-	unsigned long flags;
+	uint32_t slot;
 
 	if (!g_qdf_trace_data.enable)
 		return;
@@ -536,63 +643,102 @@ void qdf_trace(uint8_t module, uint8_t code, uint16_t session, uint32_t data)
 	if (NULL == qdf_trace_cb_table[module])
 		return;
 
-	/* Aquire the lock so that only one thread at a time can fill the ring
-	 * buffer
-	 */
-	spin_lock_irqsave(&ltrace_lock, flags);
-
-	g_qdf_trace_data.num++;
-
-	if (g_qdf_trace_data.num > MAX_QDF_TRACE_RECORDS)
-		g_qdf_trace_data.num = MAX_QDF_TRACE_RECORDS;
-
-	if (INVALID_QDF_TRACE_ADDR == g_qdf_trace_data.head) {
-		/* first record */
-		g_qdf_trace_data.head = 0;
-		g_qdf_trace_data.tail = 0;
-	} else {
-		/* queue is not empty */
-		uint32_t tail = g_qdf_trace_data.tail + 1;
-
-		if (MAX_QDF_TRACE_RECORDS == tail)
-			tail = 0;
-
-		if (g_qdf_trace_data.head == tail) {
-			/* full */
-			if (MAX_QDF_TRACE_RECORDS == ++g_qdf_trace_data.head)
-				g_qdf_trace_data.head = 0;
-		}
-		g_qdf_trace_data.tail = tail;
+	ring = get_cpu_ptr(&qdf_trace_rings);
+	if (!ring->buf) {
+		put_cpu_ptr(&qdf_trace_rings);
+		return;
 	}
 
-	rec = &g_qdf_trace_tbl[g_qdf_trace_data.tail];
+	slot = this_cpu_inc_return(qdf_trace_rings.tail) - 1;
+	rec = &ring->buf[slot & (g_qdf_trace_data.entries - 1)];
 	rec->code = code;
 	rec->session = session;
 	rec->data = data;
 	rec->time = qdf_get_log_timestamp();
 	rec->module = module;
 	rec->pid = (in_interrupt() ? 0 : current->pid);
-	g_qdf_trace_data.num_since_last_dump++;
-	spin_unlock_irqrestore(&ltrace_lock, flags);
+	put_cpu_ptr(&qdf_trace_rings);
 }
 EXPORT_SYMBOL(qdf_trace);
 
 /**
- * qdf_trace_spin_lock_init() - initializes the lock variable before use
+ * qdf_trace_spin_lock_init() - allocate the per-CPU trace rings
  *
- * This function will be called from cds_alloc_global_context, we will have lock
- * available to use ASAP
+ * This function will be called from cds_alloc_global_context, so records can
+ * be added ASAP.
  *
- * Return: None
+ * Each possible CPU gets QDF_TRACE_RECORDS_PER_CPU records. Rings that were
+ * allocated by an earlier call are kept and emptied.
+ *
+ * Return: QDF_STATUS_SUCCESS, or QDF_STATUS_E_NOMEM if a CPU has no ring
+ *	and will not record
  */
 QDF_STATUS qdf_trace_spin_lock_init(void)
 {
-	spin_lock_init(&ltrace_lock);
+	struct qdf_trace_cpu_ring *ring;
+	QDF_STATUS status = QDF_STATUS_SUCCESS;
+	int cpu;
+
+	g_qdf_trace_data.entries =
+		rounddown_pow_of_two(QDF_TRACE_RECORDS_PER_CPU);
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&qdf_trace_rings, cpu);
+		ring->tail = 0;
+		if (!ring->buf)
+			ring->buf = vzalloc(g_qdf_trace_data.entries *
+					    sizeof(*ring->buf));
+		if (!ring->buf)
+			status = QDF_STATUS_E_NOMEM;
+	}
 
-	return QDF_STATUS_SUCCESS;
+	return status;
 }
 EXPORT_SYMBOL(qdf_trace_spin_lock_init);
 
+/**
+ * qdf_trace_deinit() - free the per-CPU trace rings
+ *
+ * Called on qdf module exit, once nothing records MTRACE anymore.
+ *
+ * Return: None
+ */
+void qdf_trace_deinit(void)
+{
+	struct qdf_trace_cpu_ring *ring;
+	tp_qdf_trace_record buf;
+	int cpu;
+
+	mutex_lock(&ltrace_dump_lock);
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&qdf_trace_rings, cpu);
+		buf = ring->buf;
+		ring->buf = NULL;
+		ring->tail = 0;
+		vfree(buf);
+	}
+	mutex_unlock(&ltrace_dump_lock);
+}
+EXPORT_SYMBOL(qdf_trace_deinit);
+
+static uint32_t qdf_trace_ring_tail(int cpu)
+{
+	struct qdf_trace_cpu_ring *ring = per_cpu_ptr(&qdf_trace_rings, cpu);
+
+	return ring->buf ? READ_ONCE(ring->tail) : 0;
+}
+
+static uint64_t qdf_trace_ring_time(int cpu, uint32_t slot)
+{
+	return per_cpu_ptr(&qdf_trace_rings, cpu)->buf[slot].time;
+}
+
+static const struct qdf_trace_merge qdf_trace_merge = {
+	.cursor = &qdf_trace_cursors,
+	.tail = qdf_trace_ring_tail,
+	.time = qdf_trace_ring_time,
+};
+
 /**
  * qdf_trace_register() - registers the call back functions
  * @module_iD: enum value of module
@@ -631,13 +777,18 @@ EXPORT_SYMBOL(qdf_trace_register);
  * <n> messages. It is optional, if you don't provide then it will dump
  * everything from buffer.
  *
+ * The per-CPU rings are merged on their record timestamps, see
+ * qdf_trace_merge_start(). Must be called from process context.
+ *
  * Return: None
  */
 void qdf_trace_dump_all(void *p_mac, uint8_t code, uint8_t session,
 			uint32_t count, uint32_t bitmask_of_module)
 {
 	qdf_trace_record_t p_record;
-	int32_t i, tail;
+	uint32_t entries = g_qdf_trace_data.entries;
+	uint32_t total, slot;
+	int cpu;
 
 	if (!g_qdf_trace_data.enable) {
 		QDF_TRACE(QDF_MODULE_ID_SYS,
@@ -645,74 +796,25 @@ void qdf_trace_dump_all(void *p_mac, uint8_t code, uint8_t session,
 		return;
 	}
 
-	QDF_TRACE(QDF_MODULE_ID_SYS, QDF_TRACE_LEVEL_INFO,
-		  "Total Records: %d, Head: %d, Tail: %d",
-		  g_qdf_trace_data.num, g_qdf_trace_data.head,
-		  g_qdf_trace_data.tail);
-
-	/* aquire the lock so that only one thread at a time can read
-	 * the ring buffer
-	 */
-	spin_lock(&ltrace_lock);
-
-	if (g_qdf_trace_data.head != INVALID_QDF_TRACE_ADDR) {
-		i = g_qdf_trace_data.head;
-		tail = g_qdf_trace_data.tail;
-
-		if (count) {
-			if (count > g_qdf_trace_data.num)
-				count = g_qdf_trace_data.num;
-			if (tail >= (count - 1))
-				i = tail - count + 1;
-			else if (count != MAX_QDF_TRACE_RECORDS)
-				i = MAX_QDF_TRACE_RECORDS - ((count - 1) -
-							     tail);
-		}
-
-		p_record = g_qdf_trace_tbl[i];
-		/* right now we are not using num_since_last_dump member but
-		 * in future we might re-visit and use this member to track
-		 * how many latest messages got added while we were dumping
-		 * from ring buffer
-		 */
-		g_qdf_trace_data.num_since_last_dump = 0;
-		spin_unlock(&ltrace_lock);
-		for (;; ) {
-			if ((code == 0 || (code == p_record.code)) &&
-			    (qdf_trace_cb_table[p_record.module] != NULL)) {
-				if (0 == bitmask_of_module) {
-					qdf_trace_cb_table[p_record.
-							   module] (p_mac,
-								    &p_record,
-								    (uint16_t)
-								    i);
-				} else {
-					if (bitmask_of_module &
-					    (1 << p_record.module)) {
-						qdf_trace_cb_table[p_record.
-								   module]
-							(p_mac, &p_record,
-							(uint16_t) i);
-					}
-				}
-			}
-
-			if (i == tail)
-				break;
-			i += 1;
+	mutex_lock(&ltrace_dump_lock);
+	total = qdf_trace_merge_start(&qdf_trace_merge, entries, count);
 
-			spin_lock(&ltrace_lock);
-			if (MAX_QDF_TRACE_RECORDS == i) {
-				i = 0;
-				p_record = g_qdf_trace_tbl[0];
-			} else {
-				p_record = g_qdf_trace_tbl[i];
-			}
-			spin_unlock(&ltrace_lock);
+	QDF_TRACE(QDF_MODULE_ID_SYS, QDF_TRACE_LEVEL_INFO,
+		  "Total Records: %d, Records per CPU: %d", total, entries);
+
+	while (qdf_trace_merge_next(&qdf_trace_merge, entries, &cpu, &slot)) {
+		p_record = per_cpu_ptr(&qdf_trace_rings, cpu)->buf[slot];
+		if (p_record.module >= QDF_MODULE_ID_MAX)
+			continue;
+		if ((code == 0 || (code == p_record.code)) &&
+		    (qdf_trace_cb_table[p_record.module] != NULL)) {
+			if (0 == bitmask_of_module ||
+			    (bitmask_of_module & (1 << p_record.module)))
+				qdf_trace_cb_table[p_record.module]
+					(p_mac, &p_record, (uint16_t)slot);
 		}
-	} else {
-		spin_unlock(&ltrace_lock);
 	}
+	mutex_unlock(&ltrace_dump_lock);
 }
 EXPORT_SYMBOL(qdf_trace_dump_all);
 
@@ -728,9 +830,6 @@ void qdf_dp_trace_init(void)
 	uint8_t i;
 
 	qdf_dp_trace_spin_lock_init();
-	g_qdf_dp_trace_data.head = INVALID_QDF_DP_TRACE_ADDR;
-	g_qdf_dp_trace_data.tail = INVALID_QDF_DP_TRACE_ADDR;
-	g_qdf_dp_trace_data.num = 0;
 	g_qdf_dp_trace_data.proto_bitmap = QDF_NBUF_PKT_TRAC_TYPE_EAPOL |
 	    QDF_NBUF_PKT_TRAC_TYPE_DHCP | QDF_NBUF_PKT_TRAC_TYPE_MGMT_ACTION;
 	g_qdf_dp_trace_data.no_of_record = 0;
@@ -824,17 +923,19 @@ uint8_t qdf_dp_get_proto_bitmap(void)
  * @nbuf: defines the netbuf
  * @dir: direction
  *
+ * Packets are counted per CPU, so every no_of_record'th packet of each CPU
+ * is traced.
+ *
  * Return: None
  */
 void qdf_dp_trace_set_track(qdf_nbuf_t nbuf, enum qdf_proto_dir dir)
 {
 	uint32_t count = 0;
 
-	spin_lock_bh(&l_dp_trace_lock);
 	if (QDF_TX == dir)
-		count = ++g_qdf_dp_trace_data.tx_count;
+		count = this_cpu_inc_return(qdf_dp_trace_rings.tx_count);
 	else if (QDF_RX == dir)
-		count = ++g_qdf_dp_trace_data.rx_count;
+		count = this_cpu_inc_return(qdf_dp_trace_rings.rx_count);
 
 	if ((g_qdf_dp_trace_data.no_of_record != 0) &&
 		(count % g_qdf_dp_trace_data.no_of_record == 0)) {
@@ -843,7 +944,6 @@ void qdf_dp_trace_set_track(qdf_nbuf_t nbuf, enum qdf_proto_dir dir)
 		else if (QDF_RX == dir)
 			QDF_NBUF_CB_RX_DP_TRACE(nbuf) = 1;
 	}
-	spin_unlock_bh(&l_dp_trace_lock);
 	return;
 }
 EXPORT_SYMBOL(qdf_dp_trace_set_track);
@@ -1066,36 +1166,20 @@ EXPORT_SYMBOL(qdf_dp_enable_check);
 void qdf_dp_add_record(enum QDF_DP_TRACE_ID code,
 		       uint8_t *data, uint8_t size, bool print)
 {
-	struct qdf_dp_trace_record_s *rec = NULL;
-	int index;
-	spin_lock_bh(&l_dp_trace_lock);
-
-	g_qdf_dp_trace_data.num++;
-
-	if (g_qdf_dp_trace_data.num > MAX_QDF_DP_TRACE_RECORDS)
-		g_qdf_dp_trace_data.num = MAX_QDF_DP_TRACE_RECORDS;
-
-	if (INVALID_QDF_DP_TRACE_ADDR == g_qdf_dp_trace_data.head) {
-		/* first record */
-		g_qdf_dp_trace_data.head = 0;
-		g_qdf_dp_trace_data.tail = 0;
-	} else {
-		/* queue is not empty */
-		g_qdf_dp_trace_data.tail++;
-
-		if (MAX_QDF_DP_TRACE_RECORDS == g_qdf_dp_trace_data.tail)
-			g_qdf_dp_trace_data.tail = 0;
+	struct qdf_dp_trace_cpu_ring *ring;
+	struct qdf_dp_trace_record_s *rec;
+	uint32_t slot;
 
-		if (g_qdf_dp_trace_data.head == g_qdf_dp_trace_data.tail) {
-			/* full */
-			if (MAX_QDF_DP_TRACE_RECORDS ==
-				++g_qdf_dp_trace_data.head)
-				g_qdf_dp_trace_data.head = 0;
-		}
+	ring = get_cpu_ptr(&qdf_dp_trace_rings);
+	if (!ring->buf) {
+		put_cpu_ptr(&qdf_dp_trace_rings);
+		return;
 	}
 
-	rec = &g_qdf_dp_trace_tbl[g_qdf_dp_trace_data.tail];
-	index = g_qdf_dp_trace_data.tail;
+	/* a record added from softirq on top of this one gets its own slot */
+	slot = this_cpu_inc_return(qdf_dp_trace_rings.tail) - 1;
+	slot &= g_qdf_dp_trace_data.entries - 1;
+	rec = &ring->buf[slot];
 	rec->code = code;
 	rec->size = 0;
 	if (data != NULL && size > 0) {
@@ -1107,10 +1191,10 @@ void qdf_dp_add_record(enum QDF_DP_TRACE_ID code,
 	}
 	rec->time = qdf_get_log_timestamp();
 	rec->pid = (in_interrupt() ? 0 : current->pid);
-	spin_unlock_bh(&l_dp_trace_lock);
+	put_cpu_ptr(&qdf_dp_trace_rings);
 
 	if (g_qdf_dp_trace_data.live_mode || (print == true))
-		qdf_dp_trace_cb_table[rec->code] (rec, index);
+		qdf_dp_trace_cb_table[rec->code] (rec, (uint16_t)slot);
 }
 EXPORT_SYMBOL(qdf_dp_add_record);
 
@@ -1457,18 +1541,82 @@ void qdf_dp_trace(qdf_nbuf_t nbuf, enum QDF_DP_TRACE_ID code,
 EXPORT_SYMBOL(qdf_dp_trace);
 
 /**
- * qdf_dp_trace_spin_lock_init() - initializes the lock variable before use
- * This function will be called from cds_alloc_global_context, we will have lock
- * available to use ASAP
+ * qdf_dp_trace_spin_lock_init() - allocate the per-CPU trace rings
+ * This function will be called from cds_alloc_global_context, so records can
+ * be added ASAP.
+ *
+ * Each possible CPU gets QDF_DP_TRACE_RECORDS_PER_CPU records. Rings that
+ * were allocated by an earlier call are kept and emptied. A CPU whose ring
+ * cannot be allocated records nothing.
  *
  * Return: None
  */
 void qdf_dp_trace_spin_lock_init(void)
 {
-	spin_lock_init(&l_dp_trace_lock);
+	struct qdf_dp_trace_cpu_ring *ring;
+	int cpu;
+
+	g_qdf_dp_trace_data.entries =
+		rounddown_pow_of_two(QDF_DP_TRACE_RECORDS_PER_CPU);
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&qdf_dp_trace_rings, cpu);
+		ring->tail = 0;
+		if (!ring->buf)
+			ring->buf = vzalloc(g_qdf_dp_trace_data.entries *
+					    sizeof(*ring->buf));
+		if (!ring->buf)
+			QDF_TRACE(QDF_MODULE_ID_QDF, QDF_TRACE_LEVEL_ERROR,
+				  "%s: no DP trace ring for cpu %d",
+				  __func__, cpu);
+	}
 }
 EXPORT_SYMBOL(qdf_dp_trace_spin_lock_init);
 
+/**
+ * qdf_dp_trace_deinit() - free the per-CPU trace rings
+ *
+ * Called on qdf module exit, once nothing records DP trace anymore.
+ *
+ * Return: None
+ */
+void qdf_dp_trace_deinit(void)
+{
+	struct qdf_dp_trace_cpu_ring *ring;
+	struct qdf_dp_trace_record_s *buf;
+	int cpu;
+
+	mutex_lock(&l_dp_trace_dump_lock);
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&qdf_dp_trace_rings, cpu);
+		buf = ring->buf;
+		ring->buf = NULL;
+		ring->tail = 0;
+		vfree(buf);
+	}
+	mutex_unlock(&l_dp_trace_dump_lock);
+}
+EXPORT_SYMBOL(qdf_dp_trace_deinit);
+
+static uint32_t qdf_dp_trace_ring_tail(int cpu)
+{
+	struct qdf_dp_trace_cpu_ring *ring =
+		per_cpu_ptr(&qdf_dp_trace_rings, cpu);
+
+	return ring->buf ? READ_ONCE(ring->tail) : 0;
+}
+
+static uint64_t qdf_dp_trace_ring_time(int cpu, uint32_t slot)
+{
+	return per_cpu_ptr(&qdf_dp_trace_rings, cpu)->buf[slot].time;
+}
+
+static const struct qdf_trace_merge qdf_dp_trace_merge = {
+	.cursor = &qdf_dp_trace_cursors,
+	.tail = qdf_dp_trace_ring_tail,
+	.time = qdf_dp_trace_ring_time,
+};
+
 /**
  * qdf_dp_trace_enable_live_mode() - enable live mode for dptrace
  *
@@ -1489,32 +1637,40 @@ EXPORT_SYMBOL(qdf_dp_trace_enable_live_mode);
  */
 void qdf_dp_trace_clear_buffer(void)
 {
-	g_qdf_dp_trace_data.head = INVALID_QDF_DP_TRACE_ADDR;
-	g_qdf_dp_trace_data.tail = INVALID_QDF_DP_TRACE_ADDR;
-	g_qdf_dp_trace_data.num = 0;
+	struct qdf_dp_trace_cpu_ring *ring;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(&qdf_dp_trace_rings, cpu);
+		ring->tail = 0;
+		if (ring->buf)
+			memset(ring->buf, 0, g_qdf_dp_trace_data.entries *
+			       sizeof(*ring->buf));
+	}
 	g_qdf_dp_trace_data.proto_bitmap = QDF_NBUF_PKT_TRAC_TYPE_EAPOL |
 	    QDF_NBUF_PKT_TRAC_TYPE_DHCP | QDF_NBUF_PKT_TRAC_TYPE_MGMT_ACTION;
 	g_qdf_dp_trace_data.no_of_record = 0;
 	g_qdf_dp_trace_data.verbosity    = QDF_DP_TRACE_VERBOSITY_LOW;
 	g_qdf_dp_trace_data.enable = true;
-
-	memset(g_qdf_dp_trace_tbl, 0,
-	   MAX_QDF_DP_TRACE_RECORDS * sizeof(struct qdf_dp_trace_record_s));
 }
 EXPORT_SYMBOL(qdf_dp_trace_clear_buffer);
 
 /**
  * qdf_dp_trace_dump_all() - Dump data from ring buffer via call back functions
  * registered with QDF
- * @code: Reason code
- * @count: Number of lines to dump starting from tail to head
+ * @count: Number of records to dump, oldest first, 0 to dump all
+ *
+ * The per-CPU rings are merged on their record timestamps, see
+ * qdf_trace_merge_start(). Must be called from process context.
  *
  * Return: None
  */
 void qdf_dp_trace_dump_all(uint32_t count)
 {
 	struct qdf_dp_trace_record_s p_record;
-	int32_t i, tail;
+	uint32_t entries = g_qdf_dp_trace_data.entries;
+	uint32_t total, slot;
+	int cpu;
 
 	if (!g_qdf_dp_trace_data.enable) {
 		QDF_TRACE(QDF_MODULE_ID_SYS,
@@ -1522,50 +1678,21 @@ void qdf_dp_trace_dump_all(uint32_t count)
 		return;
 	}
 
-	QDF_TRACE(QDF_MODULE_ID_SYS, QDF_TRACE_LEVEL_ERROR,
-		  "Total Records: %d, Head: %d, Tail: %d",
-		  g_qdf_dp_trace_data.num, g_qdf_dp_trace_data.head,
-		  g_qdf_dp_trace_data.tail);
+	mutex_lock(&l_dp_trace_dump_lock);
+	total = qdf_trace_merge_start(&qdf_dp_trace_merge, entries, count);
 
-	/* aquire the lock so that only one thread at a time can read
-	 * the ring buffer
-	 */
-	spin_lock_bh(&l_dp_trace_lock);
-
-	if (g_qdf_dp_trace_data.head != INVALID_QDF_DP_TRACE_ADDR) {
-		i = g_qdf_dp_trace_data.head;
-		tail = g_qdf_dp_trace_data.tail;
-
-		if (count) {
-			if (count > g_qdf_dp_trace_data.num)
-				count = g_qdf_dp_trace_data.num;
-			if (tail >= (count - 1))
-				i = tail - count + 1;
-			else if (count != MAX_QDF_DP_TRACE_RECORDS)
-				i = MAX_QDF_DP_TRACE_RECORDS - ((count - 1) -
-							     tail);
-		}
-
-		p_record = g_qdf_dp_trace_tbl[i];
-		spin_unlock_bh(&l_dp_trace_lock);
-		for (;; ) {
-
-			qdf_dp_trace_cb_table[p_record.
-					   code] (&p_record, (uint16_t)i);
-			if (i == tail)
-				break;
-			i += 1;
-
-			spin_lock_bh(&l_dp_trace_lock);
-			if (MAX_QDF_DP_TRACE_RECORDS == i)
-				i = 0;
-
-			p_record = g_qdf_dp_trace_tbl[i];
-			spin_unlock_bh(&l_dp_trace_lock);
-		}
-	} else {
-		spin_unlock_bh(&l_dp_trace_lock);
+	QDF_TRACE(QDF_MODULE_ID_SYS, QDF_TRACE_LEVEL_ERROR,
+		  "Total Records: %d, Records per CPU: %d", total, entries);
+
+	while (qdf_trace_merge_next(&qdf_dp_trace_merge, entries, &cpu,
+				    &slot)) {
+		p_record = per_cpu_ptr(&qdf_dp_trace_rings, cpu)->buf[slot];
+		if (p_record.code >= QDF_DP_TRACE_MAX)
+			continue;
+		qdf_dp_trace_cb_table[p_record.code] (&p_record,
+				(uint16_t)slot);
 	}
+	mutex_unlock(&l_dp_trace_dump_lock);
 }
 EXPORT_SYMBOL(qdf_dp_trace_dump_all);
 #endif
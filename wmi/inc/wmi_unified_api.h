@@ -100,6 +100,20 @@ enum wmi_rx_exec_ctx {
 	WMI_RX_UMAC_CTX
 };
 
+/**
+ * enum wmi_rx_evt_class - priority class of WMI_RX_WORK_CTX events
+ * @WMI_RX_EVT_CLASS_HIGH: time critical, run by a high priority worker
+ * @WMI_RX_EVT_CLASS_NORMAL: default class of registered handlers
+ * @WMI_RX_EVT_CLASS_BULK: telemetry, run only when nothing else waits
+ * @WMI_RX_EVT_CLASS_MAX: number of classes
+ */
+enum wmi_rx_evt_class {
+	WMI_RX_EVT_CLASS_HIGH,
+	WMI_RX_EVT_CLASS_NORMAL,
+	WMI_RX_EVT_CLASS_BULK,
+	WMI_RX_EVT_CLASS_MAX
+};
+
 /**
  * attach for unified WMI
  *
@@ -175,6 +189,10 @@ int
 wmi_unified_cmd_send(wmi_unified_t wmi_handle, wmi_buf_t buf, uint32_t buflen,
 			uint32_t cmd_id);
 
+uint32_t
+wmi_unified_cmd_send_multiple(wmi_unified_t wmi_handle, wmi_buf_t *bufs,
+			      uint32_t *lens, uint32_t *cmd_ids, uint32_t num);
+
 /**
  * wmi_unified_register_event_handler() - WMI event handler
  * registration function
@@ -203,6 +221,49 @@ int
 wmi_unified_unregister_event_handler(wmi_unified_t wmi_handle,
 					 uint32_t event_id);
 
+/**
+ * wmi_unified_set_event_class() - set the priority class of an event
+ * @wmi_handle: handle to WMI.
+ * @event_id: WMI event ID, its handler must be registered
+ * @evt_class: class the event is queued in for WMI_RX_WORK_CTX
+ *
+ * NOTE: handlers of WMI_RX_EVT_CLASS_HIGH events run in a worker of
+ * their own, concurrently with the handlers of the other classes and
+ * possibly ahead of events that arrived before them. Only give this
+ * class to events whose handlers lock their own state and do not rely
+ * on the order of other WMI events.
+ *
+ * Return: 0 on success and -ve on failure.
+ */
+int
+wmi_unified_set_event_class(wmi_unified_t wmi_handle, uint32_t event_id,
+			    enum wmi_rx_evt_class evt_class);
+
+/**
+ * wmi_unified_set_event_class_depth() - limit the queue of an event class
+ * @wmi_handle: handle to WMI.
+ * @evt_class: event class
+ * @depth: events queued beyond this are dropped
+ *
+ * Return: 0 on success and -ve on failure.
+ */
+int
+wmi_unified_set_event_class_depth(wmi_unified_t wmi_handle,
+				  enum wmi_rx_evt_class evt_class,
+				  uint32_t depth);
+
+/**
+ * wmi_unified_track_cmd_response() - time a command up to its response
+ * @wmi_handle: handle to WMI.
+ * @cmd_id: WMI command ID
+ * @event_id: WMI event ID answering @cmd_id
+ *
+ * Return: 0 on success and -ve on failure.
+ */
+int
+wmi_unified_track_cmd_response(wmi_unified_t wmi_handle, uint32_t cmd_id,
+			       uint32_t event_id);
+
 /**
  * request wmi to connet its htc service.
  *  @param wmi_handle      : handle to WMI.
@@ -372,6 +433,24 @@ wmi_unified_pdev_param_send(void *wmi_hdl,
 			   struct pdev_params *param,
 				uint8_t mac_id);
 
+void wmi_unified_param_batch_init(struct wmi_param_batch *batch);
+
+QDF_STATUS
+wmi_unified_param_batch_add_pdev(void *wmi_hdl, struct wmi_param_batch *batch,
+				 struct pdev_params *param, uint8_t mac_id);
+
+QDF_STATUS
+wmi_unified_param_batch_add_vdev(void *wmi_hdl, struct wmi_param_batch *batch,
+				 struct vdev_set_params *param);
+
+QDF_STATUS
+wmi_unified_param_batch_add_peer(void *wmi_hdl, struct wmi_param_batch *batch,
+				 uint8_t peer_addr[IEEE80211_ADDR_LEN],
+				 struct peer_set_params *param);
+
+QDF_STATUS
+wmi_unified_param_batch_flush(void *wmi_hdl, struct wmi_param_batch *batch);
+
 QDF_STATUS wmi_unified_beacon_tmpl_send_cmd(void *wmi_hdl,
 				struct beacon_tmpl_params *param);
 
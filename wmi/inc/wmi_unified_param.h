@@ -720,6 +720,52 @@ struct pdev_params {
 	uint32_t param_value;
 };
 
+#define WMI_PARAM_BATCH_MAX 32
+
+/**
+ * enum wmi_param_batch_type - kind of a batched set_param command
+ * @WMI_PARAM_BATCH_PDEV: pdev set_param
+ * @WMI_PARAM_BATCH_VDEV: vdev set_param
+ * @WMI_PARAM_BATCH_PEER: peer set_param
+ */
+enum wmi_param_batch_type {
+	WMI_PARAM_BATCH_PDEV,
+	WMI_PARAM_BATCH_VDEV,
+	WMI_PARAM_BATCH_PEER,
+};
+
+/**
+ * struct wmi_param_batch_entry - set_param command queued in a batch
+ * @type: selects the valid member of @u
+ * @mac_id: radio context of a pdev parameter
+ * @peer_addr: peer mac address of a peer parameter
+ * @u: command parameters
+ */
+struct wmi_param_batch_entry {
+	enum wmi_param_batch_type type;
+	uint8_t mac_id;
+	uint8_t peer_addr[IEEE80211_ADDR_LEN];
+	union {
+		struct pdev_params pdev;
+		struct vdev_set_params vdev;
+		struct peer_set_params peer;
+	} u;
+};
+
+/**
+ * struct wmi_param_batch - set_param commands sent together
+ * @num_entries: commands queued since the last flush
+ * @num_sent: commands sent by all flushes of the batch
+ * @num_failed: commands that could not be sent
+ * @entries: queued commands
+ */
+struct wmi_param_batch {
+	uint32_t num_entries;
+	uint32_t num_sent;
+	uint32_t num_failed;
+	struct wmi_param_batch_entry entries[WMI_PARAM_BATCH_MAX];
+};
+
 /**
  * struct beacon_tmpl_params - beacon template cmd parameter
  * @vdev_id: vdev id
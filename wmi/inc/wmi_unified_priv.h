@@ -37,7 +37,31 @@
 #include "qdf_atomic.h"
 
 #define WMI_UNIFIED_MAX_EVENT 0x100
+/* per handle arena for event TLV parsing, see __wmi_control_rx() */
+#define WMI_TLV_ARENA_SIZE 2048
+#define WMITLV_ERR_ARENA_FULL (-2)
+/*
+ * Event handler dispatch table: the upper bits of an event id select a
+ * chunk, allocated when its first handler registers, and the low bits a
+ * slot in it holding the handler index + 1. Ids beyond the table are
+ * looked up linearly.
+ */
+#define WMI_EVT_TBL_SLOT_BITS 8
+#define WMI_EVT_TBL_SLOTS (1 << WMI_EVT_TBL_SLOT_BITS)
+#define WMI_EVT_TBL_CHUNKS 1024
 #define WMI_MAX_CMDS  1024
+/* HTC packet containers preallocated per handle for commands */
+#define WMI_HTC_PKT_POOL_SIZE (WMI_MAX_CMDS / 4)
+/* event receive buffers kept mapped for reposting by HIF */
+#define WMI_RX_NBUF_POOL_SIZE 32
+/* time detach waits for HTC to complete commands still in flight */
+#define WMI_HTC_PKT_POOL_DRAIN_MS 100
+/* worker queues of the WMI_RX_WORK_CTX event classes */
+#define WMI_RX_QUEUE_MAX_DEPTH 1024
+#define WMI_RX_DELAY_BINS 7
+/* recycled command buffer size classes, see wmi_buf_alloc() */
+#define WMI_BUF_POOL_CLASSES 3
+#define WMI_BUF_POOL_DEPTH 32
 
 typedef qdf_nbuf_t wmi_buf_t;
 
@@ -96,19 +120,27 @@ struct wmi_command_header {
 #endif
 };
 
+/* Smallest per-CPU ring of a WMI log, in records */
+#define WMI_LOG_CPU_MIN_ENTRIES 128
+
+/**
+ * struct wmi_log_cpu_ring - one CPU's share of a WMI log
+ * @tail - Records ever written on this CPU; slot is tail % entries
+ * @buf - Records of this CPU
+ */
+struct wmi_log_cpu_ring {
+	uint32_t tail;
+	void *buf;
+};
+
 /**
  * struct wmi_log_buf_t - WMI log buffer information type
- * @buf - Refernce to WMI log buffer
- * @ length - length of buffer
- * @ buf_tail_idx - Tail index of buffer
- * @ p_buf_tail_idx - refernce to buffer tail index. It is added to accommodate
- * unified design since MCL uses global variable for buffer tail index
+ * @rings - Per-CPU rings the log is recorded into
+ * @entries - Records per CPU ring, a power of two
  */
 struct wmi_log_buf_t {
-	void *buf;
-	uint32_t length;
-	uint32_t buf_tail_idx;
-	uint32_t *p_buf_tail_idx;
+	struct wmi_log_cpu_ring __percpu *rings;
+	uint32_t entries;
 };
 
 /**
@@ -123,7 +155,6 @@ struct wmi_log_buf_t {
  * @wmi_mgmt_command_tx_cmp_log_buf_info - Buffer info for WMI Management
  * Command Tx completion log
  * @wmi_mgmt_event_log_buf_info - Buffer info for WMI Management event log
- * @wmi_record_lock - Lock WMI recording
  * @wmi_logging_enable - Enable/Disable state for WMI logging
  * @buf_offset_command - Offset from where WMI command data should be logged
  * @buf_offset_event - Offset from where WMI event data should be logged
@@ -144,7 +175,6 @@ struct wmi_debug_log_info {
 	struct wmi_log_buf_t wmi_mgmt_command_tx_cmp_log_buf_info;
 	struct wmi_log_buf_t wmi_mgmt_event_log_buf_info;
 
-	qdf_spinlock_t wmi_record_lock;
 	bool wmi_logging_enable;
 	uint32_t buf_offset_command;
 	uint32_t buf_offset_event;
@@ -244,6 +274,10 @@ QDF_STATUS
 QDF_STATUS (*send_vdev_set_param_cmd)(wmi_unified_t wmi_handle,
 				struct vdev_set_params *param);
 
+uint32_t (*send_param_batch_cmd)(wmi_unified_t wmi_handle,
+				struct wmi_param_batch_entry *entries,
+				uint32_t num);
+
 QDF_STATUS (*send_stats_request_cmd)(wmi_unified_t wmi_handle,
 				uint8_t macaddr[IEEE80211_ADDR_LEN],
 				struct stats_request_params *param);
@@ -1148,20 +1182,252 @@ struct wmi_cmd_init {
 	uint32_t buf_len;
 };
 
+/**
+ * struct wmi_htc_pkt_pool - HTC packet containers for WMI commands
+ * @pkts: preallocated containers
+ * @free_list: free containers, linked through ListLink.pNext
+ * @lock: protects @free_list and the counters below
+ * @in_use: containers of @pkts currently handed out
+ * @max_in_use: high watermark of @in_use
+ * @exhausted: commands that found the pool empty
+ * @fallback_fail: heap fallback allocations that failed
+ */
+struct wmi_htc_pkt_pool {
+	HTC_PACKET *pkts;
+	HTC_PACKET *free_list;
+	qdf_spinlock_t lock;
+	uint32_t in_use;
+	uint32_t max_in_use;
+	uint32_t exhausted;
+	uint32_t fallback_fail;
+};
+
+/**
+ * struct wmi_buf_pool - recycled WMI command buffers
+ * @lock: protects the free lists and the counters below
+ * @enabled: buffers are taken from and returned to the pool
+ * @free: idle buffers per size class
+ * @hits: allocations served from @free
+ * @misses: allocations that found @free empty
+ * @recycled: completed commands whose buffer went back to @free
+ * @dropped: completed commands freed because @free was full
+ */
+struct wmi_buf_pool {
+	qdf_spinlock_t lock;
+	bool enabled;
+	qdf_nbuf_queue_t free[WMI_BUF_POOL_CLASSES];
+	uint32_t hits[WMI_BUF_POOL_CLASSES];
+	uint32_t misses[WMI_BUF_POOL_CLASSES];
+	uint32_t recycled[WMI_BUF_POOL_CLASSES];
+	uint32_t dropped[WMI_BUF_POOL_CLASSES];
+};
+
+/**
+ * struct wmi_rx_evt_queue - worker queue of an event class
+ * @queue: events waiting for their worker
+ * @enq_ts: enqueue time in us of the queued events, a ring in queue order
+ * @head: index in @enq_ts of the oldest queued event
+ * @max_depth: events arriving while this many are queued are dropped
+ * @max_seen: deepest the queue got
+ * @drops: events dropped because of @max_depth
+ * @delay_hist: queueing delays, see wmi_rx_delay_bin_us
+ */
+struct wmi_rx_evt_queue {
+	qdf_nbuf_queue_t queue;
+	uint32_t enq_ts[WMI_RX_QUEUE_MAX_DEPTH];
+	uint32_t head;
+	uint32_t max_depth;
+	uint32_t max_seen;
+	uint32_t drops;
+	uint32_t delay_hist[WMI_RX_DELAY_BINS];
+};
+
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+#define WMI_CMD_LAT_SLOT_BITS 8
+#define WMI_CMD_LAT_SLOTS (1 << WMI_CMD_LAT_SLOT_BITS)
+#define WMI_CMD_LAT_BINS 24
+#define WMI_CMD_LAT_RESP_MAX 32
+
+/**
+ * struct wmi_lat_hist - latency histogram
+ * @bins: samples per bin, bin n > 0 holds [2^(n-1), 2^n) us and the
+ *	last bin everything above
+ * @count: number of samples
+ * @max_us: largest sample in us
+ */
+struct wmi_lat_hist {
+	uint32_t bins[WMI_CMD_LAT_BINS];
+	uint32_t count;
+	uint32_t max_us;
+};
+
+/**
+ * struct wmi_cmd_lat - latencies of one WMI command id
+ * @cmd_id: command id
+ * @used: slot holds @cmd_id
+ * @track_resp: a response event is registered for @cmd_id
+ * @resp_sent: send time in us of the command awaiting its response,
+ *	0 if none
+ * @tx_cmp: send to HTC tx completion
+ * @resp: send to response event
+ */
+struct wmi_cmd_lat {
+	uint32_t cmd_id;
+	bool used;
+	bool track_resp;
+	unsigned long resp_sent;
+	struct wmi_lat_hist tx_cmp;
+	struct wmi_lat_hist resp;
+};
+
+/**
+ * struct wmi_cmd_lat_resp - response event of a tracked command
+ * @event_id: firmware event id
+ * @slot: index in wmi_cmd_lat_tbl.slots of the command
+ */
+struct wmi_cmd_lat_resp {
+	uint32_t event_id;
+	uint32_t slot;
+};
+
+/**
+ * struct wmi_cmd_lat_tbl - per command id latency histograms
+ * @lock: protects the table
+ * @slots: open addressed on command id
+ * @resp: registered request/response pairs
+ * @num_resp: entries in @resp
+ * @untracked: samples dropped because @slots was full
+ */
+struct wmi_cmd_lat_tbl {
+	qdf_spinlock_t lock;
+	struct wmi_cmd_lat slots[WMI_CMD_LAT_SLOTS];
+	struct wmi_cmd_lat_resp resp[WMI_CMD_LAT_RESP_MAX];
+	uint32_t num_resp;
+	uint32_t untracked;
+};
+
+#define WMI_EVT_CAPTURE_MAGIC 0x434d4957	/* "WMIC" */
+#define WMI_EVT_CAPTURE_VERSION 1
+#define WMI_EVT_CAPTURE_MAX_SIZE (4 * 1024 * 1024)
+#define WMI_EVT_CAPTURE_CHUNK 2048
+#define WMI_EVT_REPLAY_SLOT_BITS 8
+#define WMI_EVT_REPLAY_SLOTS (1 << WMI_EVT_REPLAY_SLOT_BITS)
+
+/**
+ * struct wmi_evt_capture_file_hdr - start of a WMI event capture file
+ * @magic: WMI_EVT_CAPTURE_MAGIC
+ * @version: WMI_EVT_CAPTURE_VERSION
+ *
+ * The header is followed by the captured events in arrival order, each
+ * a struct wmi_evt_capture_rec and the raw event, WMI header included,
+ * padded to a multiple of 4 bytes. All fields are in host byte order.
+ */
+struct wmi_evt_capture_file_hdr {
+	uint32_t magic;
+	uint32_t version;
+};
+
+/**
+ * struct wmi_evt_capture_rec - header of a captured event
+ * @ts_us: receive time in us
+ * @len: length of the event, WMI header included
+ * @reserved: 0
+ */
+struct wmi_evt_capture_rec {
+	uint64_t ts_us;
+	uint32_t len;
+	uint32_t reserved;
+};
+
+/**
+ * struct wmi_evt_capture - capture of the received fw events
+ * @lock: protects the capture
+ * @active: events are being appended to @buf
+ * @busy: @buf is being read or replayed and must stay
+ * @buf: captured events, see struct wmi_evt_capture_file_hdr
+ * @size: size of @buf
+ * @used: bytes of @buf holding events
+ * @events: events in @buf
+ * @dropped: events that did not fit in @buf
+ * @max_len: longest event in @buf
+ */
+struct wmi_evt_capture {
+	qdf_spinlock_t lock;
+	bool active;
+	bool busy;
+	uint8_t *buf;
+	uint32_t size;
+	uint32_t used;
+	uint32_t events;
+	uint32_t dropped;
+	uint32_t max_len;
+};
+
+/**
+ * struct wmi_evt_replay_stat - parse cost of one event id
+ * @event_id: event id
+ * @used: slot holds @event_id
+ * @count: events parsed
+ * @errors: events failing the TLV check
+ * @heap_allocs: heap allocations made when the arena could not be used
+ * @total_ns: time spent parsing and handling
+ * @max_ns: slowest event
+ * @handler_ns: part of @total_ns spent in the event handler
+ */
+struct wmi_evt_replay_stat {
+	uint32_t event_id;
+	bool used;
+	uint32_t count;
+	uint32_t errors;
+	uint32_t heap_allocs;
+	uint64_t total_ns;
+	uint32_t max_ns;
+	uint64_t handler_ns;
+};
+
+/**
+ * struct wmi_evt_replay - result of the last replay of the capture
+ * @loops: passes over the capture
+ * @dispatch: events went to the registered handlers instead of a stub
+ * @events: events parsed
+ * @elapsed_ns: wall time of the replay
+ * @untracked: events not counted in @stats because it was full
+ * @stats: open addressed on event id
+ */
+struct wmi_evt_replay {
+	uint32_t loops;
+	bool dispatch;
+	uint32_t events;
+	uint64_t elapsed_ns;
+	uint32_t untracked;
+	struct wmi_evt_replay_stat stats[WMI_EVT_REPLAY_SLOTS];
+};
+#endif /* WMI_INTERFACE_EVENT_LOGGING */
+
 struct wmi_unified {
 	void *scn_handle;    /* handle to device */
 	osdev_t  osdev; /* handle to use OS-independent services */
 	qdf_atomic_t pending_cmds;
+	struct wmi_htc_pkt_pool pkt_pool;
+	struct wmi_buf_pool buf_pool;
 	HTC_ENDPOINT_ID wmi_endpoint_id;
 	uint16_t max_msg_len;
 	uint32_t event_id[WMI_UNIFIED_MAX_EVENT];
 	wmi_unified_event_handler event_handler[WMI_UNIFIED_MAX_EVENT];
 	enum wmi_rx_exec_ctx ctx[WMI_UNIFIED_MAX_EVENT];
+	uint8_t evt_class[WMI_UNIFIED_MAX_EVENT];
 	uint32_t max_event_idx;
+	uint16_t *evt_tbl[WMI_EVT_TBL_CHUNKS];
+#ifndef WMI_NON_TLV_SUPPORT
+	void *tlv_arena;
+	qdf_atomic_t tlv_arena_busy;
+#endif
 	void *htc_handle;
 	qdf_spinlock_t eventq_lock;
-	qdf_nbuf_queue_t event_queue;
+	struct wmi_rx_evt_queue evt_queues[WMI_RX_EVT_CLASS_MAX];
 	struct work_struct rx_event_work;
+	struct workqueue_struct *rx_hipri_wq;
+	struct work_struct rx_hipri_work;
 	int wmi_stop_in_progress;
 #ifndef WMI_NON_TLV_SUPPORT
 	struct _wmi_abi_version fw_abi_version;
@@ -1178,6 +1444,9 @@ struct wmi_unified {
 
 #ifdef WMI_INTERFACE_EVENT_LOGGING
 	struct wmi_debug_log_info log_info;
+	struct wmi_cmd_lat_tbl *cmd_lat;
+	struct wmi_evt_capture evt_capture;
+	struct wmi_evt_replay *evt_replay;
 #endif /*WMI_INTERFACE_EVENT_LOGGING */
 
 	qdf_atomic_t is_target_suspended;
@@ -1207,6 +1476,16 @@ struct wmi_unified {
 #define wmi_tlv_attach(x) qdf_print("TLV Unavailable\n")
 #else
 void wmi_tlv_attach(wmi_unified_t wmi_handle);
+void wmitlv_init_attr_index(void);
+int wmitlv_check_and_pad_event_tlvs_arena(void *os_handle,
+					  void *param_struc_ptr,
+					  A_UINT32 param_buf_len,
+					  A_UINT32 wmi_cmd_event_id,
+					  void **wmi_cmd_struct_ptr,
+					  void *arena_buf,
+					  A_UINT32 arena_size);
+A_UINT32 wmitlv_count_allocated_event_tlvs(A_UINT32 cmd_event_id,
+					   void *wmi_cmd_struct_ptr);
 #endif
 void wmi_non_tlv_attach(wmi_unified_t wmi_handle);
 
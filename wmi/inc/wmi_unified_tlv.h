@@ -113,6 +113,10 @@ send_dbglog_cmd_tlv(wmi_unified_t wmi_handle,
 QDF_STATUS send_vdev_set_param_cmd_tlv(wmi_unified_t wmi_handle,
 				struct vdev_set_params *param);
 
+uint32_t send_param_batch_cmd_tlv(wmi_unified_t wmi_handle,
+				struct wmi_param_batch_entry *entries,
+				uint32_t num);
+
 QDF_STATUS send_stats_request_cmd_tlv(wmi_unified_t wmi_handle,
 				uint8_t macaddr[IEEE80211_ADDR_LEN],
 				struct stats_request_params *param);
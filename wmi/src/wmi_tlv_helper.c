@@ -28,6 +28,7 @@
 #include "wmi_tlv_platform.c"
 #include "wmi_tlv_defs.h"
 #include "wmi_version.h"
+#include "wmi_unified_priv.h"
 
 #define WMITLV_GET_ATTRIB_NUM_TLVS  0xFFFFFFFF
 
@@ -61,6 +62,18 @@ A_UINT32 evt_attr_list[] = {
 	WMITLV_ALL_EVT_LIST(WMITLV_GET_CMD_EVT_ATTRB_LIST)
 };
 
+/*
+ * Index of cmd_attr_list and evt_attr_list: open addressed hash of the
+ * cmd/event id holding the offset + 1 of the id's attributes in the list.
+ * Until wmitlv_init_attr_index() succeeds the lists are scanned.
+ */
+#define WMITLV_ATTR_INDEX_BITS 11
+#define WMITLV_ATTR_INDEX_SIZE (1 << WMITLV_ATTR_INDEX_BITS)
+
+static A_UINT16 cmd_attr_index[WMITLV_ATTR_INDEX_SIZE];
+static A_UINT16 evt_attr_index[WMITLV_ATTR_INDEX_SIZE];
+static A_UINT32 wmitlv_attr_index_ready;
+
 #ifdef NO_DYNAMIC_MEM_ALLOC
 static wmitlv_cmd_param_info *g_wmi_static_cmd_param_info_buf;
 A_UINT32 g_wmi_static_max_cmd_param_tlvs;
@@ -95,6 +108,122 @@ wmitlv_set_static_param_tlv_buf(void *param_tlv_buf,
 #endif
 }
 
+/**
+ * wmitlv_attr_index_hash() - tlv helper function
+ * @cmd_event_id: command event id
+ *
+ * Return: first slot of @cmd_event_id in the attribute index
+ */
+static inline A_UINT32 wmitlv_attr_index_hash(A_UINT32 cmd_event_id)
+{
+	return (WMITLV_GET_CMDID(cmd_event_id) * 2654435761U) >>
+		(32 - WMITLV_ATTR_INDEX_BITS);
+}
+
+/**
+ * wmitlv_build_attr_index() - tlv helper function
+ * @pAttrArrayList: attribute list to index
+ * @num_entries: number of entries in @pAttrArrayList
+ * @pIndex: index to fill
+ *
+ * Return: 0 if success. Return 1 if the list does not fit in the index.
+ */
+static A_UINT32 wmitlv_build_attr_index(A_UINT32 *pAttrArrayList,
+					A_UINT32 num_entries,
+					A_UINT16 *pIndex)
+{
+	A_UINT32 i, slot, probes, num_tlvs;
+
+	for (i = 0; i < num_entries; i += num_tlvs + 1) {
+		num_tlvs = WMITLV_GET_NUM_TLVS(pAttrArrayList[i]);
+		if (i + 1 > 0xFFFF)
+			return 1;
+
+		slot = wmitlv_attr_index_hash(pAttrArrayList[i]);
+		for (probes = 0; probes < WMITLV_ATTR_INDEX_SIZE; probes++) {
+			/* the first definition of an id wins, as in a scan */
+			if (!pIndex[slot] ||
+			    WMITLV_GET_CMDID(pAttrArrayList[pIndex[slot] - 1]) ==
+			    WMITLV_GET_CMDID(pAttrArrayList[i]))
+				break;
+			slot = (slot + 1) & (WMITLV_ATTR_INDEX_SIZE - 1);
+		}
+		if (probes == WMITLV_ATTR_INDEX_SIZE)
+			return 1;
+		if (!pIndex[slot])
+			pIndex[slot] = i + 1;
+	}
+
+	return 0;
+}
+
+/**
+ * wmitlv_init_attr_index() - tlv helper function
+ *
+ * Index the Command/Event TLV attribute definitions so that
+ * wmitlv_get_attributes() does not have to scan them. Calling it again
+ * once the index is built does nothing.
+ *
+ * Return: None
+ */
+void wmitlv_init_attr_index(void)
+{
+	if (wmitlv_attr_index_ready)
+		return;
+
+	if (wmitlv_build_attr_index(&cmd_attr_list[0],
+				    QDF_ARRAY_SIZE(cmd_attr_list),
+				    cmd_attr_index) ||
+	    wmitlv_build_attr_index(&evt_attr_list[0],
+				    QDF_ARRAY_SIZE(evt_attr_list),
+				    evt_attr_index)) {
+		wmi_tlv_print_error
+			("%s: TLV attribute index too small, using scan\n",
+			__func__);
+		return;
+	}
+
+	wmitlv_attr_index_ready = 1;
+}
+
+/**
+ * wmitlv_find_attributes() - tlv helper function
+ * @pAttrArrayList: attribute list to search
+ * @num_entries: number of entries in @pAttrArrayList
+ * @pIndex: index of @pAttrArrayList
+ * @cmd_event_id: command event id
+ *
+ * Return: offset of the attributes of @cmd_event_id in @pAttrArrayList,
+ *	-1 if it has none
+ */
+static A_INT32 wmitlv_find_attributes(A_UINT32 *pAttrArrayList,
+				      A_UINT32 num_entries, A_UINT16 *pIndex,
+				      A_UINT32 cmd_event_id)
+{
+	A_UINT32 i, slot;
+
+	if (wmitlv_attr_index_ready) {
+		slot = wmitlv_attr_index_hash(cmd_event_id);
+		while (pIndex[slot]) {
+			i = pIndex[slot] - 1;
+			if (WMITLV_GET_CMDID(cmd_event_id) ==
+			    WMITLV_GET_CMDID(pAttrArrayList[i]))
+				return i;
+			slot = (slot + 1) & (WMITLV_ATTR_INDEX_SIZE - 1);
+		}
+		return -1;
+	}
+
+	for (i = 0; i < num_entries; i++) {
+		if (WMITLV_GET_CMDID(cmd_event_id) ==
+		    WMITLV_GET_CMDID(pAttrArrayList[i]))
+			return i;
+		i += WMITLV_GET_NUM_TLVS(pAttrArrayList[i]);
+	}
+
+	return -1;
+}
+
 /**
  * wmitlv_get_attributes() - tlv helper function
  * @is_cmd_id: boolean for command attribute
@@ -112,73 +241,72 @@ A_UINT32 wmitlv_get_attributes(A_UINT32 is_cmd_id, A_UINT32 cmd_event_id,
 			       A_UINT32 curr_tlv_order,
 			       wmitlv_attributes_struc *tlv_attr_ptr)
 {
-	A_UINT32 i, base_index, num_tlvs, num_entries;
+	A_UINT32 base_index, num_tlvs, num_entries;
 	A_UINT32 *pAttrArrayList;
+	A_UINT16 *pIndex;
+	A_INT32 i;
 
 	if (is_cmd_id) {
 		pAttrArrayList = &cmd_attr_list[0];
 		num_entries = QDF_ARRAY_SIZE(cmd_attr_list);
+		pIndex = cmd_attr_index;
 	} else {
 		pAttrArrayList = &evt_attr_list[0];
 		num_entries = QDF_ARRAY_SIZE(evt_attr_list);
+		pIndex = evt_attr_index;
 	}
 
-	for (i = 0; i < num_entries; i++) {
-		num_tlvs = WMITLV_GET_NUM_TLVS(pAttrArrayList[i]);
-		if (WMITLV_GET_CMDID(cmd_event_id) ==
-		    WMITLV_GET_CMDID(pAttrArrayList[i])) {
-			tlv_attr_ptr->cmd_num_tlv = num_tlvs;
-			/* Return success from here when only number of TLVS for
-			 * this command/event is required */
-			if (curr_tlv_order == WMITLV_GET_ATTRIB_NUM_TLVS) {
-				wmi_tlv_print_verbose
-					("%s: WMI TLV attribute definitions for %s:0x%x found; num_of_tlvs:%d\n",
-					__func__, (is_cmd_id ? "Cmd" : "Evt"),
-					cmd_event_id, num_tlvs);
-				return 0;
-			}
+	i = wmitlv_find_attributes(pAttrArrayList, num_entries, pIndex,
+				   cmd_event_id);
+	if (i < 0) {
+		wmi_tlv_print_error
+			("%s: ERROR: Didn't found WMI TLV attribute definitions for %s:0x%x\n",
+			__func__, (is_cmd_id ? "Cmd" : "Evt"), cmd_event_id);
+		return 1;
+	}
 
-			/* Return failure if tlv_order is more than the expected
-			 * number of TLVs */
-			if (curr_tlv_order >= num_tlvs) {
-				wmi_tlv_print_error
-					("%s: ERROR: TLV order %d greater than num_of_tlvs:%d for %s:0x%x\n",
-					__func__, curr_tlv_order, num_tlvs,
-					(is_cmd_id ? "Cmd" : "Evt"), cmd_event_id);
-				return 1;
-			}
+	num_tlvs = WMITLV_GET_NUM_TLVS(pAttrArrayList[i]);
+	tlv_attr_ptr->cmd_num_tlv = num_tlvs;
+	/* Return success from here when only number of TLVS for
+	 * this command/event is required */
+	if (curr_tlv_order == WMITLV_GET_ATTRIB_NUM_TLVS) {
+		wmi_tlv_print_verbose
+			("%s: WMI TLV attribute definitions for %s:0x%x found; num_of_tlvs:%d\n",
+			__func__, (is_cmd_id ? "Cmd" : "Evt"),
+			cmd_event_id, num_tlvs);
+		return 0;
+	}
 
-			base_index = i + 1;     /* index to first TLV attributes */
-			wmi_tlv_print_verbose
-				("%s: WMI TLV attributes for %s:0x%x tlv[%d]:0x%x\n",
-				__func__, (is_cmd_id ? "Cmd" : "Evt"),
-				cmd_event_id, curr_tlv_order,
-				pAttrArrayList[(base_index + curr_tlv_order)]);
-			tlv_attr_ptr->tag_order = curr_tlv_order;
-			tlv_attr_ptr->tag_id =
-				WMITLV_GET_TAGID(pAttrArrayList
-						 [(base_index + curr_tlv_order)]);
-			tlv_attr_ptr->tag_struct_size =
-				WMITLV_GET_TAG_STRUCT_SIZE(pAttrArrayList
-							   [(base_index +
-							     curr_tlv_order)]);
-			tlv_attr_ptr->tag_varied_size =
-				WMITLV_GET_TAG_VARIED(pAttrArrayList
-						      [(base_index +
-							curr_tlv_order)]);
-			tlv_attr_ptr->tag_array_size =
-				WMITLV_GET_TAG_ARRAY_SIZE(pAttrArrayList
-							  [(base_index +
-							    curr_tlv_order)]);
-			return 0;
-		}
-		i += num_tlvs;
+	/* Return failure if tlv_order is more than the expected
+	 * number of TLVs */
+	if (curr_tlv_order >= num_tlvs) {
+		wmi_tlv_print_error
+			("%s: ERROR: TLV order %d greater than num_of_tlvs:%d for %s:0x%x\n",
+			__func__, curr_tlv_order, num_tlvs,
+			(is_cmd_id ? "Cmd" : "Evt"), cmd_event_id);
+		return 1;
 	}
 
-	wmi_tlv_print_error
-		("%s: ERROR: Didn't found WMI TLV attribute definitions for %s:0x%x\n",
-		__func__, (is_cmd_id ? "Cmd" : "Evt"), cmd_event_id);
-	return 1;
+	base_index = i + 1;     /* index to first TLV attributes */
+	wmi_tlv_print_verbose
+		("%s: WMI TLV attributes for %s:0x%x tlv[%d]:0x%x\n",
+		__func__, (is_cmd_id ? "Cmd" : "Evt"),
+		cmd_event_id, curr_tlv_order,
+		pAttrArrayList[(base_index + curr_tlv_order)]);
+	tlv_attr_ptr->tag_order = curr_tlv_order;
+	tlv_attr_ptr->tag_id =
+		WMITLV_GET_TAGID(pAttrArrayList
+				 [(base_index + curr_tlv_order)]);
+	tlv_attr_ptr->tag_struct_size =
+		WMITLV_GET_TAG_STRUCT_SIZE(pAttrArrayList
+					   [(base_index + curr_tlv_order)]);
+	tlv_attr_ptr->tag_varied_size =
+		WMITLV_GET_TAG_VARIED(pAttrArrayList
+				      [(base_index + curr_tlv_order)]);
+	tlv_attr_ptr->tag_array_size =
+		WMITLV_GET_TAG_ARRAY_SIZE(pAttrArrayList
+					  [(base_index + curr_tlv_order)]);
+	return 0;
 }
 
 /**
@@ -475,6 +603,56 @@ wmitlv_check_command_tlv_params(void *os_handle, void *param_struc_ptr,
 			wmi_cmd_event_id);
 }
 
+#ifndef NO_DYNAMIC_MEM_ALLOC
+/**
+ * struct wmitlv_arena - bump allocator for TLV parsing
+ * @buf: arena memory
+ * @size: size of @buf
+ * @used: bytes handed out from @buf
+ * @exhausted: set when an allocation did not fit
+ */
+typedef struct {
+	A_UINT8 *buf;
+	A_UINT32 size;
+	A_UINT32 used;
+	A_UINT32 exhausted;
+} wmitlv_arena;
+
+/**
+ * wmitlv_mem_alloc() - tlv helper function
+ * @os_handle: os context handle
+ * @arena: arena to allocate from, NULL to use the heap
+ * @num_bytes: bytes to allocate
+ *
+ *
+ * Memory from an arena is never freed on its own; the whole arena is
+ * reused by the next parse.
+ *
+ * Return: allocated memory, NULL on failure
+ */
+static void *wmitlv_mem_alloc(void *os_handle, wmitlv_arena *arena,
+			      A_UINT32 num_bytes)
+{
+	void *ptr = NULL;
+
+	if (!arena) {
+		wmi_tlv_os_mem_alloc(os_handle, ptr, num_bytes);
+		return ptr;
+	}
+
+	/* keep param structs and TLV copies pointer aligned */
+	num_bytes = (num_bytes + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	if (num_bytes > arena->size - arena->used) {
+		arena->exhausted = 1;
+		return NULL;
+	}
+	ptr = arena->buf + arena->used;
+	arena->used += num_bytes;
+
+	return ptr;
+}
+#endif
+
 /**
  * wmitlv_check_and_pad_tlvs() - tlv helper function
  * @os_handle: os context handle
@@ -483,17 +661,21 @@ wmitlv_check_command_tlv_params(void *os_handle, void *param_struc_ptr,
  * @is_cmd_id: boolean for command attribute
  * @wmi_cmd_event_id: command event id
  * @wmi_cmd_struct_ptr: wmi command structure
+ * @arena: arena for the command structure and padded TLVs, NULL to
+ *	allocate them from the heap
  *
  *
  * vaidate the TLV's coming for an event/command and
  * also pads data to TLV's if necessary
  *
- * Return: 0 if success. Return < 0 if failure.
+ * Return: 0 if success. Return < 0 if failure, WMITLV_ERR_ARENA_FULL
+ *	if @arena was too small.
  */
 static int
 wmitlv_check_and_pad_tlvs(void *os_handle, void *param_struc_ptr,
 			  A_UINT32 param_buf_len, A_UINT32 is_cmd_id,
-			  A_UINT32 wmi_cmd_event_id, void **wmi_cmd_struct_ptr)
+			  A_UINT32 wmi_cmd_event_id, void **wmi_cmd_struct_ptr,
+			  void *arena)
 {
 	wmitlv_attributes_struc attr_struct_ptr;
 	A_UINT32 buf_idx = 0;
@@ -522,8 +704,8 @@ wmitlv_check_and_pad_tlvs(void *os_handle, void *param_struc_ptr,
 		attr_struct_ptr.cmd_num_tlv * sizeof(wmitlv_cmd_param_info);
 #ifndef NO_DYNAMIC_MEM_ALLOC
 	/* Dynamic memory allocation supported */
-	wmi_tlv_os_mem_alloc(os_handle, *wmi_cmd_struct_ptr,
-			     len_wmi_cmd_struct_buf);
+	*wmi_cmd_struct_ptr = wmitlv_mem_alloc(os_handle, arena,
+					       len_wmi_cmd_struct_buf);
 #else
 	/* Dynamic memory allocation is not supported. Use the buffer
 	 * g_wmi_static_cmd_param_info_buf, which should be set using
@@ -540,6 +722,8 @@ wmitlv_check_and_pad_tlvs(void *os_handle, void *param_struc_ptr,
 	}
 #endif
 	if (*wmi_cmd_struct_ptr == NULL) {
+		if (arena)
+			return WMITLV_ERR_ARENA_FULL;
 		/* Error: unable to alloc memory */
 		wmi_tlv_print_error
 			("%s: Error: unable to alloc memory (size=%d) for TLV\n",
@@ -685,17 +869,19 @@ wmitlv_check_and_pad_tlvs(void *os_handle, void *param_struc_ptr,
 				WMITLV_GET_TLVLEN(WMITLV_GET_HDR(buf_ptr)) +
 				WMI_TLV_HDR_SIZE;
 #ifndef NO_DYNAMIC_MEM_ALLOC
-			wmi_tlv_os_mem_alloc(os_handle, new_tlv_buf,
-					     (num_of_elems *
-					      attr_struct_ptr.tag_struct_size));
+			new_tlv_buf = wmitlv_mem_alloc(os_handle, arena,
+						       (num_of_elems *
+							attr_struct_ptr.
+							tag_struct_size));
 			if (new_tlv_buf == NULL) {
 				/* Error: unable to alloc memory */
-				wmi_tlv_print_error
-					("%s: Error: unable to alloc memory (size=%d) for padding the TLV array %d\n",
-					__func__,
-					(num_of_elems *
-					 attr_struct_ptr.tag_struct_size),
-					curr_tlv_tag);
+				if (!arena)
+					wmi_tlv_print_error
+						("%s: Error: unable to alloc memory (size=%d) for padding the TLV array %d\n",
+						__func__,
+						(num_of_elems *
+						 attr_struct_ptr.tag_struct_size),
+						curr_tlv_tag);
 				goto Error_wmitlv_check_and_pad_tlvs;
 			}
 
@@ -882,14 +1068,17 @@ wmitlv_check_and_pad_tlvs(void *os_handle, void *param_struc_ptr,
 				__func__, tlv_size_diff);
 #ifndef NO_DYNAMIC_MEM_ALLOC
 			/* Dynamic memory allocation is supported */
-			wmi_tlv_os_mem_alloc(os_handle, new_tlv_buf,
-					     (curr_tlv_len - tlv_size_diff));
+			new_tlv_buf = wmitlv_mem_alloc(os_handle, arena,
+						       (curr_tlv_len -
+							tlv_size_diff));
 			if (new_tlv_buf == NULL) {
 				/* Error: unable to alloc memory */
-				wmi_tlv_print_error
-					("%s: Error: unable to alloc memory (size=%d) for padding the TLV %d\n",
-					__func__, (curr_tlv_len - tlv_size_diff),
-					curr_tlv_tag);
+				if (!arena)
+					wmi_tlv_print_error
+						("%s: Error: unable to alloc memory (size=%d) for padding the TLV %d\n",
+						__func__,
+						(curr_tlv_len - tlv_size_diff),
+						curr_tlv_tag);
 				goto Error_wmitlv_check_and_pad_tlvs;
 			}
 
@@ -938,6 +1127,14 @@ wmitlv_check_and_pad_tlvs(void *os_handle, void *param_struc_ptr,
 
 	return 0;
 Error_wmitlv_check_and_pad_tlvs:
+#ifndef NO_DYNAMIC_MEM_ALLOC
+	if (arena) {
+		/* nothing to free, the arena is simply reused */
+		*wmi_cmd_struct_ptr = NULL;
+		return ((wmitlv_arena *) arena)->exhausted ?
+			WMITLV_ERR_ARENA_FULL : error;
+	}
+#endif
 	if (is_cmd_id) {
 		wmitlv_free_allocated_command_tlvs(wmi_cmd_event_id,
 						   wmi_cmd_struct_ptr);
@@ -971,7 +1168,52 @@ wmitlv_check_and_pad_event_tlvs(void *os_handle, void *param_struc_ptr,
 	A_UINT32 is_cmd_id = 0;
 	return wmitlv_check_and_pad_tlvs
 			(os_handle, param_struc_ptr, param_buf_len, is_cmd_id,
-			wmi_cmd_event_id, wmi_cmd_struct_ptr);
+			wmi_cmd_event_id, wmi_cmd_struct_ptr, NULL);
+}
+
+/**
+ * wmitlv_check_and_pad_event_tlvs_arena() - tlv helper function
+ * @os_handle: os context handle
+ * @param_struc_ptr: pointer to tlv structure
+ * @param_buf_len: length of tlv parameter
+ * @wmi_cmd_event_id: command event id
+ * @wmi_cmd_struct_ptr: wmi command structure
+ * @arena_buf: memory for the command structure and padded TLVs
+ * @arena_size: size of @arena_buf
+ *
+ *
+ * validate and pad(if necessary) for incoming WMI Event TLVs without
+ * allocating: TLVs matching the host definition point into the event,
+ * the rest is copied into @arena_buf. The result must not be freed with
+ * wmitlv_free_allocated_event_tlvs(), it is released by reusing
+ * @arena_buf. Without dynamic memory allocation this is the same as
+ * wmitlv_check_and_pad_event_tlvs().
+ *
+ * Return: 0 if success, WMITLV_ERR_ARENA_FULL if @arena_buf is too small,
+ *	other values < 0 if failure.
+ */
+int
+wmitlv_check_and_pad_event_tlvs_arena(void *os_handle, void *param_struc_ptr,
+				      A_UINT32 param_buf_len,
+				      A_UINT32 wmi_cmd_event_id,
+				      void **wmi_cmd_struct_ptr,
+				      void *arena_buf, A_UINT32 arena_size)
+{
+#ifndef NO_DYNAMIC_MEM_ALLOC
+	wmitlv_arena arena;
+
+	arena.buf = arena_buf;
+	arena.size = arena_size;
+	arena.used = 0;
+	arena.exhausted = 0;
+	return wmitlv_check_and_pad_tlvs
+			(os_handle, param_struc_ptr, param_buf_len, 0,
+			wmi_cmd_event_id, wmi_cmd_struct_ptr, &arena);
+#else
+	return wmitlv_check_and_pad_tlvs
+			(os_handle, param_struc_ptr, param_buf_len, 0,
+			wmi_cmd_event_id, wmi_cmd_struct_ptr, NULL);
+#endif
 }
 
 /**
@@ -996,7 +1238,7 @@ wmitlv_check_and_pad_command_tlvs(void *os_handle, void *param_struc_ptr,
 	A_UINT32 is_cmd_id = 1;
 	return wmitlv_check_and_pad_tlvs
 			(os_handle, param_struc_ptr, param_buf_len, is_cmd_id,
-			wmi_cmd_event_id, wmi_cmd_struct_ptr);
+			wmi_cmd_event_id, wmi_cmd_struct_ptr, NULL);
 }
 
 /**
@@ -1095,6 +1337,52 @@ void wmitlv_free_allocated_event_tlvs(A_UINT32 cmd_event_id,
 	wmitlv_free_allocated_tlvs(0, cmd_event_id, wmi_cmd_struct_ptr);
 }
 
+/**
+ * wmitlv_count_allocated_event_tlvs() - tlv helper function
+ * @cmd_event_id: event id
+ * @wmi_cmd_struct_ptr: event structure from wmitlv_check_and_pad_event_tlvs()
+ *
+ *
+ * count the buffers allocated for WMI Event TLV processing
+ *
+ * Return: number of heap allocations, the event structure included
+ */
+A_UINT32 wmitlv_count_allocated_event_tlvs(A_UINT32 cmd_event_id,
+					   void *wmi_cmd_struct_ptr)
+{
+	void *ptr = wmi_cmd_struct_ptr;
+	A_UINT32 count = 0;
+
+	if (!ptr)
+		return 0;
+#ifndef NO_DYNAMIC_MEM_ALLOC
+
+/* macro to count the memory allocated for this TLV. When (op==COUNT_TLV_ELEM). */
+#define WMITLV_OP_COUNT_TLV_ELEM_macro(param_ptr, param_len, wmi_cmd_event_id, elem_tlv_tag, elem_struc_type, elem_name, var_len, arr_size)  \
+	if ((((WMITLV_TYPEDEF_STRUCT_PARAMS_TLVS(wmi_cmd_event_id) *)ptr)->WMITLV_FIELD_BUF_IS_ALLOCATED(elem_name)) &&	\
+	    (((WMITLV_TYPEDEF_STRUCT_PARAMS_TLVS(wmi_cmd_event_id) *)ptr)->elem_name != NULL)) \
+	{ \
+		count++; \
+	}
+
+#define WMITLV_COUNT_TLV_ELEMS(id)	     \
+case id: \
+{ \
+	WMITLV_TABLE(id, COUNT_TLV_ELEM, NULL, 0)     \
+} \
+break;
+
+	switch (cmd_event_id) {
+		WMITLV_ALL_EVT_LIST(WMITLV_COUNT_TLV_ELEMS);
+	default:
+		break;
+	}
+	count++;
+#endif
+
+	return count;
+}
+
 /**
  * wmi_versions_are_compatible() - tlv helper function
  * @vers1: host wmi version
@@ -39,8 +39,15 @@
 #include "dbglog_host.h"
 #include "wmi_unified_priv.h"
 #include "wmi_unified_param.h"
+#include "qdf_threads.h"
 
 #include <linux/debugfs.h>
+#include <linux/percpu.h>
+#include <linux/log2.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/ratelimit.h>
+#include <linux/vmalloc.h>
 
 /* This check for CONFIG_WIN temporary added due to redeclaration compilation
 error in MCL. Error is caused due to inclusion of wmi.h in wmi_unified_api.h
@@ -111,6 +118,179 @@ int qcacld_bp_seq_printf(struct seq_file *m, const char *f, ...)
 
 #define WMI_MIN_HEAD_ROOM 64
 
+/* upper bounds in us of the rx queueing delay bins, the last bin is open */
+static const uint32_t wmi_rx_delay_bin_us[WMI_RX_DELAY_BINS - 1] = {
+	100, 500, 1000, 5000, 10000, 50000
+};
+
+/* default queue depth limits of the rx event classes */
+static const uint32_t wmi_rx_evt_class_depth[WMI_RX_EVT_CLASS_MAX] = {
+	256, WMI_RX_QUEUE_MAX_DEPTH, 256
+};
+
+/* command lengths of the buffer pool size classes, smallest first */
+static const uint16_t wmi_buf_pool_class_len[WMI_BUF_POOL_CLASSES] = {
+	64, 256, 1024
+};
+
+/**
+ * wmi_buf_pool_class() - find the pool size class of a command
+ * @wmi_handle: handle to wmi
+ * @len: command length
+ * @class: returns the size class, -1 if the buffer is not pooled
+ *
+ * Return: command length to allocate the buffer for
+ */
+static uint16_t wmi_buf_pool_class(struct wmi_unified *wmi_handle,
+				   uint16_t len, int *class)
+{
+	int i;
+
+	*class = -1;
+	if (!wmi_handle->buf_pool.enabled)
+		return len;
+
+	for (i = 0; i < WMI_BUF_POOL_CLASSES; i++) {
+		if (len > wmi_buf_pool_class_len[i])
+			continue;
+		if (roundup(wmi_buf_pool_class_len[i] + WMI_MIN_HEAD_ROOM, 4) >
+		    wmi_handle->max_msg_len)
+			break;
+		*class = i;
+		return wmi_buf_pool_class_len[i];
+	}
+
+	return len;
+}
+
+/**
+ * wmi_buf_pool_get() - take an idle buffer of a size class
+ * @wmi_handle: handle to wmi
+ * @class: size class from wmi_buf_pool_class()
+ *
+ * Return: buffer with WMI_MIN_HEAD_ROOM headroom and no data, or NULL
+ */
+static wmi_buf_t wmi_buf_pool_get(struct wmi_unified *wmi_handle, int class)
+{
+	struct wmi_buf_pool *pool = &wmi_handle->buf_pool;
+	wmi_buf_t buf;
+
+	qdf_spin_lock_bh(&pool->lock);
+	buf = qdf_nbuf_queue_remove(&pool->free[class]);
+	if (buf)
+		pool->hits[class]++;
+	else
+		pool->misses[class]++;
+	qdf_spin_unlock_bh(&pool->lock);
+
+	return buf;
+}
+
+/**
+ * wmi_buf_pool_put() - recycle the buffer of a completed command
+ * @wmi_handle: handle to wmi
+ * @buf: command buffer, no longer referenced by HTC
+ *
+ * The buffer goes to the largest size class it can hold, or is freed
+ * when the pool is disabled or that class is full.
+ *
+ * Return: none
+ */
+static void wmi_buf_pool_put(struct wmi_unified *wmi_handle, wmi_buf_t buf)
+{
+	struct wmi_buf_pool *pool = &wmi_handle->buf_pool;
+	uint32_t size, class_size = 0;
+	int class;
+
+	if (!pool->enabled || qdf_nbuf_is_cloned(buf) || qdf_nbuf_shared(buf))
+		goto free;
+
+	size = qdf_nbuf_headroom(buf) + qdf_nbuf_len(buf) +
+		qdf_nbuf_tailroom(buf);
+	for (class = WMI_BUF_POOL_CLASSES - 1; class >= 0; class--) {
+		class_size = roundup(wmi_buf_pool_class_len[class] +
+				     WMI_MIN_HEAD_ROOM, 4);
+		if (class_size <= size)
+			break;
+	}
+	/* do not park buffers far larger than any class */
+	if (class < 0 || size >= 2 * class_size)
+		goto free;
+
+	qdf_nbuf_push_head(buf, qdf_nbuf_headroom(buf));
+	qdf_nbuf_set_pktlen(buf, 0);
+	qdf_nbuf_reserve(buf, WMI_MIN_HEAD_ROOM);
+	qdf_nbuf_reset_ctxt(buf);
+
+	qdf_spin_lock_bh(&pool->lock);
+	if (qdf_nbuf_queue_len(&pool->free[class]) < WMI_BUF_POOL_DEPTH) {
+		qdf_nbuf_queue_add(&pool->free[class], buf);
+		pool->recycled[class]++;
+		buf = NULL;
+	} else {
+		pool->dropped[class]++;
+	}
+	qdf_spin_unlock_bh(&pool->lock);
+
+	if (!buf)
+		return;
+free:
+	qdf_nbuf_free(buf);
+}
+
+/**
+ * wmi_buf_pool_drain() - free all idle buffers of the pool
+ * @pool: buffer pool
+ *
+ * Return: none
+ */
+static void wmi_buf_pool_drain(struct wmi_buf_pool *pool)
+{
+	qdf_nbuf_queue_t drain;
+	wmi_buf_t buf;
+	int i;
+
+	qdf_nbuf_queue_init(&drain);
+	qdf_spin_lock_bh(&pool->lock);
+	for (i = 0; i < WMI_BUF_POOL_CLASSES; i++) {
+		qdf_nbuf_queue_append(&drain, &pool->free[i]);
+		qdf_nbuf_queue_init(&pool->free[i]);
+	}
+	qdf_spin_unlock_bh(&pool->lock);
+
+	while ((buf = qdf_nbuf_queue_remove(&drain)))
+		qdf_nbuf_free(buf);
+}
+
+/**
+ * wmi_buf_pool_init() - set up an empty, enabled buffer pool
+ * @pool: buffer pool
+ *
+ * Return: none
+ */
+static void wmi_buf_pool_init(struct wmi_buf_pool *pool)
+{
+	int i;
+
+	qdf_spinlock_create(&pool->lock);
+	for (i = 0; i < WMI_BUF_POOL_CLASSES; i++)
+		qdf_nbuf_queue_init(&pool->free[i]);
+	pool->enabled = true;
+}
+
+/**
+ * wmi_buf_pool_deinit() - free the idle buffers of a buffer pool
+ * @pool: buffer pool
+ *
+ * Return: none
+ */
+static void wmi_buf_pool_deinit(struct wmi_buf_pool *pool)
+{
+	pool->enabled = false;
+	wmi_buf_pool_drain(pool);
+	qdf_spinlock_destroy(&pool->lock);
+}
+
 #ifdef WMI_INTERFACE_EVENT_LOGGING
 #ifndef MAX_WMI_INSTANCES
 #ifdef CONFIG_MCL
@@ -120,372 +300,251 @@ int qcacld_bp_seq_printf(struct seq_file *m, const char *f, ...)
 #endif
 #endif
 
-/* WMI commands */
-uint32_t g_wmi_command_buf_idx = 0;
-struct wmi_command_debug wmi_command_log_buffer[WMI_EVENT_DEBUG_MAX_ENTRY];
-
-/* WMI commands TX completed */
-uint32_t g_wmi_command_tx_cmp_buf_idx = 0;
-struct wmi_command_debug
-	wmi_command_tx_cmp_log_buffer[WMI_EVENT_DEBUG_MAX_ENTRY];
-
-/* WMI events when processed */
-uint32_t g_wmi_event_buf_idx = 0;
-struct wmi_event_debug wmi_event_log_buffer[WMI_EVENT_DEBUG_MAX_ENTRY];
-
-/* WMI events when queued */
-uint32_t g_wmi_rx_event_buf_idx = 0;
-struct wmi_event_debug wmi_rx_event_log_buffer[WMI_EVENT_DEBUG_MAX_ENTRY];
-
-#define WMI_COMMAND_RECORD(h, a, b) {					\
-	if (wmi_log_max_entry <=					\
-		*(h->log_info.wmi_command_log_buf_info.p_buf_tail_idx))	\
-		*(h->log_info.wmi_command_log_buf_info.p_buf_tail_idx) = 0;\
-	((struct wmi_command_debug *)h->log_info.wmi_command_log_buf_info.buf)\
-		[*(h->log_info.wmi_command_log_buf_info.p_buf_tail_idx)]\
-						.command = a;		\
-	qdf_mem_copy(((struct wmi_command_debug *)h->log_info.		\
-				wmi_command_log_buf_info.buf)		\
-		[*(h->log_info.wmi_command_log_buf_info.p_buf_tail_idx)].data,\
-			b, wmi_record_max_length);			\
-	((struct wmi_command_debug *)h->log_info.wmi_command_log_buf_info.buf)\
-		[*(h->log_info.wmi_command_log_buf_info.p_buf_tail_idx)].\
-		time = qdf_get_log_timestamp();			\
-	(*(h->log_info.wmi_command_log_buf_info.p_buf_tail_idx))++;	\
-	h->log_info.wmi_command_log_buf_info.length++;			\
-}
-
-#define WMI_COMMAND_TX_CMP_RECORD(h, a, b) {				\
-	if (wmi_log_max_entry <=					\
-		*(h->log_info.wmi_command_tx_cmp_log_buf_info.p_buf_tail_idx))\
-		*(h->log_info.wmi_command_tx_cmp_log_buf_info.p_buf_tail_idx) = 0;\
-	((struct wmi_command_debug *)h->log_info.			\
-		wmi_command_tx_cmp_log_buf_info.buf)			\
-		[*(h->log_info.wmi_command_tx_cmp_log_buf_info.		\
-				p_buf_tail_idx)].			\
-							command	= a;	\
-	qdf_mem_copy(((struct wmi_command_debug *)h->log_info.		\
-				wmi_command_tx_cmp_log_buf_info.buf)	\
-		[*(h->log_info.wmi_command_tx_cmp_log_buf_info.		\
-			p_buf_tail_idx)].				\
-		data, b, wmi_record_max_length);			\
-	((struct wmi_command_debug *)h->log_info.			\
-		wmi_command_tx_cmp_log_buf_info.buf)			\
-		[*(h->log_info.wmi_command_tx_cmp_log_buf_info.		\
-				p_buf_tail_idx)].			\
-		time = qdf_get_log_timestamp();				\
-	(*(h->log_info.wmi_command_tx_cmp_log_buf_info.p_buf_tail_idx))++;\
-	h->log_info.wmi_command_tx_cmp_log_buf_info.length++;		\
-}
-
-#define WMI_EVENT_RECORD(h, a, b) {					\
-	if (wmi_log_max_entry <=					\
-		*(h->log_info.wmi_event_log_buf_info.p_buf_tail_idx))	\
-		*(h->log_info.wmi_event_log_buf_info.p_buf_tail_idx) = 0;\
-	((struct wmi_event_debug *)h->log_info.wmi_event_log_buf_info.buf)\
-		[*(h->log_info.wmi_event_log_buf_info.p_buf_tail_idx)].	\
-		event = a;						\
-	qdf_mem_copy(((struct wmi_event_debug *)h->log_info.		\
-				wmi_event_log_buf_info.buf)		\
-		[*(h->log_info.wmi_event_log_buf_info.p_buf_tail_idx)].data, b,\
-		wmi_record_max_length);					\
-	((struct wmi_event_debug *)h->log_info.wmi_event_log_buf_info.buf)\
-		[*(h->log_info.wmi_event_log_buf_info.p_buf_tail_idx)].time =\
-		qdf_get_log_timestamp();				\
-	(*(h->log_info.wmi_event_log_buf_info.p_buf_tail_idx))++;	\
-	h->log_info.wmi_event_log_buf_info.length++;			\
-}
-
-#define WMI_RX_EVENT_RECORD(h, a, b) {					\
-	if (wmi_log_max_entry <=					\
-		*(h->log_info.wmi_rx_event_log_buf_info.p_buf_tail_idx))\
-		*(h->log_info.wmi_rx_event_log_buf_info.p_buf_tail_idx) = 0;\
-	((struct wmi_event_debug *)h->log_info.wmi_rx_event_log_buf_info.buf)\
-		[*(h->log_info.wmi_rx_event_log_buf_info.p_buf_tail_idx)].\
-		event = a;						\
-	qdf_mem_copy(((struct wmi_event_debug *)h->log_info.		\
-				wmi_rx_event_log_buf_info.buf)		\
-		[*(h->log_info.wmi_rx_event_log_buf_info.p_buf_tail_idx)].\
-			data, b, wmi_record_max_length);		\
-	((struct wmi_event_debug *)h->log_info.wmi_rx_event_log_buf_info.buf)\
-		[*(h->log_info.wmi_rx_event_log_buf_info.p_buf_tail_idx)].\
-		time =	qdf_get_log_timestamp();			\
-	(*(h->log_info.wmi_rx_event_log_buf_info.p_buf_tail_idx))++;	\
-	h->log_info.wmi_rx_event_log_buf_info.length++;			\
-}
-
-uint32_t g_wmi_mgmt_command_buf_idx = 0;
-struct
-wmi_command_debug wmi_mgmt_command_log_buffer[WMI_MGMT_EVENT_DEBUG_MAX_ENTRY];
-
-/* wmi_mgmt commands TX completed */
-uint32_t g_wmi_mgmt_command_tx_cmp_buf_idx = 0;
-struct wmi_command_debug
-wmi_mgmt_command_tx_cmp_log_buffer[WMI_MGMT_EVENT_DEBUG_MAX_ENTRY];
-
-/* wmi_mgmt events when processed */
-uint32_t g_wmi_mgmt_event_buf_idx = 0;
-struct wmi_event_debug
-wmi_mgmt_event_log_buffer[WMI_MGMT_EVENT_DEBUG_MAX_ENTRY];
-
-#define WMI_MGMT_COMMAND_RECORD(a, b, c, d, e) {			     \
-	if (WMI_MGMT_EVENT_DEBUG_MAX_ENTRY <=				     \
-		g_wmi_mgmt_command_buf_idx)				     \
-		g_wmi_mgmt_command_buf_idx = 0;				     \
-	wmi_mgmt_command_log_buffer[g_wmi_mgmt_command_buf_idx].command = a; \
-	wmi_mgmt_command_log_buffer[g_wmi_mgmt_command_buf_idx].data[0] = b; \
-	wmi_mgmt_command_log_buffer[g_wmi_mgmt_command_buf_idx].data[1] = c; \
-	wmi_mgmt_command_log_buffer[g_wmi_mgmt_command_buf_idx].data[2] = d; \
-	wmi_mgmt_command_log_buffer[g_wmi_mgmt_command_buf_idx].data[3] = e; \
-	wmi_mgmt_command_log_buffer[g_wmi_mgmt_command_buf_idx].time =	     \
-		qdf_get_log_timestamp();				     \
-	g_wmi_mgmt_command_buf_idx++;					     \
-}
-
-#define WMI_MGMT_COMMAND_TX_CMP_RECORD(h, a, b) {			\
-	if (wmi_mgmt_log_max_entry <=					\
-		*(h->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.	\
-			p_buf_tail_idx))				\
-		*(h->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.	\
-			p_buf_tail_idx) = 0;				\
-	((struct wmi_command_debug *)h->log_info.			\
-			wmi_mgmt_command_tx_cmp_log_buf_info.buf)	\
-		[*(h->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.	\
-				p_buf_tail_idx)].command = a;		\
-	qdf_mem_copy(((struct wmi_command_debug *)h->log_info.		\
-				wmi_mgmt_command_tx_cmp_log_buf_info.buf)\
-		[*(h->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.	\
-			p_buf_tail_idx)].data, b,			\
-			wmi_record_max_length);				\
-	((struct wmi_command_debug *)h->log_info.			\
-			wmi_mgmt_command_tx_cmp_log_buf_info.buf)	\
-		[*(h->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.	\
-				p_buf_tail_idx)].time =			\
-		qdf_get_log_timestamp();				\
-	(*(h->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.		\
-			p_buf_tail_idx))++;				\
-	h->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.length++;	\
-}
-
-#define WMI_MGMT_EVENT_RECORD(h, a, b) {				\
-	if (wmi_mgmt_log_max_entry <=					\
-		*(h->log_info.wmi_mgmt_event_log_buf_info.p_buf_tail_idx))\
-		*(h->log_info.wmi_mgmt_event_log_buf_info.p_buf_tail_idx) = 0;\
-	((struct wmi_event_debug *)h->log_info.wmi_mgmt_event_log_buf_info.buf)\
-		[*(h->log_info.wmi_mgmt_event_log_buf_info.p_buf_tail_idx)]\
-					.event = a;			\
-	qdf_mem_copy(((struct wmi_event_debug *)h->log_info.		\
-				wmi_mgmt_event_log_buf_info.buf)	\
-		[*(h->log_info.wmi_mgmt_event_log_buf_info.p_buf_tail_idx)].\
-			data, b, wmi_record_max_length);		\
-	((struct wmi_event_debug *)h->log_info.wmi_mgmt_event_log_buf_info.buf)\
-		[*(h->log_info.wmi_mgmt_event_log_buf_info.p_buf_tail_idx)].\
-			time = qdf_get_log_timestamp();			\
-	(*(h->log_info.wmi_mgmt_event_log_buf_info.p_buf_tail_idx))++;	\
-	h->log_info.wmi_mgmt_event_log_buf_info.length++;		\
-}
-
 /* These are defined to made it as module param, which can be configured */
 uint32_t wmi_log_max_entry = WMI_EVENT_DEBUG_MAX_ENTRY;
 uint32_t wmi_mgmt_log_max_entry = WMI_MGMT_EVENT_DEBUG_MAX_ENTRY;
 uint32_t wmi_record_max_length = WMI_EVENT_DEBUG_ENTRY_MAX_LENGTH;
 uint32_t wmi_display_size = 100;
 
-static uint8_t *wmi_id_to_name(uint32_t wmi_command);
+/*
+ * Logs of the first WMI handle, named after the static log buffers MCL
+ * used to record into so that ramdump parsers still find them. Each
+ * points at the per-CPU rings of a log, whose tails are the write
+ * indexes that g_wmi_*_idx used to hold.
+ */
+struct wmi_log_buf_t *wmi_command_log_buffer;
+struct wmi_log_buf_t *wmi_command_tx_cmp_log_buffer;
+struct wmi_log_buf_t *wmi_event_log_buffer;
+struct wmi_log_buf_t *wmi_rx_event_log_buffer;
+struct wmi_log_buf_t *wmi_mgmt_command_log_buffer;
+struct wmi_log_buf_t *wmi_mgmt_command_tx_cmp_log_buffer;
+struct wmi_log_buf_t *wmi_mgmt_event_log_buffer;
 
 /**
- * wmi_log_init() - Initialize WMI event logging
- * @wmi_handle: WMI handle.
+ * wmi_log_reserve() - claim the next record of this CPU's log ring
+ * @log: WMI log
+ * @rec_size: size of one record of @log
  *
- * Return: Initialization status
+ * Preemption stays disabled until wmi_log_commit(). A record made from
+ * an interrupt on the same CPU in between claims the following slot.
+ *
+ * Return: record to fill in
  */
-#ifdef CONFIG_MCL
-static QDF_STATUS wmi_log_init(struct wmi_unified *wmi_handle)
+static inline void *wmi_log_reserve(struct wmi_log_buf_t *log,
+				    size_t rec_size)
 {
-	struct wmi_log_buf_t *cmd_log_buf =
-			&wmi_handle->log_info.wmi_command_log_buf_info;
-	struct wmi_log_buf_t *cmd_tx_cmpl_log_buf =
-			&wmi_handle->log_info.wmi_command_tx_cmp_log_buf_info;
-
-	struct wmi_log_buf_t *event_log_buf =
-			&wmi_handle->log_info.wmi_event_log_buf_info;
-	struct wmi_log_buf_t *rx_event_log_buf =
-			&wmi_handle->log_info.wmi_rx_event_log_buf_info;
-
-	struct wmi_log_buf_t *mgmt_cmd_log_buf =
-			&wmi_handle->log_info.wmi_mgmt_command_log_buf_info;
-	struct wmi_log_buf_t *mgmt_cmd_tx_cmp_log_buf =
-		&wmi_handle->log_info.wmi_mgmt_command_tx_cmp_log_buf_info;
-	struct wmi_log_buf_t *mgmt_event_log_buf =
-			&wmi_handle->log_info.wmi_mgmt_event_log_buf_info;
-
-	/* WMI commands */
-	cmd_log_buf->length = 0;
-	cmd_log_buf->buf_tail_idx = 0;
-	cmd_log_buf->buf = wmi_command_log_buffer;
-	cmd_log_buf->p_buf_tail_idx = &g_wmi_command_buf_idx;
-
-	/* WMI commands TX completed */
-	cmd_tx_cmpl_log_buf->length = 0;
-	cmd_tx_cmpl_log_buf->buf_tail_idx = 0;
-	cmd_tx_cmpl_log_buf->buf = wmi_command_tx_cmp_log_buffer;
-	cmd_tx_cmpl_log_buf->p_buf_tail_idx = &g_wmi_command_tx_cmp_buf_idx;
-
-	/* WMI events when processed */
-	event_log_buf->length = 0;
-	event_log_buf->buf_tail_idx = 0;
-	event_log_buf->buf = wmi_event_log_buffer;
-	event_log_buf->p_buf_tail_idx = &g_wmi_event_buf_idx;
-
-	/* WMI events when queued */
-	rx_event_log_buf->length = 0;
-	rx_event_log_buf->buf_tail_idx = 0;
-	rx_event_log_buf->buf = wmi_rx_event_log_buffer;
-	rx_event_log_buf->p_buf_tail_idx = &g_wmi_rx_event_buf_idx;
-
-	/* WMI Management commands */
-	mgmt_cmd_log_buf->length = 0;
-	mgmt_cmd_log_buf->buf_tail_idx = 0;
-	mgmt_cmd_log_buf->buf = wmi_mgmt_command_log_buffer;
-	mgmt_cmd_log_buf->p_buf_tail_idx = &g_wmi_mgmt_command_buf_idx;
-
-	/* WMI Management commands Tx completed*/
-	mgmt_cmd_tx_cmp_log_buf->length = 0;
-	mgmt_cmd_tx_cmp_log_buf->buf_tail_idx = 0;
-	mgmt_cmd_tx_cmp_log_buf->buf = wmi_mgmt_command_tx_cmp_log_buffer;
-	mgmt_cmd_tx_cmp_log_buf->p_buf_tail_idx =
-		&g_wmi_mgmt_command_tx_cmp_buf_idx;
-
-	/* WMI Management events when processed*/
-	mgmt_event_log_buf->length = 0;
-	mgmt_event_log_buf->buf_tail_idx = 0;
-	mgmt_event_log_buf->buf = wmi_mgmt_event_log_buffer;
-	mgmt_event_log_buf->p_buf_tail_idx = &g_wmi_mgmt_event_buf_idx;
-
-	qdf_spinlock_create(&wmi_handle->log_info.wmi_record_lock);
-	wmi_handle->log_info.wmi_logging_enable = 1;
+	struct wmi_log_cpu_ring *ring = get_cpu_ptr(log->rings);
+	uint32_t slot = this_cpu_inc_return(log->rings->tail) - 1;
 
-	return QDF_STATUS_SUCCESS;
+	return (uint8_t *)ring->buf + (slot & (log->entries - 1)) * rec_size;
 }
-#else
-static QDF_STATUS wmi_log_init(struct wmi_unified *wmi_handle)
+
+/**
+ * wmi_log_commit() - finish a record claimed with wmi_log_reserve()
+ * @log: WMI log
+ *
+ * Return: none
+ */
+static inline void wmi_log_commit(struct wmi_log_buf_t *log)
 {
-	struct wmi_log_buf_t *cmd_log_buf =
-			&wmi_handle->log_info.wmi_command_log_buf_info;
-	struct wmi_log_buf_t *cmd_tx_cmpl_log_buf =
-			&wmi_handle->log_info.wmi_command_tx_cmp_log_buf_info;
-
-	struct wmi_log_buf_t *event_log_buf =
-			&wmi_handle->log_info.wmi_event_log_buf_info;
-	struct wmi_log_buf_t *rx_event_log_buf =
-			&wmi_handle->log_info.wmi_rx_event_log_buf_info;
-
-	struct wmi_log_buf_t *mgmt_cmd_log_buf =
-			&wmi_handle->log_info.wmi_mgmt_command_log_buf_info;
-	struct wmi_log_buf_t *mgmt_cmd_tx_cmp_log_buf =
-		&wmi_handle->log_info.wmi_mgmt_command_tx_cmp_log_buf_info;
-	struct wmi_log_buf_t *mgmt_event_log_buf =
-			&wmi_handle->log_info.wmi_mgmt_event_log_buf_info;
-
-	wmi_handle->log_info.wmi_logging_enable = 0;
-
-	/* WMI commands */
-	cmd_log_buf->length = 0;
-	cmd_log_buf->buf_tail_idx = 0;
-	cmd_log_buf->buf = (struct wmi_command_debug *) qdf_mem_malloc(
-		wmi_log_max_entry * sizeof(struct wmi_command_debug));
-
-	if (!cmd_log_buf->buf) {
-		qdf_print("no memory for WMI command log buffer..\n");
-		return QDF_STATUS_E_NOMEM;
-	}
-	cmd_log_buf->p_buf_tail_idx = &cmd_log_buf->buf_tail_idx;
+	put_cpu_ptr(log->rings);
+}
+
+/**
+ * wmi_log_command() - record a WMI command
+ * @log: WMI log
+ * @cmd: command id
+ * @data: command payload, wmi_record_max_length bytes are kept
+ *
+ * Return: none
+ */
+static inline void wmi_log_command(struct wmi_log_buf_t *log, uint32_t cmd,
+				   void *data)
+{
+	struct wmi_command_debug *rec;
+
+	if (!log->rings)
+		return;
 
-	/* WMI commands TX completed */
-	cmd_tx_cmpl_log_buf->length = 0;
-	cmd_tx_cmpl_log_buf->buf_tail_idx = 0;
-	cmd_tx_cmpl_log_buf->buf = (struct wmi_command_debug *) qdf_mem_malloc(
-		wmi_log_max_entry * sizeof(struct wmi_command_debug));
+	rec = wmi_log_reserve(log, sizeof(*rec));
+	rec->command = cmd;
+	qdf_mem_copy(rec->data, data, wmi_record_max_length);
+	rec->time = qdf_get_log_timestamp();
+	wmi_log_commit(log);
+}
 
-	if (!cmd_tx_cmpl_log_buf->buf) {
-		qdf_print("no memory for WMI Command Tx Complete log buffer..\n");
-		return QDF_STATUS_E_NOMEM;
-	}
-	cmd_tx_cmpl_log_buf->p_buf_tail_idx =
-		&cmd_tx_cmpl_log_buf->buf_tail_idx;
+/**
+ * wmi_log_event() - record a WMI event
+ * @log: WMI log
+ * @event: event id
+ * @data: event payload, wmi_record_max_length bytes are kept
+ *
+ * Return: none
+ */
+static inline void wmi_log_event(struct wmi_log_buf_t *log, uint32_t event,
+				 void *data)
+{
+	struct wmi_event_debug *rec;
 
-	/* WMI events when processed */
-	event_log_buf->length = 0;
-	event_log_buf->buf_tail_idx = 0;
-	event_log_buf->buf = (struct wmi_event_debug *) qdf_mem_malloc(
-		wmi_log_max_entry * sizeof(struct wmi_event_debug));
+	if (!log->rings)
+		return;
 
-	if (!event_log_buf->buf) {
-		qdf_print("no memory for WMI Event log buffer..\n");
-		return QDF_STATUS_E_NOMEM;
-	}
-	event_log_buf->p_buf_tail_idx = &event_log_buf->buf_tail_idx;
+	rec = wmi_log_reserve(log, sizeof(*rec));
+	rec->event = event;
+	qdf_mem_copy(rec->data, data, wmi_record_max_length);
+	rec->time = qdf_get_log_timestamp();
+	wmi_log_commit(log);
+}
 
-	/* WMI events when queued */
-	rx_event_log_buf->length = 0;
-	rx_event_log_buf->buf_tail_idx = 0;
-	rx_event_log_buf->buf = (struct wmi_event_debug *) qdf_mem_malloc(
-		wmi_log_max_entry * sizeof(struct wmi_event_debug));
+/**
+ * wmi_log_mgmt_command() - record a WMI management command
+ * @log: WMI log
+ * @cmd: command id
+ * @type: frame type
+ * @sub_type: frame sub type
+ * @vdev_id: vdev the frame is sent on
+ * @chanfreq: channel frequency
+ *
+ * Return: none
+ */
+static inline void wmi_log_mgmt_command(struct wmi_log_buf_t *log,
+					uint32_t cmd, uint32_t type,
+					uint32_t sub_type, uint32_t vdev_id,
+					uint32_t chanfreq)
+{
+	struct wmi_command_debug *rec;
 
-	if (!rx_event_log_buf->buf) {
-		qdf_print("no memory for WMI Event Rx log buffer..\n");
-		return QDF_STATUS_E_NOMEM;
-	}
-	rx_event_log_buf->p_buf_tail_idx = &rx_event_log_buf->buf_tail_idx;
+	if (!log->rings)
+		return;
 
-	/* WMI Management commands */
-	mgmt_cmd_log_buf->length = 0;
-	mgmt_cmd_log_buf->buf_tail_idx = 0;
-	mgmt_cmd_log_buf->buf = (struct wmi_command_debug *) qdf_mem_malloc(
-		wmi_mgmt_log_max_entry *
-		sizeof(struct wmi_command_debug));
+	rec = wmi_log_reserve(log, sizeof(*rec));
+	rec->command = cmd;
+	rec->data[0] = type;
+	rec->data[1] = sub_type;
+	rec->data[2] = vdev_id;
+	rec->data[3] = chanfreq;
+	rec->time = qdf_get_log_timestamp();
+	wmi_log_commit(log);
+}
 
-	if (!mgmt_cmd_log_buf->buf) {
-		qdf_print("no memory for WMI Management Command log buffer..\n");
-		return QDF_STATUS_E_NOMEM;
-	}
-	mgmt_cmd_log_buf->p_buf_tail_idx = &mgmt_cmd_log_buf->buf_tail_idx;
+#define WMI_COMMAND_RECORD(h, a, b)					\
+	wmi_log_command(&(h)->log_info.wmi_command_log_buf_info, a, b)
+
+#define WMI_COMMAND_TX_CMP_RECORD(h, a, b)				\
+	wmi_log_command(&(h)->log_info.wmi_command_tx_cmp_log_buf_info, a, b)
+
+#define WMI_EVENT_RECORD(h, a, b)					\
+	wmi_log_event(&(h)->log_info.wmi_event_log_buf_info, a, b)
+
+#define WMI_RX_EVENT_RECORD(h, a, b)					\
+	wmi_log_event(&(h)->log_info.wmi_rx_event_log_buf_info, a, b)
 
-	/* WMI Management commands Tx completed*/
-	mgmt_cmd_tx_cmp_log_buf->length = 0;
-	mgmt_cmd_tx_cmp_log_buf->buf_tail_idx = 0;
-	mgmt_cmd_tx_cmp_log_buf->buf = (struct wmi_command_debug *)
-		qdf_mem_malloc(
-		wmi_mgmt_log_max_entry *
-		sizeof(struct wmi_command_debug));
+#define WMI_MGMT_COMMAND_RECORD(h, a, b, c, d, e)			\
+	wmi_log_mgmt_command(&(h)->log_info.wmi_mgmt_command_log_buf_info,\
+			     a, b, c, d, e)
 
-	if (!mgmt_cmd_tx_cmp_log_buf->buf) {
-		qdf_print("no memory for WMI Management Command Tx complete log buffer..\n");
+#define WMI_MGMT_COMMAND_TX_CMP_RECORD(h, a, b)				\
+	wmi_log_command(&(h)->log_info.					\
+			wmi_mgmt_command_tx_cmp_log_buf_info, a, b)
+
+#define WMI_MGMT_EVENT_RECORD(h, a, b)					\
+	wmi_log_event(&(h)->log_info.wmi_mgmt_event_log_buf_info, a, b)
+
+static uint8_t *wmi_id_to_name(uint32_t wmi_command);
+static int wmi_evt_replay_run(struct wmi_unified *wmi_handle,
+			      uint32_t loops, bool dispatch);
+
+/**
+ * wmi_log_buf_alloc() - allocate the per-CPU rings of a WMI log
+ * @log: WMI log
+ * @max_entry: records kept by each CPU ring
+ * @rec_size: size of one record
+ *
+ * Every possible CPU keeps the full @max_entry history, at least
+ * WMI_LOG_CPU_MIN_ENTRIES, rounded up to a power of two.
+ *
+ * Return: QDF_STATUS_SUCCESS or QDF_STATUS_E_NOMEM
+ */
+static QDF_STATUS wmi_log_buf_alloc(struct wmi_log_buf_t *log,
+				    uint32_t max_entry, size_t rec_size)
+{
+	struct wmi_log_cpu_ring *ring;
+	uint32_t entries;
+	int cpu;
+
+	entries = max_entry;
+	if (entries < WMI_LOG_CPU_MIN_ENTRIES)
+		entries = WMI_LOG_CPU_MIN_ENTRIES;
+	log->entries = roundup_pow_of_two(entries);
+
+	log->rings = alloc_percpu(struct wmi_log_cpu_ring);
+	if (!log->rings)
 		return QDF_STATUS_E_NOMEM;
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(log->rings, cpu);
+		ring->buf = qdf_mem_malloc(log->entries * rec_size);
+		if (!ring->buf)
+			return QDF_STATUS_E_NOMEM;
 	}
-	mgmt_cmd_tx_cmp_log_buf->p_buf_tail_idx =
-		&mgmt_cmd_tx_cmp_log_buf->buf_tail_idx;
 
-	/* WMI Management events when processed*/
-	mgmt_event_log_buf->length = 0;
-	mgmt_event_log_buf->buf_tail_idx = 0;
+	return QDF_STATUS_SUCCESS;
+}
+
+/**
+ * wmi_log_buf_free() - free the per-CPU rings of a WMI log
+ * @log: WMI log, may be partially allocated
+ *
+ * Return: none
+ */
+static void wmi_log_buf_free(struct wmi_log_buf_t *log)
+{
+	struct wmi_log_cpu_ring *ring;
+	int cpu;
 
-	mgmt_event_log_buf->buf = (struct wmi_event_debug *) qdf_mem_malloc(
-		wmi_mgmt_log_max_entry *
-		sizeof(struct wmi_event_debug));
+	if (!log->rings)
+		return;
 
-	if (!mgmt_event_log_buf->buf) {
-		qdf_print("no memory for WMI Management Event log buffer..\n");
-		return QDF_STATUS_E_NOMEM;
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(log->rings, cpu);
+		if (ring->buf)
+			qdf_mem_free(ring->buf);
 	}
-	mgmt_event_log_buf->p_buf_tail_idx = &mgmt_event_log_buf->buf_tail_idx;
+	free_percpu(log->rings);
+	log->rings = NULL;
+}
 
-	qdf_spinlock_create(&wmi_handle->log_info.wmi_record_lock);
-	wmi_handle->log_info.wmi_logging_enable = 1;
+/**
+ * wmi_log_ramdump_set() - point the ramdump log symbols at a handle
+ * @log_info: logs of the WMI handle
+ * @set: true to take the symbols if free, false to release them
+ *
+ * Return: none
+ */
+static void wmi_log_ramdump_set(struct wmi_debug_log_info *log_info,
+				bool set)
+{
+	if (set && wmi_command_log_buffer)
+		return;
+	if (!set && wmi_command_log_buffer !=
+	    &log_info->wmi_command_log_buf_info)
+		return;
 
-	return QDF_STATUS_SUCCESS;
+	wmi_command_log_buffer = set ?
+		&log_info->wmi_command_log_buf_info : NULL;
+	wmi_command_tx_cmp_log_buffer = set ?
+		&log_info->wmi_command_tx_cmp_log_buf_info : NULL;
+	wmi_event_log_buffer = set ?
+		&log_info->wmi_event_log_buf_info : NULL;
+	wmi_rx_event_log_buffer = set ?
+		&log_info->wmi_rx_event_log_buf_info : NULL;
+	wmi_mgmt_command_log_buffer = set ?
+		&log_info->wmi_mgmt_command_log_buf_info : NULL;
+	wmi_mgmt_command_tx_cmp_log_buffer = set ?
+		&log_info->wmi_mgmt_command_tx_cmp_log_buf_info : NULL;
+	wmi_mgmt_event_log_buffer = set ?
+		&log_info->wmi_mgmt_event_log_buf_info : NULL;
 }
-#endif
 
 /**
  * wmi_log_buffer_free() - Free all dynamic allocated buffer memory for
@@ -494,37 +553,194 @@ static QDF_STATUS wmi_log_init(struct wmi_unified *wmi_handle)
  *
  * Return: None
  */
-#ifndef CONFIG_MCL
-static inline void wmi_log_buffer_free(struct wmi_unified *wmi_handle)
-{
-	if (wmi_handle->log_info.wmi_command_log_buf_info.buf)
-		qdf_mem_free(wmi_handle->log_info.wmi_command_log_buf_info.buf);
-	if (wmi_handle->log_info.wmi_command_tx_cmp_log_buf_info.buf)
-		qdf_mem_free(
-		wmi_handle->log_info.wmi_command_tx_cmp_log_buf_info.buf);
-	if (wmi_handle->log_info.wmi_event_log_buf_info.buf)
-		qdf_mem_free(wmi_handle->log_info.wmi_event_log_buf_info.buf);
-	if (wmi_handle->log_info.wmi_rx_event_log_buf_info.buf)
-		qdf_mem_free(
-			wmi_handle->log_info.wmi_rx_event_log_buf_info.buf);
-	if (wmi_handle->log_info.wmi_mgmt_command_log_buf_info.buf)
-		qdf_mem_free(
-			wmi_handle->log_info.wmi_mgmt_command_log_buf_info.buf);
-	if (wmi_handle->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.buf)
-		qdf_mem_free(
-		wmi_handle->log_info.wmi_mgmt_command_tx_cmp_log_buf_info.buf);
-	if (wmi_handle->log_info.wmi_mgmt_event_log_buf_info.buf)
-		qdf_mem_free(
-			wmi_handle->log_info.wmi_mgmt_event_log_buf_info.buf);
-	wmi_handle->log_info.wmi_logging_enable = 0;
-	qdf_spinlock_destroy(&wmi_handle->log_info.wmi_record_lock);
+static void wmi_log_buffer_free(struct wmi_unified *wmi_handle)
+{
+	struct wmi_debug_log_info *log_info = &wmi_handle->log_info;
+
+	log_info->wmi_logging_enable = 0;
+	wmi_log_ramdump_set(log_info, false);
+	wmi_log_buf_free(&log_info->wmi_command_log_buf_info);
+	wmi_log_buf_free(&log_info->wmi_command_tx_cmp_log_buf_info);
+	wmi_log_buf_free(&log_info->wmi_event_log_buf_info);
+	wmi_log_buf_free(&log_info->wmi_rx_event_log_buf_info);
+	wmi_log_buf_free(&log_info->wmi_mgmt_command_log_buf_info);
+	wmi_log_buf_free(&log_info->wmi_mgmt_command_tx_cmp_log_buf_info);
+	wmi_log_buf_free(&log_info->wmi_mgmt_event_log_buf_info);
 }
-#else
-static inline void wmi_log_buffer_free(struct wmi_unified *wmi_handle)
+
+/**
+ * wmi_log_init() - Initialize WMI event logging
+ * @wmi_handle: WMI handle.
+ *
+ * Each log is a set of per-CPU rings so that recording never takes a
+ * lock or bounces a shared tail index between CPUs.
+ *
+ * Return: Initialization status
+ */
+static QDF_STATUS wmi_log_init(struct wmi_unified *wmi_handle)
+{
+	struct wmi_debug_log_info *log_info = &wmi_handle->log_info;
+	QDF_STATUS status;
+
+	log_info->wmi_logging_enable = 0;
+
+	status = wmi_log_buf_alloc(&log_info->wmi_command_log_buf_info,
+				   wmi_log_max_entry,
+				   sizeof(struct wmi_command_debug));
+	if (QDF_IS_STATUS_SUCCESS(status))
+		status = wmi_log_buf_alloc(
+				&log_info->wmi_command_tx_cmp_log_buf_info,
+				wmi_log_max_entry,
+				sizeof(struct wmi_command_debug));
+	if (QDF_IS_STATUS_SUCCESS(status))
+		status = wmi_log_buf_alloc(&log_info->wmi_event_log_buf_info,
+					   wmi_log_max_entry,
+					   sizeof(struct wmi_event_debug));
+	if (QDF_IS_STATUS_SUCCESS(status))
+		status = wmi_log_buf_alloc(
+				&log_info->wmi_rx_event_log_buf_info,
+				wmi_log_max_entry,
+				sizeof(struct wmi_event_debug));
+	if (QDF_IS_STATUS_SUCCESS(status))
+		status = wmi_log_buf_alloc(
+				&log_info->wmi_mgmt_command_log_buf_info,
+				wmi_mgmt_log_max_entry,
+				sizeof(struct wmi_command_debug));
+	if (QDF_IS_STATUS_SUCCESS(status))
+		status = wmi_log_buf_alloc(
+				&log_info->wmi_mgmt_command_tx_cmp_log_buf_info,
+				wmi_mgmt_log_max_entry,
+				sizeof(struct wmi_command_debug));
+	if (QDF_IS_STATUS_SUCCESS(status))
+		status = wmi_log_buf_alloc(
+				&log_info->wmi_mgmt_event_log_buf_info,
+				wmi_mgmt_log_max_entry,
+				sizeof(struct wmi_event_debug));
+
+	if (QDF_IS_STATUS_ERROR(status)) {
+		qdf_print("no memory for WMI log buffers..\n");
+		wmi_log_buffer_free(wmi_handle);
+		return status;
+	}
+
+	wmi_log_ramdump_set(log_info, true);
+	log_info->wmi_logging_enable = 1;
+
+	return QDF_STATUS_SUCCESS;
+}
+
+/**
+ * wmi_cmd_lat_slot() - find the latency slot of a command id
+ * @tbl: latency table, lock held
+ * @cmd_id: command id
+ * @create: claim a free slot when @cmd_id has none yet
+ *
+ * Return: slot, NULL if @cmd_id has none and none was claimed
+ */
+static struct wmi_cmd_lat *wmi_cmd_lat_slot(struct wmi_cmd_lat_tbl *tbl,
+					    uint32_t cmd_id, bool create)
 {
-	/* Do Nothing */
+	struct wmi_cmd_lat *slot;
+	uint32_t hash = (cmd_id * 2654435761U) >> (32 - WMI_CMD_LAT_SLOT_BITS);
+	uint32_t i;
+
+	for (i = 0; i < WMI_CMD_LAT_SLOTS; i++) {
+		slot = &tbl->slots[(hash + i) & (WMI_CMD_LAT_SLOTS - 1)];
+		if (!slot->used) {
+			if (!create)
+				return NULL;
+			slot->used = true;
+			slot->cmd_id = cmd_id;
+			return slot;
+		}
+		if (slot->cmd_id == cmd_id)
+			return slot;
+	}
+
+	return NULL;
+}
+
+/**
+ * wmi_lat_hist_add() - add a sample to a latency histogram
+ * @hist: histogram
+ * @us: latency in us
+ *
+ * Return: none
+ */
+static void wmi_lat_hist_add(struct wmi_lat_hist *hist, uint32_t us)
+{
+	uint32_t bin = fls(us);
+
+	if (bin >= WMI_CMD_LAT_BINS)
+		bin = WMI_CMD_LAT_BINS - 1;
+	hist->bins[bin]++;
+	hist->count++;
+	if (us > hist->max_us)
+		hist->max_us = us;
+}
+
+/**
+ * wmi_lat_hist_pct() - estimate a percentile of a latency histogram
+ * @hist: histogram with at least one sample
+ * @pct: percentile, 1 to 100
+ *
+ * Return: upper bound in us of the bin holding the percentile, capped
+ * at the largest sample
+ */
+static uint32_t wmi_lat_hist_pct(struct wmi_lat_hist *hist, uint32_t pct)
+{
+	uint32_t want = ((uint64_t)hist->count * pct + 99) / 100;
+	uint32_t seen = 0;
+	uint32_t bin;
+
+	for (bin = 0; bin < WMI_CMD_LAT_BINS - 1; bin++) {
+		seen += hist->bins[bin];
+		if (seen >= want)
+			return QDF_MIN((1U << bin) - 1, hist->max_us);
+	}
+
+	return hist->max_us;
+}
+
+/**
+ * wmi_cmd_lat_init() - set up the command latency histograms
+ * @wmi_handle: handle to wmi
+ *
+ * The histograms are optional, latencies are not tracked when they
+ * could not be allocated.
+ *
+ * Return: none
+ */
+static void wmi_cmd_lat_init(struct wmi_unified *wmi_handle)
+{
+	struct wmi_cmd_lat_tbl *tbl;
+
+	tbl = vzalloc(sizeof(*tbl));
+	if (!tbl) {
+		QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_ERROR,
+			  "%s: no memory for command latency table", __func__);
+		return;
+	}
+	qdf_spinlock_create(&tbl->lock);
+	wmi_handle->cmd_lat = tbl;
+}
+
+/**
+ * wmi_cmd_lat_deinit() - free the command latency histograms
+ * @wmi_handle: handle to wmi
+ *
+ * Return: none
+ */
+static void wmi_cmd_lat_deinit(struct wmi_unified *wmi_handle)
+{
+	struct wmi_cmd_lat_tbl *tbl = wmi_handle->cmd_lat;
+
+	if (!tbl)
+		return;
+	wmi_handle->cmd_lat = NULL;
+	qdf_spinlock_destroy(&tbl->lock);
+	vfree(tbl);
 }
-#endif
 
 #ifdef CONFIG_MCL
 const int8_t * const debugfs_dir[] = {"WMI0", "WMI1", "WMI2"};
@@ -534,10 +750,110 @@ const int8_t * const debugfs_dir[] = {"WMI0"};
 
 /* debugfs routines*/
 
+/**
+ * wmi_log_show() - print the latest records of a WMI log, newest first
+ * @m: debugfs handler
+ * @log: WMI log
+ * @rec_size: size of one record of @log
+ * @id_label: name printed for the command or event id
+ * @max_display: maximum number of records to print
+ *
+ * The per-CPU rings are merged on their record timestamps. No lock is
+ * taken, so a record being written while the log is read may be shown
+ * half updated.
+ *
+ * Return: Length of characters printed
+ */
+static int wmi_log_show(struct seq_file *m, struct wmi_log_buf_t *log,
+			size_t rec_size, const char *id_label,
+			uint32_t max_display)
+{
+	struct wmi_log_cpu_ring *ring;
+	struct wmi_command_debug *rec, *newest;
+	uint32_t *next, *left;
+	uint32_t length = 0, nread;
+	int cpu, newest_cpu = 0, outlen = 0;
+	int i;
+
+	/* command and event records are walked through the same layout */
+	BUILD_BUG_ON(sizeof(struct wmi_command_debug) !=
+		     sizeof(struct wmi_event_debug));
+
+	if (!log->rings)
+		return seq_printf(m, "no elements to read from ring buffer!\n");
+
+	next = qdf_mem_malloc(2 * nr_cpu_ids * sizeof(*next));
+	if (!next)
+		return -ENOMEM;
+	left = next + nr_cpu_ids;
+
+	for_each_possible_cpu(cpu) {
+		next[cpu] = READ_ONCE(per_cpu_ptr(log->rings, cpu)->tail);
+		left[cpu] = QDF_MIN(next[cpu], log->entries);
+		length += next[cpu];
+	}
+
+	if (!length) {
+		qdf_mem_free(next);
+		return seq_printf(m, "no elements to read from ring buffer!\n");
+	}
+
+	for (nread = 0; nread < max_display; nread++) {
+		newest = NULL;
+		for_each_possible_cpu(cpu) {
+			if (!left[cpu])
+				continue;
+			ring = per_cpu_ptr(log->rings, cpu);
+			rec = (struct wmi_command_debug *)((uint8_t *)ring->buf +
+				((next[cpu] - 1) & (log->entries - 1)) *
+				rec_size);
+			if (!newest || rec->time > newest->time) {
+				newest = rec;
+				newest_cpu = cpu;
+			}
+		}
+		if (!newest)
+			break;
+		next[newest_cpu]--;
+		left[newest_cpu]--;
+
+		outlen += seq_printf(m, "%s = %x\n", id_label, newest->command);
+		outlen += seq_printf(m, "CMD = ");
+		for (i = 0; i < (wmi_record_max_length / sizeof(uint32_t)); i++)
+			outlen += seq_printf(m, "%x ", newest->data[i]);
+		outlen += seq_printf(m, "\n");
+	}
+	outlen += seq_printf(m, "Length = %d\n", length);
+	qdf_mem_free(next);
+
+	return outlen;
+}
+
+/**
+ * wmi_log_clear() - empty a WMI log
+ * @log: WMI log
+ * @rec_size: size of one record of @log
+ *
+ * Return: none
+ */
+static void wmi_log_clear(struct wmi_log_buf_t *log, size_t rec_size)
+{
+	struct wmi_log_cpu_ring *ring;
+	int cpu;
+
+	if (!log->rings)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(log->rings, cpu);
+		qdf_mem_zero(ring->buf, log->entries * rec_size);
+		ring->tail = 0;
+	}
+}
+
 /**
  * debug_wmi_##func_base##_show() - debugfs functions to display content of
- * command and event buffers. Macro uses max buffer length to display
- * buffer when it is wraparound.
+ * command and event buffers, newest first across all CPUs.
  *
  * @m: debugfs handler to access wmi_handle
  * @v: Variable arguments (not used)
@@ -549,103 +865,23 @@ const int8_t * const debugfs_dir[] = {"WMI0"};
 						void *v)		\
 	{								\
 		wmi_unified_t wmi_handle = (wmi_unified_t) m->private;	\
-		struct wmi_log_buf_t *wmi_log =				\
-			&wmi_handle->log_info.wmi_##func_base##_buf_info;\
-		int pos, nread, outlen;					\
-		int i;							\
-									\
-		if (!wmi_log->length)					\
-			return seq_printf(m,				\
-			"no elements to read from ring buffer!\n");	\
 									\
-		if (wmi_log->length <= wmi_ring_size)			\
-			nread = wmi_log->length;			\
-		else							\
-			nread = wmi_ring_size;				\
-									\
-		if (*(wmi_log->p_buf_tail_idx) == 0)			\
-			/* tail can be 0 after wrap-around */		\
-			pos = wmi_ring_size - 1;			\
-		else							\
-			pos = *(wmi_log->p_buf_tail_idx) - 1;		\
-									\
-		outlen = 0;						\
-		qdf_spin_lock(&wmi_handle->log_info.wmi_record_lock);	\
-		while (nread--) {					\
-			struct wmi_command_debug *wmi_record;		\
-									\
-			wmi_record = (struct wmi_command_debug *)	\
-			&(((struct wmi_command_debug *)wmi_log->buf)[pos]);\
-			outlen += seq_printf(m, "CMD ID = %x\n",	\
-				(wmi_record->command));			\
-			outlen += seq_printf(m, "CMD = ");		\
-			for (i = 0; i < (wmi_record_max_length/		\
-					sizeof(uint32_t)); i++)		\
-				outlen += seq_printf(m, "%x ",		\
-					wmi_record->data[i]);		\
-			outlen += seq_printf(m, "\n");			\
-									\
-			if (pos == 0)					\
-				pos = wmi_ring_size - 1;		\
-			else						\
-				pos--;					\
-		}							\
-		outlen += seq_printf(m, "Length = %d\n", wmi_log->length);\
-		qdf_spin_unlock(&wmi_handle->log_info.wmi_record_lock);	\
-									\
-		return outlen;						\
-	}								\
+		return wmi_log_show(m,					\
+			&wmi_handle->log_info.wmi_##func_base##_buf_info,\
+			sizeof(struct wmi_command_debug), "CMD ID",	\
+			wmi_ring_size);					\
+	}
 
 #define GENERATE_EVENT_DEBUG_SHOW_FUNCS(func_base, wmi_ring_size)	\
 	static int debug_wmi_##func_base##_show(struct seq_file *m,	\
 						void *v)		\
 	{								\
 		wmi_unified_t wmi_handle = (wmi_unified_t) m->private;	\
-		struct wmi_log_buf_t *wmi_log =				\
-			&wmi_handle->log_info.wmi_##func_base##_buf_info;\
-		int pos, nread, outlen;					\
-		int i;							\
-									\
-		if (!wmi_log->length)					\
-			return seq_printf(m,				\
-			"no elements to read from ring buffer!\n");	\
 									\
-		if (wmi_log->length <= wmi_ring_size)			\
-			nread = wmi_log->length;			\
-		else							\
-			nread = wmi_ring_size;				\
-									\
-		if (*(wmi_log->p_buf_tail_idx) == 0)			\
-			/* tail can be 0 after wrap-around */		\
-			pos = wmi_ring_size - 1;			\
-		else							\
-			pos = *(wmi_log->p_buf_tail_idx) - 1;		\
-									\
-		outlen = 0;						\
-		qdf_spin_lock(&wmi_handle->log_info.wmi_record_lock);	\
-		while (nread--) {					\
-			struct wmi_event_debug *wmi_record;		\
-									\
-			wmi_record = (struct wmi_event_debug *)		\
-			&(((struct wmi_event_debug *)wmi_log->buf)[pos]);\
-			outlen += seq_printf(m, "Event ID = %x\n",	\
-				(wmi_record->event));			\
-			outlen += seq_printf(m, "CMD = ");		\
-			for (i = 0; i < (wmi_record_max_length/		\
-					sizeof(uint32_t)); i++)		\
-				outlen += seq_printf(m, "%x ",		\
-					wmi_record->data[i]);		\
-			outlen += seq_printf(m, "\n");			\
-									\
-			if (pos == 0)					\
-				pos = wmi_ring_size - 1;		\
-			else						\
-				pos--;					\
-		}							\
-		outlen += seq_printf(m, "Length = %d\n", wmi_log->length);\
-		qdf_spin_unlock(&wmi_handle->log_info.wmi_record_lock);	\
-									\
-		return outlen;						\
+		return wmi_log_show(m,					\
+			&wmi_handle->log_info.wmi_##func_base##_buf_info,\
+			sizeof(struct wmi_event_debug), "Event ID",	\
+			wmi_ring_size);					\
 	}
 
 GENERATE_COMMAND_DEBUG_SHOW_FUNCS(command_log, wmi_display_size);
@@ -683,69 +919,584 @@ static int debug_wmi_enable_show(struct seq_file *m, void *v)
  *
  * Return: Length of characters printed
  */
-static int debug_wmi_log_size_show(struct seq_file *m, void *v)
+static int debug_wmi_log_size_show(struct seq_file *m, void *v)
+{
+
+	seq_printf(m, "WMI command/event log max size:%d\n", wmi_log_max_entry);
+	return seq_printf(m, "WMI management command/events log max size:%d\n",
+				wmi_mgmt_log_max_entry);
+}
+
+/**
+ * debug_wmi_cmd_latency_show() - debugfs functions to display the per
+ * command latency histograms.
+ *
+ * @m: debugfs handler to access wmi_handle
+ * @v: Variable arguments (not used)
+ *
+ * Each command sent since the last reset shows the number of samples
+ * and the p50, p99 and max latency in us from send to HTC tx completion
+ * and, for commands with a registered response, from send to response.
+ *
+ * Return: Length of characters printed
+ */
+static int debug_wmi_cmd_latency_show(struct seq_file *m, void *v)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) m->private;
+	struct wmi_cmd_lat_tbl *tbl = wmi_handle->cmd_lat;
+	struct wmi_cmd_lat *slot;
+	struct wmi_lat_hist *hist;
+	int i, outlen = 0;
+
+	if (!tbl)
+		return seq_printf(m, "command latency tracking disabled\n");
+
+	qdf_spin_lock_bh(&tbl->lock);
+	for (i = 0; i < WMI_CMD_LAT_SLOTS; i++) {
+		slot = &tbl->slots[i];
+		if (!slot->tx_cmp.count && !slot->resp.count)
+			continue;
+		hist = &slot->tx_cmp;
+		outlen += seq_printf(m,
+			"%s(0x%x) tx_cmp: n %u p50 %u p99 %u max %u",
+			wmi_id_to_name(slot->cmd_id), slot->cmd_id,
+			hist->count,
+			hist->count ? wmi_lat_hist_pct(hist, 50) : 0,
+			hist->count ? wmi_lat_hist_pct(hist, 99) : 0,
+			hist->max_us);
+		hist = &slot->resp;
+		if (hist->count)
+			outlen += seq_printf(m,
+				" resp: n %u p50 %u p99 %u max %u",
+				hist->count, wmi_lat_hist_pct(hist, 50),
+				wmi_lat_hist_pct(hist, 99), hist->max_us);
+		outlen += seq_printf(m, "\n");
+	}
+	outlen += seq_printf(m, "untracked %u\n", tbl->untracked);
+	qdf_spin_unlock_bh(&tbl->lock);
+
+	return outlen;
+}
+
+/**
+ * wmi_evt_capture_seq_chunk() - locate a chunk of the captured fw events
+ * @cap: event capture
+ * @pos: chunk index, 0 being the file header
+ *
+ * Return: SEQ_START_TOKEN for the file header, start of the chunk or
+ * NULL past the end
+ */
+static void *wmi_evt_capture_seq_chunk(struct wmi_evt_capture *cap,
+				       loff_t pos)
+{
+	loff_t off;
+
+	if (!pos)
+		return SEQ_START_TOKEN;
+
+	off = (pos - 1) * WMI_EVT_CAPTURE_CHUNK;
+	if (!cap->buf || off >= cap->used)
+		return NULL;
+
+	return cap->buf + off;
+}
+
+/**
+ * wmi_evt_capture_seq_start() - seq_file start for the event capture
+ * @m: debugfs handler to access wmi_handle
+ * @pos: chunk index
+ *
+ * Return: chunk at @pos
+ */
+static void *wmi_evt_capture_seq_start(struct seq_file *m, loff_t *pos)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) m->private;
+
+	return wmi_evt_capture_seq_chunk(&wmi_handle->evt_capture, *pos);
+}
+
+/**
+ * wmi_evt_capture_seq_next() - seq_file next for the event capture
+ * @m: debugfs handler to access wmi_handle
+ * @v: current chunk
+ * @pos: chunk index, advanced
+ *
+ * Return: chunk after @v
+ */
+static void *wmi_evt_capture_seq_next(struct seq_file *m, void *v,
+				      loff_t *pos)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) m->private;
+
+	++*pos;
+	return wmi_evt_capture_seq_chunk(&wmi_handle->evt_capture, *pos);
+}
+
+/**
+ * wmi_evt_capture_seq_stop() - seq_file stop for the event capture
+ * @m: debugfs handler to access wmi_handle
+ * @v: last chunk
+ *
+ * The capture is held busy from open to release, nothing to do here.
+ *
+ * Return: none
+ */
+static void wmi_evt_capture_seq_stop(struct seq_file *m, void *v)
+{
+}
+
+/**
+ * wmi_evt_capture_seq_show() - debugfs functions to read the captured
+ * fw events.
+ *
+ * @m: debugfs handler to access wmi_handle
+ * @v: chunk from wmi_evt_capture_seq_chunk()
+ *
+ * Output is binary, see struct wmi_evt_capture_file_hdr. It is written
+ * WMI_EVT_CAPTURE_CHUNK bytes at a time so that the seq_file buffer
+ * stays small whatever the capture size.
+ *
+ * Return: 0
+ */
+static int wmi_evt_capture_seq_show(struct seq_file *m, void *v)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) m->private;
+	struct wmi_evt_capture *cap = &wmi_handle->evt_capture;
+	struct wmi_evt_capture_file_hdr hdr = {
+		.magic = WMI_EVT_CAPTURE_MAGIC,
+		.version = WMI_EVT_CAPTURE_VERSION,
+	};
+	uint8_t *chunk = v;
+
+	if (v == SEQ_START_TOKEN)
+		seq_write(m, &hdr, sizeof(hdr));
+	else
+		seq_write(m, chunk, QDF_MIN(WMI_EVT_CAPTURE_CHUNK,
+					    (uint32_t)(cap->buf + cap->used -
+						       chunk)));
+
+	return 0;
+}
+
+static const struct seq_operations wmi_evt_capture_seq_ops = {
+	.start = wmi_evt_capture_seq_start,
+	.next = wmi_evt_capture_seq_next,
+	.stop = wmi_evt_capture_seq_stop,
+	.show = wmi_evt_capture_seq_show,
+};
+
+/**
+ * debug_wmi_evt_replay_show() - debugfs functions to display the capture
+ * state and the parse costs measured by the last replay.
+ *
+ * @m: debugfs handler to access wmi_handle
+ * @v: Variable arguments (not used)
+ *
+ * Return: Length of characters printed
+ */
+static int debug_wmi_evt_replay_show(struct seq_file *m, void *v)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) m->private;
+	struct wmi_evt_capture *cap = &wmi_handle->evt_capture;
+	struct wmi_evt_replay *rp = wmi_handle->evt_replay;
+	struct wmi_evt_replay_stat *stat;
+	uint32_t heap_allocs = 0, errors = 0;
+	uint64_t rate = 0;
+	int i, outlen = 0;
+
+	outlen += seq_printf(m,
+		"capture: active %d events %u bytes %u dropped %u\n",
+		cap->active, cap->events, cap->used, cap->dropped);
+	if (!rp || !rp->events)
+		return outlen + seq_printf(m, "no replay yet\n");
+
+	for (i = 0; i < WMI_EVT_REPLAY_SLOTS; i++) {
+		heap_allocs += rp->stats[i].heap_allocs;
+		errors += rp->stats[i].errors;
+	}
+	if (rp->elapsed_ns)
+		rate = div64_u64((uint64_t)rp->events * NSEC_PER_SEC,
+				 rp->elapsed_ns);
+	outlen += seq_printf(m,
+		"replay: loops %u handlers %s events %u elapsed %llu ns events/sec %llu heap allocs %u errors %u untracked %u\n",
+		rp->loops, rp->dispatch ? "registered" : "stub", rp->events,
+		rp->elapsed_ns, rate, heap_allocs, errors, rp->untracked);
+
+	for (i = 0; i < WMI_EVT_REPLAY_SLOTS; i++) {
+		stat = &rp->stats[i];
+		if (!stat->used)
+			continue;
+		outlen += seq_printf(m,
+			"Event ID = %x n %u avg %llu ns max %u ns handler avg %llu ns heap allocs %u errors %u\n",
+			stat->event_id, stat->count,
+			div64_u64(stat->total_ns, stat->count), stat->max_ns,
+			div64_u64(stat->handler_ns, stat->count),
+			stat->heap_allocs, stat->errors);
+	}
+
+	return outlen;
+}
+
+/**
+ * debug_wmi_pkt_pool_show() - debugfs functions to display usage of the
+ * command HTC packet pool.
+ *
+ * @m: debugfs handler to access wmi_handle
+ * @v: Variable arguments (not used)
+ *
+ * Return: Length of characters printed
+ */
+static int debug_wmi_pkt_pool_show(struct seq_file *m, void *v)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) m->private;
+	struct wmi_htc_pkt_pool *pool = &wmi_handle->pkt_pool;
+
+	seq_printf(m, "size:%d in use:%u max in use:%u\n",
+		   pool->pkts ? WMI_HTC_PKT_POOL_SIZE : 0,
+		   pool->in_use, pool->max_in_use);
+	return seq_printf(m, "exhausted:%u fallback alloc failed:%u\n",
+			  pool->exhausted, pool->fallback_fail);
+}
+
+/**
+ * debug_wmi_buf_pool_show() - debugfs functions to display usage of the
+ * command buffer pool.
+ *
+ * @m: debugfs handler to access wmi_handle
+ * @v: Variable arguments (not used)
+ *
+ * Return: 0
+ */
+static int debug_wmi_buf_pool_show(struct seq_file *m, void *v)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) m->private;
+	struct wmi_buf_pool *pool = &wmi_handle->buf_pool;
+	int i;
+
+	seq_printf(m, "enabled:%d\n", pool->enabled);
+	for (i = 0; i < WMI_BUF_POOL_CLASSES; i++)
+		seq_printf(m,
+			   "len:%4d idle:%2u hits:%u misses:%u recycled:%u dropped:%u\n",
+			   wmi_buf_pool_class_len[i],
+			   qdf_nbuf_queue_len(&pool->free[i]), pool->hits[i],
+			   pool->misses[i], pool->recycled[i],
+			   pool->dropped[i]);
+
+	return 0;
+}
+
+/**
+ * debug_wmi_rx_queues_show() - debugfs functions to display the worker
+ * queues of the rx event classes.
+ *
+ * @m: debugfs handler to access wmi_handle
+ * @v: Variable arguments (not used)
+ *
+ * Return: 0
+ */
+static int debug_wmi_rx_queues_show(struct seq_file *m, void *v)
+{
+	static const char * const names[WMI_RX_EVT_CLASS_MAX] = {
+		"high", "normal", "bulk"
+	};
+	wmi_unified_t wmi_handle = (wmi_unified_t) m->private;
+	struct wmi_rx_evt_queue *q;
+	int i, j;
+
+	seq_printf(m, "delay bins(us):");
+	for (j = 0; j < WMI_RX_DELAY_BINS - 1; j++)
+		seq_printf(m, " <%u", wmi_rx_delay_bin_us[j]);
+	seq_printf(m, " >=%u\n", wmi_rx_delay_bin_us[j - 1]);
+
+	for (i = 0; i < WMI_RX_EVT_CLASS_MAX; i++) {
+		q = &wmi_handle->evt_queues[i];
+		seq_printf(m, "%-6s depth:%u/%u max:%u drops:%u delay:",
+			   names[i], qdf_nbuf_queue_len(&q->queue),
+			   q->max_depth, q->max_seen, q->drops);
+		for (j = 0; j < WMI_RX_DELAY_BINS; j++)
+			seq_printf(m, " %u", q->delay_hist[j]);
+		seq_printf(m, "\n");
+	}
+
+	return 0;
+}
+
+/**
+ * debug_wmi_##func_base##_write() - debugfs functions to clear
+ * wmi logging command/event buffer and management command/event buffer.
+ *
+ * @file: file handler to access wmi_handle
+ * @buf: received data buffer
+ * @count: length of received buffer
+ * @ppos: Not used
+ *
+ * Return: count
+ */
+#define GENERATE_DEBUG_WRITE_FUNCS(func_base, wmi_record_type)		\
+	static ssize_t debug_wmi_##func_base##_write(struct file *file,	\
+				const char __user *buf,			\
+				size_t count, loff_t *ppos)		\
+	{								\
+		int k, ret;						\
+		wmi_unified_t wmi_handle = file->private_data;		\
+									\
+		ret = sscanf(buf, "%d", &k);				\
+		if ((ret != 1) || (k != 0)) {				\
+			qdf_print("Wrong input, echo 0 to clear the wmi	buffer\n");\
+			return -EINVAL;					\
+		}							\
+									\
+		wmi_log_clear(&wmi_handle->log_info.			\
+				wmi_##func_base##_buf_info,		\
+				sizeof(struct wmi_record_type));	\
+									\
+		return count;						\
+	}
+
+GENERATE_DEBUG_WRITE_FUNCS(command_log, wmi_command_debug);
+GENERATE_DEBUG_WRITE_FUNCS(command_tx_cmp_log, wmi_command_debug);
+GENERATE_DEBUG_WRITE_FUNCS(event_log, wmi_event_debug);
+GENERATE_DEBUG_WRITE_FUNCS(rx_event_log, wmi_event_debug);
+GENERATE_DEBUG_WRITE_FUNCS(mgmt_command_log, wmi_command_debug);
+GENERATE_DEBUG_WRITE_FUNCS(mgmt_command_tx_cmp_log, wmi_command_debug);
+GENERATE_DEBUG_WRITE_FUNCS(mgmt_event_log, wmi_event_debug);
+
+/**
+ * debug_wmi_enable_write() - debugfs functions to enable/disable
+ * wmi logging feature.
+ *
+ * @file: file handler to access wmi_handle
+ * @buf: received data buffer
+ * @count: length of received buffer
+ * @ppos: Not used
+ *
+ * Return: count
+ */
+static ssize_t debug_wmi_enable_write(struct file *file, const char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	wmi_unified_t wmi_handle =  file->private_data;
+	int k, ret;
+
+	ret = sscanf(buf, "%d", &k);
+	if ((ret != 1) || ((k != 0) && (k != 1)))
+		return -EINVAL;
+
+	wmi_handle->log_info.wmi_logging_enable = k;
+	return count;
+}
+
+/**
+ * debug_wmi_cmd_latency_write() - debugfs functions to clear the per
+ * command latency histograms.
+ *
+ * @file: file handler to access wmi_handle
+ * @buf: received data buffer
+ * @count: length of received buffer
+ * @ppos: Not used
+ *
+ * Registered request/response pairs are kept.
+ *
+ * Return: count
+ */
+static ssize_t debug_wmi_cmd_latency_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	wmi_unified_t wmi_handle = file->private_data;
+	struct wmi_cmd_lat_tbl *tbl = wmi_handle->cmd_lat;
+	struct wmi_cmd_lat *slot;
+	int k, ret, i;
+
+	ret = sscanf(buf, "%d", &k);
+	if ((ret != 1) || (k != 0)) {
+		qdf_print("Wrong input, echo 0 to clear the histograms\n");
+		return -EINVAL;
+	}
+
+	if (!tbl)
+		return count;
+
+	qdf_spin_lock_bh(&tbl->lock);
+	for (i = 0; i < WMI_CMD_LAT_SLOTS; i++) {
+		slot = &tbl->slots[i];
+		slot->resp_sent = 0;
+		qdf_mem_zero(&slot->tx_cmp, sizeof(slot->tx_cmp));
+		qdf_mem_zero(&slot->resp, sizeof(slot->resp));
+	}
+	tbl->untracked = 0;
+	qdf_spin_unlock_bh(&tbl->lock);
+
+	return count;
+}
+
+/**
+ * debug_wmi_evt_capture_write() - debugfs functions to start or stop
+ * capturing the received fw events.
+ *
+ * @file: file handler to access wmi_handle
+ * @buf: received data buffer
+ * @count: length of received buffer
+ * @ppos: Not used
+ *
+ * A size in bytes, at most WMI_EVT_CAPTURE_MAX_SIZE, discards the
+ * previous capture and starts a new one in a buffer of that size.
+ * 0 stops the capture and keeps what was captured.
+ *
+ * Return: count
+ */
+static ssize_t debug_wmi_evt_capture_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	wmi_unified_t wmi_handle = file->private_data;
+	struct wmi_evt_capture *cap = &wmi_handle->evt_capture;
+	uint8_t *new_buf = NULL, *old_buf;
+	int k, ret;
+
+	ret = sscanf(buf, "%d", &k);
+	if ((ret != 1) || (k < 0)) {
+		qdf_print("Wrong input, echo <bytes> to start capturing events, 0 to stop\n");
+		return -EINVAL;
+	}
+
+	if (k) {
+		new_buf = vmalloc(QDF_MIN(k, WMI_EVT_CAPTURE_MAX_SIZE));
+		if (!new_buf)
+			return -ENOMEM;
+	}
+
+	qdf_spin_lock_bh(&cap->lock);
+	if (!k) {
+		cap->active = false;
+		qdf_spin_unlock_bh(&cap->lock);
+		return count;
+	}
+	if (cap->busy) {
+		qdf_spin_unlock_bh(&cap->lock);
+		vfree(new_buf);
+		return -EBUSY;
+	}
+	old_buf = cap->buf;
+	cap->buf = new_buf;
+	cap->size = QDF_MIN(k, WMI_EVT_CAPTURE_MAX_SIZE);
+	cap->used = 0;
+	cap->events = 0;
+	cap->dropped = 0;
+	cap->max_len = 0;
+	cap->active = true;
+	qdf_spin_unlock_bh(&cap->lock);
+
+	vfree(old_buf);
+
+	return count;
+}
+
+/**
+ * debug_wmi_evt_replay_write() - debugfs functions to replay the captured
+ * fw events through the TLV parser.
+ *
+ * @file: file handler to access wmi_handle
+ * @buf: received data buffer
+ * @count: length of received buffer
+ * @ppos: Not used
+ *
+ * Takes the number of passes over the capture, optionally followed by 1
+ * to call the registered event handlers instead of a stub.
+ *
+ * Return: count
+ */
+static ssize_t debug_wmi_evt_replay_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	wmi_unified_t wmi_handle = file->private_data;
+	int k, dispatch = 0, ret;
+
+	ret = sscanf(buf, "%d %d", &k, &dispatch);
+	if ((ret < 1) || (k <= 0)) {
+		qdf_print("Wrong input, echo <passes> [1] to replay the captured events\n");
+		return -EINVAL;
+	}
+
+	ret = wmi_evt_replay_run(wmi_handle, k, dispatch == 1);
+	if (ret)
+		return ret;
+
+	return count;
+}
+
+/**
+ * debug_wmi_pkt_pool_write() - debugfs functions to clear the command
+ * HTC packet pool counters.
+ *
+ * @file: file handler to access wmi_handle
+ * @buf: received data buffer
+ * @count: length of received buffer
+ * @ppos: Not used
+ *
+ * Return: count
+ */
+static ssize_t debug_wmi_pkt_pool_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
 {
+	wmi_unified_t wmi_handle = file->private_data;
+	struct wmi_htc_pkt_pool *pool = &wmi_handle->pkt_pool;
+	int k, ret;
 
-	seq_printf(m, "WMI command/event log max size:%d\n", wmi_log_max_entry);
-	return seq_printf(m, "WMI management command/events log max size:%d\n",
-				wmi_mgmt_log_max_entry);
+	ret = sscanf(buf, "%d", &k);
+	if ((ret != 1) || (k != 0)) {
+		qdf_print("Wrong input, echo 0 to clear the counters\n");
+		return -EINVAL;
+	}
+
+	qdf_spin_lock_bh(&pool->lock);
+	pool->max_in_use = pool->in_use;
+	pool->exhausted = 0;
+	pool->fallback_fail = 0;
+	qdf_spin_unlock_bh(&pool->lock);
+
+	return count;
 }
 
 /**
- * debug_wmi_##func_base##_write() - debugfs functions to clear
- * wmi logging command/event buffer and management command/event buffer.
+ * debug_wmi_buf_pool_write() - debugfs functions to enable/disable the
+ * command buffer pool.
  *
  * @file: file handler to access wmi_handle
  * @buf: received data buffer
  * @count: length of received buffer
  * @ppos: Not used
  *
+ * Disabling the pool frees its idle buffers and clears the counters.
+ *
  * Return: count
  */
-#define GENERATE_DEBUG_WRITE_FUNCS(func_base, wmi_ring_size, wmi_record_type)\
-	static ssize_t debug_wmi_##func_base##_write(struct file *file,	\
-				const char __user *buf,			\
-				size_t count, loff_t *ppos)		\
-	{								\
-		int k, ret;						\
-		wmi_unified_t wmi_handle = file->private_data;		\
-		struct wmi_log_buf_t *wmi_log = &wmi_handle->log_info.	\
-				wmi_##func_base##_buf_info;		\
-									\
-		ret = sscanf(buf, "%d", &k);				\
-		if ((ret != 1) || (k != 0)) {				\
-			qdf_print("Wrong input, echo 0 to clear the wmi	buffer\n");\
-			return -EINVAL;					\
-		}							\
-									\
-		qdf_spin_lock(&wmi_handle->log_info.wmi_record_lock);	\
-		qdf_mem_zero(wmi_log->buf, wmi_ring_size *		\
-				sizeof(struct wmi_record_type));	\
-		wmi_log->length = 0;					\
-		*(wmi_log->p_buf_tail_idx) = 0;				\
-		qdf_spin_unlock(&wmi_handle->log_info.wmi_record_lock);	\
-									\
-		return count;						\
+static ssize_t debug_wmi_buf_pool_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	wmi_unified_t wmi_handle = file->private_data;
+	struct wmi_buf_pool *pool = &wmi_handle->buf_pool;
+	int k, ret;
+
+	ret = sscanf(buf, "%d", &k);
+	if ((ret != 1) || ((k != 0) && (k != 1)))
+		return -EINVAL;
+
+	pool->enabled = k;
+	if (!k) {
+		wmi_buf_pool_drain(pool);
+		qdf_spin_lock_bh(&pool->lock);
+		qdf_mem_zero(pool->hits, sizeof(pool->hits));
+		qdf_mem_zero(pool->misses, sizeof(pool->misses));
+		qdf_mem_zero(pool->recycled, sizeof(pool->recycled));
+		qdf_mem_zero(pool->dropped, sizeof(pool->dropped));
+		qdf_spin_unlock_bh(&pool->lock);
 	}
 
-GENERATE_DEBUG_WRITE_FUNCS(command_log, wmi_log_max_entry,
-					wmi_command_debug);
-GENERATE_DEBUG_WRITE_FUNCS(command_tx_cmp_log, wmi_log_max_entry,
-					wmi_command_debug);
-GENERATE_DEBUG_WRITE_FUNCS(event_log, wmi_log_max_entry,
-					wmi_event_debug);
-GENERATE_DEBUG_WRITE_FUNCS(rx_event_log, wmi_log_max_entry,
-					wmi_event_debug);
-GENERATE_DEBUG_WRITE_FUNCS(mgmt_command_log, wmi_mgmt_log_max_entry,
-					wmi_command_debug);
-GENERATE_DEBUG_WRITE_FUNCS(mgmt_command_tx_cmp_log,
-		wmi_mgmt_log_max_entry, wmi_command_debug);
-GENERATE_DEBUG_WRITE_FUNCS(mgmt_event_log, wmi_mgmt_log_max_entry,
-					wmi_event_debug);
+	return count;
+}
 
 /**
- * debug_wmi_enable_write() - debugfs functions to enable/disable
- * wmi logging feature.
+ * debug_wmi_rx_queues_write() - debugfs functions to clear the rx event
+ * class queue statistics.
  *
  * @file: file handler to access wmi_handle
  * @buf: received data buffer
@@ -754,17 +1505,28 @@ GENERATE_DEBUG_WRITE_FUNCS(mgmt_event_log, wmi_mgmt_log_max_entry,
  *
  * Return: count
  */
-static ssize_t debug_wmi_enable_write(struct file *file, const char __user *buf,
-					size_t count, loff_t *ppos)
+static ssize_t debug_wmi_rx_queues_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
 {
-	wmi_unified_t wmi_handle =  file->private_data;
-	int k, ret;
+	wmi_unified_t wmi_handle = file->private_data;
+	struct wmi_rx_evt_queue *q;
+	int i, k, ret;
 
 	ret = sscanf(buf, "%d", &k);
-	if ((ret != 1) || ((k != 0) && (k != 1)))
+	if ((ret != 1) || (k != 0)) {
+		qdf_print("Wrong input, echo 0 to clear the statistics\n");
 		return -EINVAL;
+	}
+
+	qdf_spin_lock_bh(&wmi_handle->eventq_lock);
+	for (i = 0; i < WMI_RX_EVT_CLASS_MAX; i++) {
+		q = &wmi_handle->evt_queues[i];
+		q->max_seen = qdf_nbuf_queue_len(&q->queue);
+		q->drops = 0;
+		qdf_mem_zero(q->delay_hist, sizeof(q->delay_hist));
+	}
+	qdf_spin_unlock_bh(&wmi_handle->eventq_lock);
 
-	wmi_handle->log_info.wmi_logging_enable = k;
 	return count;
 }
 
@@ -829,6 +1591,86 @@ GENERATE_DEBUG_STRUCTS(wmi_mgmt_command_tx_cmp_log);
 GENERATE_DEBUG_STRUCTS(wmi_mgmt_event_log);
 GENERATE_DEBUG_STRUCTS(wmi_enable);
 GENERATE_DEBUG_STRUCTS(wmi_log_size);
+GENERATE_DEBUG_STRUCTS(wmi_pkt_pool);
+GENERATE_DEBUG_STRUCTS(wmi_buf_pool);
+GENERATE_DEBUG_STRUCTS(wmi_rx_queues);
+GENERATE_DEBUG_STRUCTS(wmi_cmd_latency);
+GENERATE_DEBUG_STRUCTS(wmi_evt_replay);
+
+/**
+ * debug_wmi_evt_capture_open() - Open debugfs entry for the event capture
+ *
+ * @inode: node for debug dir entry
+ * @file: file handler
+ *
+ * Readers keep the capture busy until they close it, so that the buffer
+ * is neither replaced nor replayed under them. The capture must be
+ * stopped first.
+ *
+ * Return: open status, -EBUSY while capturing or busy
+ */
+static int debug_wmi_evt_capture_open(struct inode *inode, struct file *file)
+{
+	wmi_unified_t wmi_handle = inode->i_private;
+	struct wmi_evt_capture *cap = &wmi_handle->evt_capture;
+	int ret = 0;
+
+	if (file->f_mode & FMODE_READ) {
+		qdf_spin_lock_bh(&cap->lock);
+		if (cap->active || cap->busy)
+			ret = -EBUSY;
+		else
+			cap->busy = true;
+		qdf_spin_unlock_bh(&cap->lock);
+		if (ret)
+			return ret;
+	}
+
+	ret = seq_open(file, &wmi_evt_capture_seq_ops);
+	if (ret) {
+		if (file->f_mode & FMODE_READ) {
+			qdf_spin_lock_bh(&cap->lock);
+			cap->busy = false;
+			qdf_spin_unlock_bh(&cap->lock);
+		}
+		return ret;
+	}
+	((struct seq_file *)file->private_data)->private = wmi_handle;
+
+	return 0;
+}
+
+/**
+ * debug_wmi_evt_capture_release() - Release debugfs entry for the event
+ * capture
+ *
+ * @inode: node for debug dir entry
+ * @file: file handler
+ *
+ * Return: release status
+ */
+static int debug_wmi_evt_capture_release(struct inode *inode,
+					 struct file *file)
+{
+	wmi_unified_t wmi_handle = inode->i_private;
+	struct wmi_evt_capture *cap = &wmi_handle->evt_capture;
+
+	if (file->f_mode & FMODE_READ) {
+		qdf_spin_lock_bh(&cap->lock);
+		cap->busy = false;
+		qdf_spin_unlock_bh(&cap->lock);
+	}
+
+	return seq_release(inode, file);
+}
+
+static struct file_operations debug_wmi_evt_capture_ops = {
+	.open		= debug_wmi_evt_capture_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.write		= debug_wmi_evt_capture_write,
+	.release	= debug_wmi_evt_capture_release,
+};
 
 struct wmi_debugfs_info wmi_debugfs_infos[] = {
 	DEBUG_FOO(wmi_command_log),
@@ -840,6 +1682,12 @@ struct wmi_debugfs_info wmi_debugfs_infos[] = {
 	DEBUG_FOO(wmi_mgmt_event_log),
 	DEBUG_FOO(wmi_enable),
 	DEBUG_FOO(wmi_log_size),
+	DEBUG_FOO(wmi_pkt_pool),
+	DEBUG_FOO(wmi_buf_pool),
+	DEBUG_FOO(wmi_rx_queues),
+	DEBUG_FOO(wmi_cmd_latency),
+	DEBUG_FOO(wmi_evt_capture),
+	DEBUG_FOO(wmi_evt_replay),
 };
 
 #define NUM_DEBUG_INFOS (sizeof(wmi_debugfs_infos) /			\
@@ -951,14 +1799,10 @@ static QDF_STATUS wmi_debugfs_init(wmi_unified_t wmi_handle)
 void wmi_mgmt_cmd_record(wmi_unified_t wmi_handle, uint32_t cmd,
 			void *header, uint32_t vdev_id, uint32_t chanfreq)
 {
-	qdf_spin_lock_bh(&wmi_handle->log_info.wmi_record_lock);
-
-	WMI_MGMT_COMMAND_RECORD(cmd,
+	WMI_MGMT_COMMAND_RECORD(wmi_handle, cmd,
 				((struct wmi_command_header *)header)->type,
 				((struct wmi_command_header *)header)->sub_type,
 				vdev_id, chanfreq);
-
-	qdf_spin_unlock_bh(&wmi_handle->log_info.wmi_record_lock);
 }
 #else
 /**
@@ -982,15 +1826,21 @@ wmi_buf_t
 wmi_buf_alloc_debug(wmi_unified_t wmi_handle, uint16_t len, uint8_t *file_name,
 			uint32_t line_num)
 {
-	wmi_buf_t wmi_buf;
+	wmi_buf_t wmi_buf = NULL;
+	uint16_t alloc_len;
+	int class;
 
 	if (roundup(len + WMI_MIN_HEAD_ROOM, 4) > wmi_handle->max_msg_len) {
 		QDF_ASSERT(0);
 		return NULL;
 	}
 
-	wmi_buf = qdf_nbuf_alloc_debug(NULL,
-					roundup(len + WMI_MIN_HEAD_ROOM, 4),
+	alloc_len = wmi_buf_pool_class(wmi_handle, len, &class);
+	if (class >= 0)
+		wmi_buf = wmi_buf_pool_get(wmi_handle, class);
+	if (!wmi_buf)
+		wmi_buf = qdf_nbuf_alloc_debug(NULL,
+					roundup(alloc_len + WMI_MIN_HEAD_ROOM, 4),
 					WMI_MIN_HEAD_ROOM, 4, false, file_name,
 					line_num);
 
@@ -1015,15 +1865,22 @@ void wmi_buf_free(wmi_buf_t net_buf)
 #else
 wmi_buf_t wmi_buf_alloc(wmi_unified_t wmi_handle, uint16_t len)
 {
-	wmi_buf_t wmi_buf;
+	wmi_buf_t wmi_buf = NULL;
+	uint16_t alloc_len;
+	int class;
 
 	if (roundup(len + WMI_MIN_HEAD_ROOM, 4) > wmi_handle->max_msg_len) {
 		QDF_ASSERT(0);
 		return NULL;
 	}
 
-	wmi_buf = qdf_nbuf_alloc(NULL, roundup(len + WMI_MIN_HEAD_ROOM, 4),
-				WMI_MIN_HEAD_ROOM, 4, false);
+	alloc_len = wmi_buf_pool_class(wmi_handle, len, &class);
+	if (class >= 0)
+		wmi_buf = wmi_buf_pool_get(wmi_handle, class);
+	if (!wmi_buf)
+		wmi_buf = qdf_nbuf_alloc(NULL,
+					roundup(alloc_len + WMI_MIN_HEAD_ROOM, 4),
+					WMI_MIN_HEAD_ROOM, 4, false);
 	if (!wmi_buf)
 		return NULL;
 
@@ -1654,73 +2511,440 @@ static uint8_t *wmi_id_to_name(uint32_t wmi_command)
 
 
 /**
- * wmi_is_runtime_pm_cmd() - check if a cmd is from suspend resume sequence
- * @cmd: command to check
+ * wmi_is_runtime_pm_cmd() - check if a cmd is from suspend resume sequence
+ * @cmd: command to check
+ *
+ * Return: true if the command is part of the suspend resume sequence.
+ */
+#ifndef WMI_NON_TLV_SUPPORT
+static bool wmi_is_runtime_pm_cmd(uint32_t cmd_id)
+{
+	switch (cmd_id) {
+	case WMI_WOW_ENABLE_CMDID:
+	case WMI_PDEV_SUSPEND_CMDID:
+	case WMI_WOW_ENABLE_DISABLE_WAKE_EVENT_CMDID:
+	case WMI_WOW_ADD_WAKE_PATTERN_CMDID:
+	case WMI_WOW_HOSTWAKEUP_FROM_SLEEP_CMDID:
+	case WMI_PDEV_RESUME_CMDID:
+	case WMI_WOW_DEL_WAKE_PATTERN_CMDID:
+	case WMI_D0_WOW_ENABLE_DISABLE_CMDID:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * wmi_is_pm_resume_cmd() - check if a cmd is part of the resume sequence
+ * @cmd_id: command to check
+ *
+ * Return: true if the command is part of the resume sequence.
+ */
+static bool wmi_is_pm_resume_cmd(uint32_t cmd_id)
+{
+	switch (cmd_id) {
+	case WMI_WOW_HOSTWAKEUP_FROM_SLEEP_CMDID:
+	case WMI_PDEV_RESUME_CMDID:
+		return true;
+
+	default:
+		return false;
+	}
+}
+#else
+static bool wmi_is_runtime_pm_cmd(uint32_t cmd_id)
+{
+	return false;
+}
+static bool wmi_is_pm_resume_cmd(uint32_t cmd_id)
+{
+	return false;
+}
+#endif
+
+/**
+ * wmi_htc_pkt_pool_init() - set up the command HTC packet pool
+ * @wmi_handle: handle to wmi
+ *
+ * The pool is optional, commands fall back to heap allocated packets
+ * when it could not be allocated or runs empty.
+ *
+ * Return: none
+ */
+static void wmi_htc_pkt_pool_init(struct wmi_unified *wmi_handle)
+{
+	struct wmi_htc_pkt_pool *pool = &wmi_handle->pkt_pool;
+	int i;
+
+	qdf_spinlock_create(&pool->lock);
+	pool->pkts = qdf_mem_malloc(WMI_HTC_PKT_POOL_SIZE *
+				    sizeof(*pool->pkts));
+	if (!pool->pkts) {
+		QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_ERROR,
+			  "%s: no memory for htc packet pool", __func__);
+		return;
+	}
+
+	for (i = 0; i < WMI_HTC_PKT_POOL_SIZE; i++) {
+		pool->pkts[i].ListLink.pNext = (DL_LIST *)pool->free_list;
+		pool->free_list = &pool->pkts[i];
+	}
+}
+
+/**
+ * wmi_htc_pkt_pool_in_use() - count pool packets still held by HTC
+ * @pool: command HTC packet pool
+ *
+ * Return: number of pool packets not yet completed
+ */
+static uint32_t wmi_htc_pkt_pool_in_use(struct wmi_htc_pkt_pool *pool)
+{
+	uint32_t in_use;
+
+	qdf_spin_lock_bh(&pool->lock);
+	in_use = pool->in_use;
+	qdf_spin_unlock_bh(&pool->lock);
+
+	return in_use;
+}
+
+/**
+ * wmi_htc_pkt_pool_deinit() - free the command HTC packet pool
+ * @wmi_handle: handle to wmi
+ *
+ * Waits up to WMI_HTC_PKT_POOL_DRAIN_MS for HTC to complete the commands
+ * it still holds. If packets are still out after that the pool is leaked,
+ * since a late completion would return its packet into freed memory.
+ *
+ * Return: none
+ */
+static void wmi_htc_pkt_pool_deinit(struct wmi_unified *wmi_handle)
+{
+	struct wmi_htc_pkt_pool *pool = &wmi_handle->pkt_pool;
+	uint32_t waited = 0;
+
+	while (pool->pkts && wmi_htc_pkt_pool_in_use(pool) &&
+	       waited < WMI_HTC_PKT_POOL_DRAIN_MS) {
+		qdf_sleep(10);
+		waited += 10;
+	}
+
+	if (pool->pkts && wmi_htc_pkt_pool_in_use(pool)) {
+		QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_ERROR,
+			  "%s: %u htc packets still in use, pool leaked",
+			  __func__, wmi_htc_pkt_pool_in_use(pool));
+		return;
+	}
+
+	if (pool->pkts)
+		qdf_mem_free(pool->pkts);
+	pool->pkts = NULL;
+	pool->free_list = NULL;
+	qdf_spinlock_destroy(&pool->lock);
+}
+
+/**
+ * wmi_htc_pkt_alloc() - get an HTC packet container for a command
+ * @wmi_handle: handle to wmi
+ *
+ * Return: zeroed packet, NULL if the pool is empty and the heap
+ * fallback failed
+ */
+static HTC_PACKET *wmi_htc_pkt_alloc(struct wmi_unified *wmi_handle)
+{
+	struct wmi_htc_pkt_pool *pool = &wmi_handle->pkt_pool;
+	HTC_PACKET *pkt;
+
+	qdf_spin_lock_bh(&pool->lock);
+	pkt = pool->free_list;
+	if (pkt) {
+		pool->free_list = (HTC_PACKET *)pkt->ListLink.pNext;
+		if (++pool->in_use > pool->max_in_use)
+			pool->max_in_use = pool->in_use;
+	} else {
+		pool->exhausted++;
+	}
+	qdf_spin_unlock_bh(&pool->lock);
+
+	if (pkt) {
+		qdf_mem_zero(pkt, sizeof(*pkt));
+		return pkt;
+	}
+
+	pkt = qdf_mem_malloc(sizeof(*pkt));
+	if (!pkt) {
+		qdf_spin_lock_bh(&pool->lock);
+		pool->fallback_fail++;
+		qdf_spin_unlock_bh(&pool->lock);
+	}
+
+	return pkt;
+}
+
+/**
+ * wmi_htc_pkt_free() - release an HTC packet container
+ * @wmi_handle: handle to wmi
+ * @pkt: packet from wmi_htc_pkt_alloc()
+ *
+ * Return: none
+ */
+static void wmi_htc_pkt_free(struct wmi_unified *wmi_handle, HTC_PACKET *pkt)
+{
+	struct wmi_htc_pkt_pool *pool = &wmi_handle->pkt_pool;
+
+	if (!pool->pkts || pkt < pool->pkts ||
+	    pkt >= pool->pkts + WMI_HTC_PKT_POOL_SIZE) {
+		qdf_mem_free(pkt);
+		return;
+	}
+
+	qdf_spin_lock_bh(&pool->lock);
+	pkt->ListLink.pNext = (DL_LIST *)pool->free_list;
+	pool->free_list = pkt;
+	pool->in_use--;
+	qdf_spin_unlock_bh(&pool->lock);
+}
+
+/**
+ * wmi_evt_capture() - append a received fw event to the event capture
+ * @wmi_handle: handle to wmi
+ * @evt_buf: fw event buffer, still starting with the WMI header
+ *
+ * Events that do not fit in the capture buffer are dropped, so the
+ * capture holds the start of the event stream.
+ *
+ * Return: none
+ */
+static inline void wmi_evt_capture(struct wmi_unified *wmi_handle,
+				   wmi_buf_t evt_buf)
+{
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+	struct wmi_evt_capture *cap = &wmi_handle->evt_capture;
+	struct wmi_evt_capture_rec *rec;
+	uint32_t len, need;
+
+	if (!cap->active)
+		return;
+
+	len = qdf_nbuf_len(evt_buf);
+	need = sizeof(*rec) + wmi_align(len);
+
+	qdf_spin_lock_bh(&cap->lock);
+	if (!cap->active) {
+		qdf_spin_unlock_bh(&cap->lock);
+		return;
+	}
+	if (cap->size - cap->used < need) {
+		cap->dropped++;
+		qdf_spin_unlock_bh(&cap->lock);
+		return;
+	}
+	rec = (struct wmi_evt_capture_rec *)(cap->buf + cap->used);
+	rec->ts_us = qdf_get_monotonic_boottime();
+	rec->len = len;
+	rec->reserved = 0;
+	qdf_mem_copy(rec + 1, qdf_nbuf_data(evt_buf), len);
+	cap->used += need;
+	cap->events++;
+	if (len > cap->max_len)
+		cap->max_len = len;
+	qdf_spin_unlock_bh(&cap->lock);
+#endif
+}
+
+/**
+ * wmi_cmd_lat_now() - timestamp for the command latency histograms
+ *
+ * Return: time in us, truncated to unsigned long; 0 if latencies are
+ * not tracked
+ */
+static inline unsigned long wmi_cmd_lat_now(void)
+{
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+	return (unsigned long)qdf_get_monotonic_boottime();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * wmi_cmd_lat_sent() - note the send of a command awaiting a response
+ * @wmi_handle: handle to wmi
+ * @cmd_id: wmi command id
+ * @sent: send time from wmi_cmd_lat_now()
+ *
+ * Only the oldest unanswered send of a command is timed.
+ *
+ * Return: none
+ */
+static inline void wmi_cmd_lat_sent(struct wmi_unified *wmi_handle,
+				    uint32_t cmd_id, unsigned long sent)
+{
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+	struct wmi_cmd_lat_tbl *tbl = wmi_handle->cmd_lat;
+	struct wmi_cmd_lat *slot;
+
+	if (!tbl || !tbl->num_resp || !sent)
+		return;
+
+	qdf_spin_lock_bh(&tbl->lock);
+	slot = wmi_cmd_lat_slot(tbl, cmd_id, false);
+	if (slot && slot->track_resp && !slot->resp_sent)
+		slot->resp_sent = sent;
+	qdf_spin_unlock_bh(&tbl->lock);
+#endif
+}
+
+/**
+ * wmi_cmd_lat_tx_cmp() - time a command from send to HTC tx completion
+ * @wmi_handle: handle to wmi
+ * @buf: completed wmi buf
+ * @pkt: HTC packet of @buf, its context holds the send time
  *
- * Return: true if the command is part of the suspend resume sequence.
+ * Return: none
  */
-#ifndef WMI_NON_TLV_SUPPORT
-static bool wmi_is_runtime_pm_cmd(uint32_t cmd_id)
+static inline void wmi_cmd_lat_tx_cmp(struct wmi_unified *wmi_handle,
+				      wmi_buf_t buf, HTC_PACKET *pkt)
 {
-	switch (cmd_id) {
-	case WMI_WOW_ENABLE_CMDID:
-	case WMI_PDEV_SUSPEND_CMDID:
-	case WMI_WOW_ENABLE_DISABLE_WAKE_EVENT_CMDID:
-	case WMI_WOW_ADD_WAKE_PATTERN_CMDID:
-	case WMI_WOW_HOSTWAKEUP_FROM_SLEEP_CMDID:
-	case WMI_PDEV_RESUME_CMDID:
-	case WMI_WOW_DEL_WAKE_PATTERN_CMDID:
-	case WMI_D0_WOW_ENABLE_DISABLE_CMDID:
-		return true;
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+	struct wmi_cmd_lat_tbl *tbl = wmi_handle->cmd_lat;
+	struct wmi_cmd_lat *slot;
+	unsigned long sent = (unsigned long)pkt->pPktContext;
+	uint32_t us, cmd_id;
 
-	default:
-		return false;
-	}
+	if (!tbl || !sent)
+		return;
+
+	us = wmi_cmd_lat_now() - sent;
+	cmd_id = WMI_GET_FIELD(qdf_nbuf_data(buf), WMI_CMD_HDR, COMMANDID);
+
+	qdf_spin_lock_bh(&tbl->lock);
+	slot = wmi_cmd_lat_slot(tbl, cmd_id, true);
+	if (slot)
+		wmi_lat_hist_add(&slot->tx_cmp, us);
+	else
+		tbl->untracked++;
+	qdf_spin_unlock_bh(&tbl->lock);
+#endif
 }
 
 /**
- * wmi_is_pm_resume_cmd() - check if a cmd is part of the resume sequence
- * @cmd_id: command to check
+ * wmi_cmd_lat_event() - time the commands answered by a fw event
+ * @wmi_handle: handle to wmi
+ * @evt_buf: fw event buffer, still starting with the WMI header
  *
- * Return: true if the command is part of the resume sequence.
+ * Return: none
  */
-static bool wmi_is_pm_resume_cmd(uint32_t cmd_id)
+static inline void wmi_cmd_lat_event(struct wmi_unified *wmi_handle,
+				     wmi_buf_t evt_buf)
 {
-	switch (cmd_id) {
-	case WMI_WOW_HOSTWAKEUP_FROM_SLEEP_CMDID:
-	case WMI_PDEV_RESUME_CMDID:
-		return true;
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+	struct wmi_cmd_lat_tbl *tbl = wmi_handle->cmd_lat;
+	struct wmi_cmd_lat *slot;
+	unsigned long now;
+	uint32_t id, i;
 
-	default:
-		return false;
+	if (!tbl || !tbl->num_resp)
+		return;
+
+	id = WMI_GET_FIELD(qdf_nbuf_data(evt_buf), WMI_CMD_HDR, COMMANDID);
+	now = wmi_cmd_lat_now();
+
+	qdf_spin_lock_bh(&tbl->lock);
+	for (i = 0; i < tbl->num_resp; i++) {
+		if (tbl->resp[i].event_id != id)
+			continue;
+		slot = &tbl->slots[tbl->resp[i].slot];
+		if (!slot->resp_sent)
+			continue;
+		wmi_lat_hist_add(&slot->resp, now - slot->resp_sent);
+		slot->resp_sent = 0;
 	}
+	qdf_spin_unlock_bh(&tbl->lock);
+#endif
 }
-#else
-static bool wmi_is_runtime_pm_cmd(uint32_t cmd_id)
+
+/**
+ * struct wmi_cmd_sent_info - what is recorded once HTC takes a command
+ * @cmd_id: wmi command id
+ * @log: whether the command goes to the command log
+ * @data: command payload kept for the command log
+ *
+ * HTC may complete and free the command buffer as soon as it has taken
+ * it, so the payload for the log is copied before the send.
+ */
+struct wmi_cmd_sent_info {
+	uint32_t cmd_id;
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+	bool log;
+	uint32_t data[WMI_EVENT_DEBUG_ENTRY_MAX_LENGTH / sizeof(uint32_t)];
+#endif
+};
+
+/**
+ * wmi_unified_cmd_unprepare() - undo wmi_unified_cmd_prepare()
+ * @wmi_handle: handle to wmi
+ * @pkt: HTC packet HTC did not take
+ *
+ * The command buffer is left to the caller as it was passed in.
+ *
+ * Return: none
+ */
+static void wmi_unified_cmd_unprepare(wmi_unified_t wmi_handle,
+				      HTC_PACKET *pkt)
 {
-	return false;
+	wmi_buf_t buf = GET_HTC_PACKET_NET_BUF_CONTEXT(pkt);
+
+	qdf_atomic_dec(&wmi_handle->pending_cmds);
+	qdf_nbuf_pull_head(buf, sizeof(WMI_CMD_HDR));
+	wmi_htc_pkt_free(wmi_handle, pkt);
 }
-static bool wmi_is_pm_resume_cmd(uint32_t cmd_id)
+
+/**
+ * wmi_unified_cmd_sent() - account a command HTC has taken
+ * @wmi_handle: handle to wmi
+ * @info: filled in by wmi_unified_cmd_prepare()
+ *
+ * Return: none
+ */
+static void wmi_unified_cmd_sent(wmi_unified_t wmi_handle,
+				 struct wmi_cmd_sent_info *info)
 {
-	return false;
-}
+#ifndef WMI_NON_TLV_SUPPORT
+	wma_log_cmd_id(info->cmd_id);
+#endif
+
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+	if (info->log)
+		WMI_COMMAND_RECORD(wmi_handle, info->cmd_id, info->data);
 #endif
+}
 
 /**
- * wmi_unified_cmd_send() - WMI command API
+ * wmi_unified_cmd_prepare() - check a command and set up its HTC packet
  * @wmi_handle: handle to wmi
  * @buf: wmi buf
  * @len: wmi buffer length
  * @cmd_id: wmi command id
+ * @htc_pkt: returns the HTC packet carrying @buf
+ * @info: returns what wmi_unified_cmd_sent() records
+ *
+ * On success the command is counted as pending. Once HTC has taken
+ * @htc_pkt the caller records it with wmi_unified_cmd_sent(), if HTC
+ * does not take it the caller undoes this with
+ * wmi_unified_cmd_unprepare().
  *
  * Return: 0 on success
  */
-int wmi_unified_cmd_send(wmi_unified_t wmi_handle, wmi_buf_t buf, uint32_t len,
-			 uint32_t cmd_id)
+static int wmi_unified_cmd_prepare(wmi_unified_t wmi_handle, wmi_buf_t buf,
+				   uint32_t len, uint32_t cmd_id,
+				   HTC_PACKET **htc_pkt,
+				   struct wmi_cmd_sent_info *info)
 {
 	HTC_PACKET *pkt;
-	A_STATUS status;
 	uint16_t htc_tag = 0;
+	unsigned long sent;
 
 	if (wmi_get_runtime_pm_inprogress(wmi_handle)) {
 		if (wmi_is_runtime_pm_cmd(cmd_id))
@@ -1772,40 +2996,68 @@ int wmi_unified_cmd_send(wmi_unified_t wmi_handle, wmi_buf_t buf, uint32_t len,
 		QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_ERROR,
 		    "%s: MAX 1024 WMI Pending cmds reached.", __func__);
 		QDF_BUG(0);
+		qdf_nbuf_pull_head(buf, sizeof(WMI_CMD_HDR));
 		return QDF_STATUS_E_BUSY;
 	}
 
-	pkt = qdf_mem_malloc(sizeof(*pkt));
+	pkt = wmi_htc_pkt_alloc(wmi_handle);
 	if (!pkt) {
 		qdf_atomic_dec(&wmi_handle->pending_cmds);
+		qdf_nbuf_pull_head(buf, sizeof(WMI_CMD_HDR));
 		QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_ERROR,
 			 "%s, Failed to alloc htc packet %x, no memory",
 			 __func__, cmd_id);
 		return QDF_STATUS_E_NOMEM;
 	}
 
+	/* the packet context carries the send time for the latency stats */
+	sent = wmi_cmd_lat_now();
 	SET_HTC_PACKET_INFO_TX(pkt,
-			       NULL,
+			       (void *)sent,
 			       qdf_nbuf_data(buf), len + sizeof(WMI_CMD_HDR),
 			       wmi_handle->wmi_endpoint_id, htc_tag);
+	wmi_cmd_lat_sent(wmi_handle, cmd_id, sent);
 
 	SET_HTC_PACKET_NET_BUF_CONTEXT(pkt, buf);
-#ifndef WMI_NON_TLV_SUPPORT
-	wma_log_cmd_id(cmd_id);
-#endif
 
+	info->cmd_id = cmd_id;
 #ifdef WMI_INTERFACE_EVENT_LOGGING
-	if (wmi_handle->log_info.wmi_logging_enable) {
-		qdf_spin_lock_bh(&wmi_handle->log_info.wmi_record_lock);
-		if (!wmi_handle->log_info.is_management_record(cmd_id)) {
-			WMI_COMMAND_RECORD(wmi_handle, cmd_id,
-			((uint32_t *) qdf_nbuf_data(buf) +
-			 wmi_handle->log_info.buf_offset_command));
-		}
-		qdf_spin_unlock_bh(&wmi_handle->log_info.wmi_record_lock);
+	info->log = false;
+	if (wmi_handle->log_info.wmi_logging_enable &&
+	    !wmi_handle->log_info.is_management_record(cmd_id)) {
+		info->log = true;
+		qdf_mem_copy(info->data, (uint32_t *)qdf_nbuf_data(buf) +
+			     wmi_handle->log_info.buf_offset_command,
+			     sizeof(info->data));
 	}
 #endif
 
+	*htc_pkt = pkt;
+	return QDF_STATUS_SUCCESS;
+}
+
+/**
+ * wmi_unified_cmd_send() - WMI command API
+ * @wmi_handle: handle to wmi
+ * @buf: wmi buf
+ * @len: wmi buffer length
+ * @cmd_id: wmi command id
+ *
+ * Return: 0 on success
+ */
+int wmi_unified_cmd_send(wmi_unified_t wmi_handle, wmi_buf_t buf, uint32_t len,
+			 uint32_t cmd_id)
+{
+	struct wmi_cmd_sent_info info;
+	HTC_PACKET *pkt;
+	A_STATUS status;
+	int ret;
+
+	ret = wmi_unified_cmd_prepare(wmi_handle, buf, len, cmd_id, &pkt,
+				      &info);
+	if (ret)
+		return ret;
+
 	status = htc_send_pkt(wmi_handle->htc_handle, pkt);
 
 	if (A_OK != status) {
@@ -1816,18 +3068,80 @@ int wmi_unified_cmd_send(wmi_unified_t wmi_handle, wmi_buf_t buf, uint32_t len,
 	if (status)
 		return QDF_STATUS_E_FAILURE;
 
+	wmi_unified_cmd_sent(wmi_handle, &info);
 	return QDF_STATUS_SUCCESS;
 }
 
 /**
- * wmi_unified_get_event_handler_ix() - gives event handler's index
+ * wmi_unified_cmd_send_multiple() - send a group of WMI commands
+ * @wmi_handle: handle to wmi
+ * @bufs: wmi bufs, in send order
+ * @lens: wmi buffer lengths
+ * @cmd_ids: wmi command ids
+ * @num: number of commands
+ *
+ * The commands are handed to HTC in one queue so that it can bundle
+ * them into as few bus transfers as its credits allow. Commands are
+ * checked in order and the group is cut at the first one that fails,
+ * or after WMI_PARAM_BATCH_MAX commands. Nothing is logged for a
+ * command HTC does not take.
+ *
+ * Return: number of leading commands sent, the caller still owns the
+ * buffers of the rest, unchanged
+ */
+uint32_t wmi_unified_cmd_send_multiple(wmi_unified_t wmi_handle,
+				       wmi_buf_t *bufs, uint32_t *lens,
+				       uint32_t *cmd_ids, uint32_t num)
+{
+	struct wmi_cmd_sent_info info[WMI_PARAM_BATCH_MAX];
+	HTC_PACKET_QUEUE queue;
+	HTC_PACKET *pkt;
+	A_STATUS status;
+	uint32_t i, sent;
+
+	if (num > WMI_PARAM_BATCH_MAX)
+		num = WMI_PARAM_BATCH_MAX;
+
+	INIT_HTC_PACKET_QUEUE(&queue);
+	for (sent = 0; sent < num; sent++) {
+		if (wmi_unified_cmd_prepare(wmi_handle, bufs[sent],
+					    lens[sent], cmd_ids[sent], &pkt,
+					    &info[sent]))
+			break;
+		HTC_PACKET_ENQUEUE(&queue, pkt);
+	}
+
+	if (!sent)
+		return 0;
+
+	status = htc_send_pkts_multiple(wmi_handle->htc_handle, &queue);
+	if (A_OK != status) {
+		QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_ERROR,
+			  "%s %d, htc_send_pkts_multiple failed", __func__,
+			  __LINE__);
+		/* HTC rejected the queue without consuming it */
+		while ((pkt = htc_packet_dequeue(&queue)))
+			wmi_unified_cmd_unprepare(wmi_handle, pkt);
+		return 0;
+	}
+
+	for (i = 0; i < sent; i++)
+		wmi_unified_cmd_sent(wmi_handle, &info[i]);
+
+	return sent;
+}
+
+/**
+ * wmi_unified_find_event_handler_ix() - linear search of an event handler
  * @wmi_handle: handle to wmi
  * @event_id: wmi  event id
  *
+ * Used for event ids that do not fit in the dispatch table.
+ *
  * Return: event handler's index
  */
-int wmi_unified_get_event_handler_ix(wmi_unified_t wmi_handle,
-				     uint32_t event_id)
+static int wmi_unified_find_event_handler_ix(wmi_unified_t wmi_handle,
+					     uint32_t event_id)
 {
 	uint32_t idx = 0;
 	int32_t invalid_idx = -1;
@@ -1843,6 +3157,43 @@ int wmi_unified_get_event_handler_ix(wmi_unified_t wmi_handle,
 	return invalid_idx;
 }
 
+/**
+ * wmi_unified_get_event_handler_ix() - gives event handler's index
+ * @wmi_handle: handle to wmi
+ * @event_id: wmi  event id
+ *
+ * Lookups take no lock: a slot is only published once the handler
+ * entry it points to is complete, and the entry is checked against
+ * @event_id in case it was unregistered meanwhile.
+ *
+ * Return: event handler's index
+ */
+int wmi_unified_get_event_handler_ix(wmi_unified_t wmi_handle,
+				     uint32_t event_id)
+{
+	uint32_t chunk = event_id >> WMI_EVT_TBL_SLOT_BITS;
+	uint16_t *slots;
+	uint32_t idx;
+
+	if (qdf_unlikely(chunk >= WMI_EVT_TBL_CHUNKS))
+		return wmi_unified_find_event_handler_ix(wmi_handle, event_id);
+
+	slots = wmi_handle->evt_tbl[chunk];
+	if (!slots)
+		return -1;
+
+	idx = slots[event_id & (WMI_EVT_TBL_SLOTS - 1)];
+	if (!idx)
+		return -1;
+
+	idx--;
+	if (wmi_handle->event_id[idx] != event_id ||
+	    wmi_handle->event_handler[idx] == NULL)
+		return -1;
+
+	return idx;
+}
+
 /**
  * wmi_unified_register_event_handler() - register wmi event handler
  * @wmi_handle: handle to wmi
@@ -1859,6 +3210,8 @@ int wmi_unified_register_event_handler(wmi_unified_t wmi_handle,
 {
 	uint32_t idx = 0;
 	uint32_t evt_id;
+	uint32_t chunk;
+	uint16_t *slots = NULL;
 
 #ifdef WMI_TLV_AND_NON_TLV_SUPPORT
 	if (event_id >= wmi_events_max ||
@@ -1871,23 +3224,59 @@ int wmi_unified_register_event_handler(wmi_unified_t wmi_handle,
 #else
 	evt_id = event_id;
 #endif
+	chunk = evt_id >> WMI_EVT_TBL_SLOT_BITS;
+	if (chunk < WMI_EVT_TBL_CHUNKS && !wmi_handle->evt_tbl[chunk]) {
+		slots = qdf_mem_malloc(WMI_EVT_TBL_SLOTS * sizeof(*slots));
+		if (!slots) {
+			qdf_print("%s : no memory for event 0x%x\n",
+			       __func__, evt_id);
+			return QDF_STATUS_E_NOMEM;
+		}
+	}
+
+	qdf_spin_lock_bh(&wmi_handle->ctx_lock);
 	if (wmi_unified_get_event_handler_ix(wmi_handle, evt_id) != -1) {
+		qdf_spin_unlock_bh(&wmi_handle->ctx_lock);
+		if (slots)
+			qdf_mem_free(slots);
 		qdf_print("%s : event handler already registered 0x%x\n",
 		       __func__, evt_id);
 		return QDF_STATUS_E_FAILURE;
 	}
-	if (wmi_handle->max_event_idx == WMI_UNIFIED_MAX_EVENT) {
+
+	/* reuse the first entry freed by an unregister */
+	for (idx = 0; idx < wmi_handle->max_event_idx; idx++)
+		if (wmi_handle->event_handler[idx] == NULL)
+			break;
+	if (idx == WMI_UNIFIED_MAX_EVENT) {
+		qdf_spin_unlock_bh(&wmi_handle->ctx_lock);
+		if (slots)
+			qdf_mem_free(slots);
 		qdf_print("%s : no more event handlers 0x%x\n",
 		       __func__, evt_id);
 		return QDF_STATUS_E_FAILURE;
 	}
-	idx = wmi_handle->max_event_idx;
 	wmi_handle->event_handler[idx] = handler_func;
 	wmi_handle->event_id[idx] = evt_id;
-	qdf_spin_lock_bh(&wmi_handle->ctx_lock);
 	wmi_handle->ctx[idx] = rx_ctx;
+	wmi_handle->evt_class[idx] = WMI_RX_EVT_CLASS_NORMAL;
+	if (idx == wmi_handle->max_event_idx)
+		wmi_handle->max_event_idx++;
+
+	if (chunk < WMI_EVT_TBL_CHUNKS) {
+		if (slots && !wmi_handle->evt_tbl[chunk]) {
+			wmi_handle->evt_tbl[chunk] = slots;
+			slots = NULL;
+		}
+		/* entry must be visible before lockless readers find it */
+		qdf_mb();
+		wmi_handle->evt_tbl[chunk][evt_id & (WMI_EVT_TBL_SLOTS - 1)] =
+			idx + 1;
+	}
 	qdf_spin_unlock_bh(&wmi_handle->ctx_lock);
-	wmi_handle->max_event_idx++;
+
+	if (slots)
+		qdf_mem_free(slots);
 
 	return 0;
 }
@@ -1902,9 +3291,73 @@ int wmi_unified_register_event_handler(wmi_unified_t wmi_handle,
 int wmi_unified_unregister_event_handler(wmi_unified_t wmi_handle,
 					 uint32_t event_id)
 {
-	uint32_t idx = 0;
+	int idx = 0;
+	uint32_t evt_id;
+	uint32_t chunk;
+
+#ifdef WMI_TLV_AND_NON_TLV_SUPPORT
+	if (event_id >= wmi_events_max ||
+		wmi_handle->wmi_events[event_id] == WMI_EVENT_ID_INVALID) {
+		qdf_print("%s: Event id %d is unavailable\n",
+				 __func__, event_id);
+		return QDF_STATUS_E_FAILURE;
+	}
+	evt_id = wmi_handle->wmi_events[event_id];
+#else
+	evt_id = event_id;
+#endif
+
+	qdf_spin_lock_bh(&wmi_handle->ctx_lock);
+	idx = wmi_unified_get_event_handler_ix(wmi_handle, evt_id);
+	if (idx == -1) {
+		qdf_spin_unlock_bh(&wmi_handle->ctx_lock);
+		qdf_print("%s : event handler is not registered: evt id 0x%x\n",
+		       __func__, evt_id);
+		return QDF_STATUS_E_FAILURE;
+	}
+
+	/* entries do not move, so concurrent lookups of other events
+	 * are not disturbed */
+	chunk = evt_id >> WMI_EVT_TBL_SLOT_BITS;
+	if (chunk < WMI_EVT_TBL_CHUNKS)
+		wmi_handle->evt_tbl[chunk][evt_id & (WMI_EVT_TBL_SLOTS - 1)] =
+			0;
+	qdf_mb();
+	wmi_handle->event_handler[idx] = NULL;
+	wmi_handle->event_id[idx] = 0;
+	while (wmi_handle->max_event_idx &&
+	       wmi_handle->event_handler[wmi_handle->max_event_idx - 1] ==
+	       NULL)
+		--wmi_handle->max_event_idx;
+	qdf_spin_unlock_bh(&wmi_handle->ctx_lock);
+
+	return 0;
+}
+
+/**
+ * wmi_unified_set_event_class() - set the priority class of an event
+ * @wmi_handle: handle to wmi
+ * @event_id: wmi event id
+ * @evt_class: class the event is queued in for WMI_RX_WORK_CTX
+ *
+ * Events of WMI_RX_EVT_CLASS_HIGH are handled by wmi_rx_hipri_work(),
+ * which runs concurrently with wmi_rx_event_work(). Their handlers are
+ * not serialized against the other WMI_RX_WORK_CTX handlers and may run
+ * before events that arrived earlier. Only events whose handlers lock
+ * their own state and do not depend on the order of other events can
+ * be made high priority.
+ *
+ * Return: 0 on success
+ */
+int wmi_unified_set_event_class(wmi_unified_t wmi_handle, uint32_t event_id,
+				enum wmi_rx_evt_class evt_class)
+{
+	int idx = 0;
 	uint32_t evt_id;
 
+	if (evt_class >= WMI_RX_EVT_CLASS_MAX)
+		return QDF_STATUS_E_INVAL;
+
 #ifdef WMI_TLV_AND_NON_TLV_SUPPORT
 	if (event_id >= wmi_events_max ||
 		wmi_handle->wmi_events[event_id] == WMI_EVENT_ID_INVALID) {
@@ -1917,21 +3370,115 @@ int wmi_unified_unregister_event_handler(wmi_unified_t wmi_handle,
 	evt_id = event_id;
 #endif
 
+	qdf_spin_lock_bh(&wmi_handle->ctx_lock);
 	idx = wmi_unified_get_event_handler_ix(wmi_handle, evt_id);
 	if (idx == -1) {
+		qdf_spin_unlock_bh(&wmi_handle->ctx_lock);
 		qdf_print("%s : event handler is not registered: evt id 0x%x\n",
 		       __func__, evt_id);
 		return QDF_STATUS_E_FAILURE;
 	}
-	wmi_handle->event_handler[idx] = NULL;
-	wmi_handle->event_id[idx] = 0;
-	--wmi_handle->max_event_idx;
-	wmi_handle->event_handler[idx] =
-		wmi_handle->event_handler[wmi_handle->max_event_idx];
-	wmi_handle->event_id[idx] =
-		wmi_handle->event_id[wmi_handle->max_event_idx];
-
-	return 0;
+	wmi_handle->evt_class[idx] = evt_class;
+	qdf_spin_unlock_bh(&wmi_handle->ctx_lock);
+
+	return 0;
+}
+
+/**
+ * wmi_unified_set_event_class_depth() - limit the queue of an event class
+ * @wmi_handle: handle to wmi
+ * @evt_class: event class
+ * @depth: events queued beyond this are dropped, at most
+ *	WMI_RX_QUEUE_MAX_DEPTH
+ *
+ * Return: 0 on success
+ */
+int wmi_unified_set_event_class_depth(wmi_unified_t wmi_handle,
+				      enum wmi_rx_evt_class evt_class,
+				      uint32_t depth)
+{
+	if (evt_class >= WMI_RX_EVT_CLASS_MAX || !depth ||
+	    depth > WMI_RX_QUEUE_MAX_DEPTH)
+		return QDF_STATUS_E_INVAL;
+
+	qdf_spin_lock_bh(&wmi_handle->eventq_lock);
+	wmi_handle->evt_queues[evt_class].max_depth = depth;
+	qdf_spin_unlock_bh(&wmi_handle->eventq_lock);
+
+	return 0;
+}
+
+/**
+ * wmi_unified_track_cmd_response() - time a command up to its response
+ * @wmi_handle: handle to wmi
+ * @cmd_id: wmi command id
+ * @event_id: wmi event id answering @cmd_id
+ *
+ * The send to response latency of @cmd_id then shows next to its tx
+ * completion latency in the wmi_cmd_latency debugfs file.
+ *
+ * Return: 0 on success
+ */
+int wmi_unified_track_cmd_response(wmi_unified_t wmi_handle, uint32_t cmd_id,
+				   uint32_t event_id)
+{
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+	struct wmi_cmd_lat_tbl *tbl = wmi_handle->cmd_lat;
+	struct wmi_cmd_lat *slot;
+	uint32_t evt_id;
+
+	if (!tbl)
+		return QDF_STATUS_E_NOSUPPORT;
+
+#ifdef WMI_TLV_AND_NON_TLV_SUPPORT
+	if (event_id >= wmi_events_max ||
+		wmi_handle->wmi_events[event_id] == WMI_EVENT_ID_INVALID) {
+		qdf_print("%s: Event id %d is unavailable\n",
+				 __func__, event_id);
+		return QDF_STATUS_E_FAILURE;
+	}
+	evt_id = wmi_handle->wmi_events[event_id];
+#else
+	evt_id = event_id;
+#endif
+
+	qdf_spin_lock_bh(&tbl->lock);
+	slot = wmi_cmd_lat_slot(tbl, cmd_id, true);
+	if (!slot || tbl->num_resp >= WMI_CMD_LAT_RESP_MAX) {
+		qdf_spin_unlock_bh(&tbl->lock);
+		qdf_print("%s: no room to track cmd 0x%x\n", __func__, cmd_id);
+		return QDF_STATUS_E_NOMEM;
+	}
+	tbl->resp[tbl->num_resp].event_id = evt_id;
+	tbl->resp[tbl->num_resp].slot = slot - tbl->slots;
+	tbl->num_resp++;
+	slot->track_resp = true;
+	qdf_spin_unlock_bh(&tbl->lock);
+
+	return 0;
+#else
+	return QDF_STATUS_E_NOSUPPORT;
+#endif
+}
+
+/**
+ * wmi_rx_buf_free() - free a received fw event buffer
+ * @wmi_handle: handle to wmi
+ * @evt_buf: event buffer indicated by HTC
+ *
+ * The buffer goes back to HTC so that its receive buffer can be recycled.
+ *
+ * Return: none
+ */
+static void wmi_rx_buf_free(struct wmi_unified *wmi_handle, wmi_buf_t evt_buf)
+{
+	/* replayed events may run before the service is connected */
+	if (!wmi_handle->htc_handle) {
+		qdf_nbuf_free(evt_buf);
+		return;
+	}
+	htc_rx_nbuf_free(wmi_handle->htc_handle, wmi_handle->wmi_endpoint_id,
+			 evt_buf);
 }
 
 /**
@@ -1951,6 +3498,10 @@ static void wmi_process_fw_event_default_ctx(struct wmi_unified *wmi_handle,
 	wmi_buf_t evt_buf;
 	evt_buf = (wmi_buf_t) htc_packet->pPktContext;
 
+	/* the event leaves WMI and is freed with qdf_nbuf_free() */
+	htc_rx_nbuf_release(wmi_handle->htc_handle,
+			    wmi_handle->wmi_endpoint_id, evt_buf);
+
 #ifdef WMI_NON_TLV_SUPPORT
 	wmi_handle->rx_ops.wma_process_fw_event_handler_cbk
 		(wmi_handle->scn_handle, evt_buf, exec_ctx);
@@ -1963,83 +3514,284 @@ static void wmi_process_fw_event_default_ctx(struct wmi_unified *wmi_handle,
 }
 
 /**
- * wmi_process_fw_event_worker_thread_ctx() - process in worker thread context
+ * wmi_log_rx_event() - record a fw event deferred to the worker thread
  * @wmi_handle: handle to wmi
- * @htc_packet: pointer to htc packet
- *
- * Event process by below function will be in worker thread context.
- * Use this method for events which are not critical and not
- * handled in protocol stack.
+ * @evt_buf: fw event buffer
  *
  * Return: none
  */
-static void wmi_process_fw_event_worker_thread_ctx
-		(struct wmi_unified *wmi_handle, HTC_PACKET *htc_packet)
+static inline void wmi_log_rx_event(struct wmi_unified *wmi_handle,
+				    wmi_buf_t evt_buf)
 {
-	wmi_buf_t evt_buf;
+#ifdef WMI_INTERFACE_EVENT_LOGGING
 	uint32_t id;
 	uint8_t *data;
 
-	evt_buf = (wmi_buf_t) htc_packet->pPktContext;
 	id = WMI_GET_FIELD(qdf_nbuf_data(evt_buf), WMI_CMD_HDR, COMMANDID);
 	data = qdf_nbuf_data(evt_buf);
 
-#ifdef WMI_INTERFACE_EVENT_LOGGING
 	if (wmi_handle->log_info.wmi_logging_enable) {
-		qdf_spin_lock_bh(&wmi_handle->log_info.wmi_record_lock);
 		/* Exclude 4 bytes of TLV header */
 		WMI_RX_EVENT_RECORD(wmi_handle, id, ((uint8_t *) data +
 				wmi_handle->log_info.buf_offset_event));
-		qdf_spin_unlock_bh(&wmi_handle->log_info.wmi_record_lock);
 	}
 #endif
+}
+
+static DEFINE_RATELIMIT_STATE(wmi_rx_drop_ratelimit, 5 * HZ, 1);
+
+/**
+ * wmi_rx_evt_enqueue() - queue events for the worker of their class
+ * @wmi_handle: handle to wmi
+ * @evt_class: class of the events
+ * @bufs: events, in arrival order; emptied
+ *
+ * Return: none
+ */
+static void wmi_rx_evt_enqueue(struct wmi_unified *wmi_handle,
+			       uint8_t evt_class, qdf_nbuf_queue_t *bufs)
+{
+	struct wmi_rx_evt_queue *q = &wmi_handle->evt_queues[evt_class];
+	uint32_t now = (uint32_t)qdf_get_monotonic_boottime();
+	uint32_t depth, queued = 0, dropped = 0;
+	wmi_buf_t buf;
+
 	qdf_spin_lock_bh(&wmi_handle->eventq_lock);
-	qdf_nbuf_queue_add(&wmi_handle->event_queue, evt_buf);
+	while ((buf = qdf_nbuf_queue_remove(bufs))) {
+		depth = qdf_nbuf_queue_len(&q->queue);
+		if (depth >= q->max_depth) {
+			q->drops++;
+			dropped++;
+			wmi_rx_buf_free(wmi_handle, buf);
+			continue;
+		}
+		q->enq_ts[(q->head + depth) % WMI_RX_QUEUE_MAX_DEPTH] = now;
+		qdf_nbuf_queue_add(&q->queue, buf);
+		if (depth + 1 > q->max_seen)
+			q->max_seen = depth + 1;
+		queued++;
+	}
 	qdf_spin_unlock_bh(&wmi_handle->eventq_lock);
-	schedule_work(&wmi_handle->rx_event_work);
-	return;
+
+	/* runs in softirq: drops are counted in q->drops, report them rarely */
+	if (dropped && __ratelimit(&wmi_rx_drop_ratelimit))
+		QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_ERROR,
+			  "%s: class %d queue full, %u events dropped so far",
+			  __func__, evt_class, q->drops);
+	if (!queued)
+		return;
+
+	if (evt_class == WMI_RX_EVT_CLASS_HIGH && wmi_handle->rx_hipri_wq)
+		queue_work(wmi_handle->rx_hipri_wq, &wmi_handle->rx_hipri_work);
+	else
+		schedule_work(&wmi_handle->rx_event_work);
 }
 
 /**
- * wmi_control_rx() - process fw events callbacks
- * @ctx: handle to wmi
+ * wmi_rx_evt_dequeue() - take the next event for a worker
+ * @wmi_handle: handle to wmi
+ * @first: highest priority class served by the worker
+ * @last: lowest priority class served by the worker
+ *
+ * Return: oldest event of the highest priority non-empty class, or NULL
+ */
+static wmi_buf_t wmi_rx_evt_dequeue(struct wmi_unified *wmi_handle,
+				    int first, int last)
+{
+	struct wmi_rx_evt_queue *q = NULL;
+	uint32_t now = (uint32_t)qdf_get_monotonic_boottime();
+	uint32_t delay;
+	wmi_buf_t buf = NULL;
+	int i;
+
+	qdf_spin_lock_bh(&wmi_handle->eventq_lock);
+	for (i = first; i <= last && !buf; i++) {
+		q = &wmi_handle->evt_queues[i];
+		buf = qdf_nbuf_queue_remove(&q->queue);
+	}
+	if (buf) {
+		delay = now - q->enq_ts[q->head];
+		q->head = (q->head + 1) % WMI_RX_QUEUE_MAX_DEPTH;
+		for (i = 0; i < WMI_RX_DELAY_BINS - 1; i++)
+			if (delay < wmi_rx_delay_bin_us[i])
+				break;
+		q->delay_hist[i]++;
+	}
+	qdf_spin_unlock_bh(&wmi_handle->eventq_lock);
+
+	return buf;
+}
+
+/**
+ * wmi_rx_evt_flush() - drop all events queued for the workers
+ * @wmi_handle: handle to wmi
+ *
+ * Return: none
+ */
+static void wmi_rx_evt_flush(struct wmi_unified *wmi_handle)
+{
+	struct wmi_rx_evt_queue *q;
+	qdf_nbuf_queue_t drain;
+	wmi_buf_t buf;
+	int i;
+
+	qdf_nbuf_queue_init(&drain);
+	qdf_spin_lock_bh(&wmi_handle->eventq_lock);
+	for (i = 0; i < WMI_RX_EVT_CLASS_MAX; i++) {
+		q = &wmi_handle->evt_queues[i];
+		qdf_nbuf_queue_append(&drain, &q->queue);
+		qdf_nbuf_queue_init(&q->queue);
+		q->head = 0;
+	}
+	qdf_spin_unlock_bh(&wmi_handle->eventq_lock);
+
+	while ((buf = qdf_nbuf_queue_remove(&drain)))
+		wmi_rx_buf_free(wmi_handle, buf);
+}
+
+/**
+ * wmi_process_fw_event_worker_thread_ctx() - process in worker thread context
+ * @wmi_handle: handle to wmi
  * @htc_packet: pointer to htc packet
+ * @evt_class: class of the event
+ *
+ * Event process by below function will be in worker thread context.
+ * Use this method for events which are not critical and not
+ * handled in protocol stack.
  *
  * Return: none
  */
-void wmi_control_rx(void *ctx, HTC_PACKET *htc_packet)
+static void wmi_process_fw_event_worker_thread_ctx
+		(struct wmi_unified *wmi_handle, HTC_PACKET *htc_packet,
+		 uint8_t evt_class)
 {
-	struct wmi_unified *wmi_handle = (struct wmi_unified *)ctx;
 	wmi_buf_t evt_buf;
+	qdf_nbuf_queue_t bufs;
+
+	evt_buf = (wmi_buf_t) htc_packet->pPktContext;
+	wmi_log_rx_event(wmi_handle, evt_buf);
+
+	qdf_nbuf_queue_init(&bufs);
+	qdf_nbuf_queue_add(&bufs, evt_buf);
+	wmi_rx_evt_enqueue(wmi_handle, evt_class, &bufs);
+	return;
+}
+
+/**
+ * wmi_get_event_exec_ctx() - find the context a fw event is processed in
+ * @wmi_handle: handle to wmi
+ * @evt_buf: fw event buffer
+ * @exec_ctx: set to the execution context of the event handler
+ * @evt_class: set to the priority class of the event
+ *
+ * Events without a handler are dropped.
+ *
+ * Return: false if @evt_buf was freed, true otherwise
+ */
+static bool wmi_get_event_exec_ctx(struct wmi_unified *wmi_handle,
+				   wmi_buf_t evt_buf,
+				   enum wmi_rx_exec_ctx *exec_ctx,
+				   uint8_t *evt_class)
+{
 	uint32_t id;
 	uint32_t idx = 0;
-	enum wmi_rx_exec_ctx exec_ctx;
 
-	evt_buf = (wmi_buf_t) htc_packet->pPktContext;
 	id = WMI_GET_FIELD(qdf_nbuf_data(evt_buf), WMI_CMD_HDR, COMMANDID);
 	idx = wmi_unified_get_event_handler_ix(wmi_handle, id);
 	if (qdf_unlikely(idx == A_ERROR)) {
 		qdf_print
 		("%s :event handler is not registered: event id 0x%x\n",
 			__func__, id);
-		qdf_nbuf_free(evt_buf);
-		return;
+		wmi_rx_buf_free(wmi_handle, evt_buf);
+		return false;
 	}
-	qdf_spin_lock_bh(&wmi_handle->ctx_lock);
-	exec_ctx = wmi_handle->ctx[idx];
-	qdf_spin_unlock_bh(&wmi_handle->ctx_lock);
+	*exec_ctx = wmi_handle->ctx[idx];
+	*evt_class = wmi_handle->evt_class[idx];
+
+	return true;
+}
+
+/**
+ * wmi_control_rx() - process fw events callbacks
+ * @ctx: handle to wmi
+ * @htc_packet: pointer to htc packet
+ *
+ * Return: none
+ */
+void wmi_control_rx(void *ctx, HTC_PACKET *htc_packet)
+{
+	struct wmi_unified *wmi_handle = (struct wmi_unified *)ctx;
+	wmi_buf_t evt_buf;
+	enum wmi_rx_exec_ctx exec_ctx;
+	uint8_t evt_class;
+
+	evt_buf = (wmi_buf_t) htc_packet->pPktContext;
+	if (!wmi_get_event_exec_ctx(wmi_handle, evt_buf, &exec_ctx,
+				    &evt_class))
+		return;
+	wmi_cmd_lat_event(wmi_handle, evt_buf);
+	wmi_evt_capture(wmi_handle, evt_buf);
 
 	if (exec_ctx == WMI_RX_WORK_CTX) {
 		wmi_process_fw_event_worker_thread_ctx
-					(wmi_handle, htc_packet);
+					(wmi_handle, htc_packet, evt_class);
 	} else if (exec_ctx > WMI_RX_WORK_CTX) {
 		wmi_process_fw_event_default_ctx
 					(wmi_handle, htc_packet, exec_ctx);
 	} else {
 		qdf_print("%s :Invalid event context %d\n", __func__, exec_ctx);
-		qdf_nbuf_free(evt_buf);
+		wmi_rx_buf_free(wmi_handle, evt_buf);
+	}
+}
+
+/**
+ * wmi_control_rx_multiple() - process fw events received together
+ * @ctx: handle to wmi
+ * @htc_packets: htc packets of the events, in arrival order
+ *
+ * Events for the worker threads are queued with a single lock round
+ * trip and a single work schedule per event class.
+ *
+ * Return: none
+ */
+static void wmi_control_rx_multiple(void *ctx, HTC_PACKET_QUEUE *htc_packets)
+{
+	struct wmi_unified *wmi_handle = (struct wmi_unified *)ctx;
+	HTC_PACKET *htc_packet;
+	wmi_buf_t evt_buf;
+	enum wmi_rx_exec_ctx exec_ctx;
+	uint8_t evt_class;
+	qdf_nbuf_queue_t work_queue[WMI_RX_EVT_CLASS_MAX];
+	int i;
+
+	for (i = 0; i < WMI_RX_EVT_CLASS_MAX; i++)
+		qdf_nbuf_queue_init(&work_queue[i]);
+
+	HTC_PACKET_QUEUE_ITERATE_ALLOW_REMOVE(htc_packets, htc_packet) {
+		evt_buf = (wmi_buf_t) htc_packet->pPktContext;
+		if (!wmi_get_event_exec_ctx(wmi_handle, evt_buf, &exec_ctx,
+					    &evt_class))
+			continue;
+		wmi_cmd_lat_event(wmi_handle, evt_buf);
+		wmi_evt_capture(wmi_handle, evt_buf);
+
+		if (exec_ctx == WMI_RX_WORK_CTX) {
+			wmi_log_rx_event(wmi_handle, evt_buf);
+			qdf_nbuf_queue_add(&work_queue[evt_class], evt_buf);
+		} else if (exec_ctx > WMI_RX_WORK_CTX) {
+			wmi_process_fw_event_default_ctx
+					(wmi_handle, htc_packet, exec_ctx);
+		} else {
+			qdf_print("%s :Invalid event context %d\n", __func__,
+				  exec_ctx);
+			wmi_rx_buf_free(wmi_handle, evt_buf);
+		}
 	}
+	HTC_PACKET_QUEUE_ITERATE_END;
 
+	for (i = 0; i < WMI_RX_EVT_CLASS_MAX; i++)
+		if (!qdf_nbuf_is_queue_empty(&work_queue[i]))
+			wmi_rx_evt_enqueue(wmi_handle, i, &work_queue[i]);
 }
 
 /**
@@ -2056,6 +3808,282 @@ void wmi_process_fw_event(struct wmi_unified *wmi_handle, wmi_buf_t evt_buf)
 	__wmi_control_rx(wmi_handle, evt_buf);
 }
 
+#ifndef WMI_NON_TLV_SUPPORT
+/**
+ * wmi_tlv_arena_get() - take the event TLV parsing arena
+ * @wmi_handle: wmi handle
+ *
+ * Events are parsed both from the WMI rx work and from the umac
+ * context; whoever loses the race parses with heap allocations.
+ *
+ * Return: true if the arena may be used
+ */
+static bool wmi_tlv_arena_get(struct wmi_unified *wmi_handle)
+{
+	if (!wmi_handle->tlv_arena)
+		return false;
+
+	if (qdf_atomic_inc_return(&wmi_handle->tlv_arena_busy) == 1)
+		return true;
+
+	qdf_atomic_dec(&wmi_handle->tlv_arena_busy);
+	return false;
+}
+
+/**
+ * wmi_tlv_arena_put() - release the event TLV parsing arena
+ * @wmi_handle: wmi handle
+ *
+ * Return: none
+ */
+static inline void wmi_tlv_arena_put(struct wmi_unified *wmi_handle)
+{
+	qdf_atomic_dec(&wmi_handle->tlv_arena_busy);
+}
+
+/**
+ * wmi_tlv_event_parse() - validate and pad(if necessary) the event TLVs
+ * @wmi_handle: wmi handle
+ * @id: event id
+ * @data: event after the WMI header, padded in place
+ * @len: length of @data
+ * @parsed: event parameters returned here
+ * @use_arena: set when @parsed lives in the TLV parsing arena
+ *
+ * The arena is used when it is free and large enough, heap allocations
+ * otherwise. @parsed is released with wmi_tlv_event_free().
+ *
+ * Return: 0 on success, wmitlv error status otherwise
+ */
+static int wmi_tlv_event_parse(struct wmi_unified *wmi_handle, uint32_t id,
+			       uint8_t *data, uint32_t len, void **parsed,
+			       bool *use_arena)
+{
+	int status = 0;
+
+	*use_arena = wmi_tlv_arena_get(wmi_handle);
+	if (*use_arena) {
+		status = wmitlv_check_and_pad_event_tlvs_arena(
+				wmi_handle->scn_handle, data, len, id, parsed,
+				wmi_handle->tlv_arena, WMI_TLV_ARENA_SIZE);
+		if (status != WMITLV_ERR_ARENA_FULL)
+			return status;
+		wmi_tlv_arena_put(wmi_handle);
+		*use_arena = false;
+	}
+
+	return wmitlv_check_and_pad_event_tlvs(wmi_handle->scn_handle, data,
+					       len, id, parsed);
+}
+
+/**
+ * wmi_tlv_event_free() - release the event parameters
+ * @wmi_handle: wmi handle
+ * @id: event id
+ * @parsed: event parameters from wmi_tlv_event_parse()
+ * @use_arena: @parsed lives in the TLV parsing arena
+ *
+ * Return: none
+ */
+static void wmi_tlv_event_free(struct wmi_unified *wmi_handle, uint32_t id,
+			       void **parsed, bool use_arena)
+{
+	if (use_arena)
+		wmi_tlv_arena_put(wmi_handle);
+	else
+		wmitlv_free_allocated_event_tlvs(id, parsed);
+}
+#endif
+
+#ifdef WMI_INTERFACE_EVENT_LOGGING
+/**
+ * wmi_evt_replay_stat() - find the replay statistics of an event id
+ * @rp: replay result
+ * @event_id: event id
+ *
+ * Return: statistics, NULL if the table is full
+ */
+static struct wmi_evt_replay_stat *
+wmi_evt_replay_stat(struct wmi_evt_replay *rp, uint32_t event_id)
+{
+	struct wmi_evt_replay_stat *stat;
+	uint32_t hash = (event_id * 2654435761U) >>
+			(32 - WMI_EVT_REPLAY_SLOT_BITS);
+	uint32_t i;
+
+	for (i = 0; i < WMI_EVT_REPLAY_SLOTS; i++) {
+		stat = &rp->stats[(hash + i) & (WMI_EVT_REPLAY_SLOTS - 1)];
+		if (!stat->used) {
+			stat->used = true;
+			stat->event_id = event_id;
+			return stat;
+		}
+		if (stat->event_id == event_id)
+			return stat;
+	}
+
+	return NULL;
+}
+
+/**
+ * wmi_evt_replay_stub() - event handler standing in during a replay
+ * @scn_handle: scn handle
+ * @event: parsed event
+ * @len: length of the event
+ *
+ * Return: 0
+ */
+static int wmi_evt_replay_stub(void *scn_handle, uint8_t *event, uint32_t len)
+{
+	return 0;
+}
+
+/**
+ * wmi_evt_replay_run() - replay the event capture through the rx path
+ * @wmi_handle: handle to wmi
+ * @loops: passes over the capture
+ * @dispatch: call the registered handlers instead of a stub
+ *
+ * Every captured event is parsed with wmi_tlv_event_parse() and passed
+ * to the handler registered for it, the way __wmi_control_rx() does.
+ * Unless @dispatch is set the handler is replaced by a stub, so that
+ * stale events do not reach the driver state. The cost per event id is
+ * left in wmi_handle->evt_replay.
+ *
+ * Return: 0 on success, -ve errno otherwise
+ */
+static int wmi_evt_replay_run(struct wmi_unified *wmi_handle, uint32_t loops,
+			      bool dispatch)
+{
+#ifndef WMI_NON_TLV_SUPPORT
+	struct wmi_evt_capture *cap = &wmi_handle->evt_capture;
+	struct wmi_evt_replay *rp = wmi_handle->evt_replay;
+	struct wmi_evt_replay_stat *stat;
+	struct wmi_evt_capture_rec *rec;
+	wmi_unified_event_handler handler;
+	uint8_t *scratch, *evt;
+	void *parsed;
+	uint32_t off, id, len, n, allocs;
+	uint64_t start, ns, handler_ns;
+	bool use_arena;
+	int status, idx;
+
+	if (wmi_handle->target_type != WMI_TLV_TARGET)
+		return -EOPNOTSUPP;
+
+	qdf_spin_lock_bh(&cap->lock);
+	if (cap->active || cap->busy || !cap->events) {
+		qdf_spin_unlock_bh(&cap->lock);
+		qdf_print("%s: stop a non empty capture first\n", __func__);
+		return -EBUSY;
+	}
+	cap->busy = true;
+	qdf_spin_unlock_bh(&cap->lock);
+
+	if (!rp)
+		rp = qdf_mem_malloc(sizeof(*rp));
+	else
+		qdf_mem_zero(rp, sizeof(*rp));
+	scratch = qdf_mem_malloc(cap->max_len);
+	if (!rp || !scratch) {
+		status = -ENOMEM;
+		goto out;
+	}
+	wmi_handle->evt_replay = rp;
+	rp->loops = loops;
+	rp->dispatch = dispatch;
+
+	start = ktime_get_ns();
+	for (n = 0; n < loops; n++) {
+		for (off = 0; off < cap->used;
+		     off += sizeof(*rec) + wmi_align(rec->len)) {
+			rec = (struct wmi_evt_capture_rec *)(cap->buf + off);
+			evt = (uint8_t *)(rec + 1);
+			if (rec->len < sizeof(WMI_CMD_HDR))
+				continue;
+			id = WMI_GET_FIELD(evt, WMI_CMD_HDR, COMMANDID);
+			len = rec->len - sizeof(WMI_CMD_HDR);
+			/* the parser pads in place, keep the capture intact */
+			qdf_mem_copy(scratch, evt + sizeof(WMI_CMD_HDR), len);
+
+			parsed = NULL;
+			allocs = 0;
+			handler_ns = 0;
+			ns = ktime_get_ns();
+			status = wmi_tlv_event_parse(wmi_handle, id, scratch,
+						     len, &parsed, &use_arena);
+			idx = wmi_unified_get_event_handler_ix(wmi_handle, id);
+			if (!status && idx != A_ERROR) {
+				handler = dispatch ?
+					wmi_handle->event_handler[idx] :
+					wmi_evt_replay_stub;
+				handler_ns = ktime_get_ns();
+				handler(wmi_handle->scn_handle, parsed, len);
+				handler_ns = ktime_get_ns() - handler_ns;
+			}
+			if (!use_arena)
+				allocs = wmitlv_count_allocated_event_tlvs(
+						id, parsed);
+			if (use_arena || parsed)
+				wmi_tlv_event_free(wmi_handle, id, &parsed,
+						   use_arena);
+			ns = ktime_get_ns() - ns;
+
+			rp->events++;
+			stat = wmi_evt_replay_stat(rp, id);
+			if (!stat) {
+				rp->untracked++;
+				continue;
+			}
+			stat->count++;
+			stat->total_ns += ns;
+			stat->handler_ns += handler_ns;
+			if (ns > stat->max_ns)
+				stat->max_ns = ns;
+			if (status)
+				stat->errors++;
+			stat->heap_allocs += allocs;
+		}
+		cond_resched();
+	}
+	rp->elapsed_ns = ktime_get_ns() - start;
+	status = 0;
+
+out:
+	if (scratch)
+		qdf_mem_free(scratch);
+	if (!wmi_handle->evt_replay && rp)
+		qdf_mem_free(rp);
+	qdf_spin_lock_bh(&cap->lock);
+	cap->busy = false;
+	qdf_spin_unlock_bh(&cap->lock);
+
+	return status;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
+/**
+ * wmi_evt_capture_deinit() - free the event capture and replay result
+ * @wmi_handle: handle to wmi
+ *
+ * Return: none
+ */
+static void wmi_evt_capture_deinit(struct wmi_unified *wmi_handle)
+{
+	struct wmi_evt_capture *cap = &wmi_handle->evt_capture;
+
+	cap->active = false;
+	vfree(cap->buf);
+	cap->buf = NULL;
+	if (wmi_handle->evt_replay)
+		qdf_mem_free(wmi_handle->evt_replay);
+	wmi_handle->evt_replay = NULL;
+	qdf_spinlock_destroy(&cap->lock);
+}
+#endif
+
 /**
  * __wmi_control_rx() - process serialize wmi event callback
  * @wmi_handle: wmi handle
@@ -2071,6 +4099,7 @@ void __wmi_control_rx(struct wmi_unified *wmi_handle, wmi_buf_t evt_buf)
 	void *wmi_cmd_struct_ptr = NULL;
 #ifndef WMI_NON_TLV_SUPPORT
 	int tlv_ok_status = 0;
+	bool use_arena = false;
 #endif
 	uint32_t idx = 0;
 
@@ -2084,11 +4113,9 @@ void __wmi_control_rx(struct wmi_unified *wmi_handle, wmi_buf_t evt_buf)
 
 #ifndef WMI_NON_TLV_SUPPORT
 	if (wmi_handle->target_type == WMI_TLV_TARGET) {
-		/* Validate and pad(if necessary) the TLVs */
-		tlv_ok_status =
-			wmitlv_check_and_pad_event_tlvs(wmi_handle->scn_handle,
-							data, len, id,
-							&wmi_cmd_struct_ptr);
+		tlv_ok_status = wmi_tlv_event_parse(wmi_handle, id, data, len,
+						    &wmi_cmd_struct_ptr,
+						    &use_arena);
 		if (tlv_ok_status != 0) {
 			QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_ERROR,
 				"%s: Error: id=0x%d, wmitlv check status=%d\n",
@@ -2107,7 +4134,6 @@ void __wmi_control_rx(struct wmi_unified *wmi_handle, wmi_buf_t evt_buf)
 	}
 #ifdef WMI_INTERFACE_EVENT_LOGGING
 	if (wmi_handle->log_info.wmi_logging_enable) {
-		qdf_spin_lock_bh(&wmi_handle->log_info.wmi_record_lock);
 		/* Exclude 4 bytes of TLV header */
 		if (wmi_handle->log_info.is_management_record(id)) {
 			WMI_MGMT_EVENT_RECORD(wmi_handle, id, ((uint8_t *) data
@@ -2116,7 +4142,6 @@ void __wmi_control_rx(struct wmi_unified *wmi_handle, wmi_buf_t evt_buf)
 			WMI_EVENT_RECORD(wmi_handle, id, ((uint8_t *) data +
 					wmi_handle->log_info.buf_offset_event));
 		}
-		qdf_spin_unlock_bh(&wmi_handle->log_info.wmi_record_lock);
 	}
 #endif
 	/* Call the WMI registered event handler */
@@ -2131,9 +4156,10 @@ end:
 	/* Free event buffer and allocated event tlv */
 #ifndef WMI_NON_TLV_SUPPORT
 	if (wmi_handle->target_type == WMI_TLV_TARGET)
-		wmitlv_free_allocated_event_tlvs(id, &wmi_cmd_struct_ptr);
+		wmi_tlv_event_free(wmi_handle, id, &wmi_cmd_struct_ptr,
+				   use_arena);
 #endif
-	qdf_nbuf_free(evt_buf);
+	wmi_rx_buf_free(wmi_handle, evt_buf);
 
 }
 
@@ -2142,6 +4168,8 @@ end:
  * @work: rx work queue struct
  *
  * This function process any fw event to serialize it through rx worker thread.
+ * High priority events are left to wmi_rx_hipri_work() when it exists,
+ * bulk events only run while no normal event waits.
  *
  * Return: none
  */
@@ -2149,17 +4177,29 @@ void wmi_rx_event_work(struct work_struct *work)
 {
 	struct wmi_unified *wmi = container_of(work, struct wmi_unified,
 					rx_event_work);
+	int first = wmi->rx_hipri_wq ? WMI_RX_EVT_CLASS_NORMAL :
+		WMI_RX_EVT_CLASS_HIGH;
 	wmi_buf_t buf;
 
-	qdf_spin_lock_bh(&wmi->eventq_lock);
-	buf = qdf_nbuf_queue_remove(&wmi->event_queue);
-	qdf_spin_unlock_bh(&wmi->eventq_lock);
-	while (buf) {
+	while ((buf = wmi_rx_evt_dequeue(wmi, first, WMI_RX_EVT_CLASS_BULK)))
+		__wmi_control_rx(wmi, buf);
+}
+
+/**
+ * wmi_rx_hipri_work() - process high priority rx events
+ * @work: high priority rx work queue struct
+ *
+ * Return: none
+ */
+static void wmi_rx_hipri_work(struct work_struct *work)
+{
+	struct wmi_unified *wmi = container_of(work, struct wmi_unified,
+					rx_hipri_work);
+	wmi_buf_t buf;
+
+	while ((buf = wmi_rx_evt_dequeue(wmi, WMI_RX_EVT_CLASS_HIGH,
+					 WMI_RX_EVT_CLASS_HIGH)))
 		__wmi_control_rx(wmi, buf);
-		qdf_spin_lock_bh(&wmi->eventq_lock);
-		buf = qdf_nbuf_queue_remove(&wmi->event_queue);
-		qdf_spin_unlock_bh(&wmi->eventq_lock);
-	}
 }
 
 #ifdef FEATURE_RUNTIME_PM
@@ -2211,6 +4251,7 @@ void *wmi_unified_attach(void *scn_handle,
 			 bool use_cookie, struct wmi_rx_ops *rx_ops)
 {
 	struct wmi_unified *wmi_handle;
+	int i;
 
 #ifndef WMI_NON_TLV_SUPPORT
 	wmi_handle =
@@ -2232,14 +4273,23 @@ void *wmi_unified_attach(void *scn_handle,
 	qdf_atomic_init(&wmi_handle->pending_cmds);
 	qdf_atomic_init(&wmi_handle->is_target_suspended);
 	wmi_runtime_pm_init(wmi_handle);
+	wmi_htc_pkt_pool_init(wmi_handle);
+	wmi_buf_pool_init(&wmi_handle->buf_pool);
 	qdf_spinlock_create(&wmi_handle->eventq_lock);
-	qdf_nbuf_queue_init(&wmi_handle->event_queue);
+	for (i = 0; i < WMI_RX_EVT_CLASS_MAX; i++) {
+		qdf_nbuf_queue_init(&wmi_handle->evt_queues[i].queue);
+		wmi_handle->evt_queues[i].max_depth = wmi_rx_evt_class_depth[i];
+	}
 	INIT_WORK(&wmi_handle->rx_event_work, wmi_rx_event_work);
+	/* optional, the regular worker runs high priority events without it */
+	wmi_handle->rx_hipri_wq = alloc_workqueue("wmi_rx_hipri",
+					WQ_HIGHPRI | WQ_MEM_RECLAIM, 1);
+	INIT_WORK(&wmi_handle->rx_hipri_work, wmi_rx_hipri_work);
 #ifdef WMI_INTERFACE_EVENT_LOGGING
-	if (QDF_STATUS_SUCCESS == wmi_log_init(wmi_handle)) {
-		qdf_spinlock_create(&wmi_handle->log_info.wmi_record_lock);
+	wmi_cmd_lat_init(wmi_handle);
+	qdf_spinlock_create(&wmi_handle->evt_capture.lock);
+	if (QDF_STATUS_SUCCESS == wmi_log_init(wmi_handle))
 		wmi_debugfs_init(wmi_handle);
-	}
 #endif
 	/* Attach mc_thread context processing function */
 	wmi_handle->rx_ops.wma_process_fw_event_handler_cbk =
@@ -2249,6 +4299,12 @@ void *wmi_unified_attach(void *scn_handle,
 		wmi_tlv_attach(wmi_handle);
 	else
 		wmi_non_tlv_attach(wmi_handle);
+#ifndef WMI_NON_TLV_SUPPORT
+	/* optional, events are parsed with heap allocations without it */
+	if (target_type == WMI_TLV_TARGET)
+		wmi_handle->tlv_arena = qdf_mem_malloc(WMI_TLV_ARENA_SIZE);
+	qdf_atomic_init(&wmi_handle->tlv_arena_busy);
+#endif
 	/* Assign target cookie capablity */
 	wmi_handle->use_cookie = use_cookie;
 	wmi_handle->osdev = osdev;
@@ -2267,21 +4323,34 @@ void *wmi_unified_attach(void *scn_handle,
  */
 void wmi_unified_detach(struct wmi_unified *wmi_handle)
 {
-	wmi_buf_t buf;
+	int i;
 
 	cancel_work_sync(&wmi_handle->rx_event_work);
+	if (wmi_handle->rx_hipri_wq) {
+		cancel_work_sync(&wmi_handle->rx_hipri_work);
+		destroy_workqueue(wmi_handle->rx_hipri_wq);
+		wmi_handle->rx_hipri_wq = NULL;
+	}
 
 	wmi_debugfs_remove(wmi_handle);
 
-	buf = qdf_nbuf_queue_remove(&wmi_handle->event_queue);
-	while (buf) {
-		qdf_nbuf_free(buf);
-		buf = qdf_nbuf_queue_remove(&wmi_handle->event_queue);
-	}
+	wmi_rx_evt_flush(wmi_handle);
 
 #ifdef WMI_INTERFACE_EVENT_LOGGING
 	wmi_log_buffer_free(wmi_handle);
+	wmi_cmd_lat_deinit(wmi_handle);
+	wmi_evt_capture_deinit(wmi_handle);
+#endif
+
+	for (i = 0; i < WMI_EVT_TBL_CHUNKS; i++)
+		if (wmi_handle->evt_tbl[i])
+			qdf_mem_free(wmi_handle->evt_tbl[i]);
+#ifndef WMI_NON_TLV_SUPPORT
+	if (wmi_handle->tlv_arena)
+		qdf_mem_free(wmi_handle->tlv_arena);
 #endif
+	wmi_htc_pkt_pool_deinit(wmi_handle);
+	wmi_buf_pool_deinit(&wmi_handle->buf_pool);
 
 	qdf_spinlock_destroy(&wmi_handle->eventq_lock);
 	qdf_spinlock_destroy(&wmi_handle->ctx_lock);
@@ -2303,18 +4372,12 @@ void wmi_unified_detach(struct wmi_unified *wmi_handle)
 void
 wmi_unified_remove_work(struct wmi_unified *wmi_handle)
 {
-	wmi_buf_t buf;
-
 	QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_INFO,
 		"Enter: %s", __func__);
 	cancel_work_sync(&wmi_handle->rx_event_work);
-	qdf_spin_lock_bh(&wmi_handle->eventq_lock);
-	buf = qdf_nbuf_queue_remove(&wmi_handle->event_queue);
-	while (buf) {
-		qdf_nbuf_free(buf);
-		buf = qdf_nbuf_queue_remove(&wmi_handle->event_queue);
-	}
-	qdf_spin_unlock_bh(&wmi_handle->eventq_lock);
+	if (wmi_handle->rx_hipri_wq)
+		cancel_work_sync(&wmi_handle->rx_hipri_work);
+	wmi_rx_evt_flush(wmi_handle);
 	QDF_TRACE(QDF_MODULE_ID_WMI, QDF_TRACE_LEVEL_INFO,
 		"Done: %s", __func__);
 }
@@ -2345,7 +4408,6 @@ void wmi_htc_tx_complete(void *ctx, HTC_PACKET *htc_pkt)
 	WMI_LOGD("Sent WMI command:%s command_id:0x%x over dma and recieved tx complete interupt",
 		 wmi_id_to_name(cmd_id), cmd_id);
 
-	qdf_spin_lock_bh(&wmi_handle->log_info.wmi_record_lock);
 	/* Record 16 bytes of WMI cmd tx complete data
 	- exclude TLV and WMI headers */
 	if (wmi_handle->log_info.is_management_record(cmd_id)) {
@@ -2357,12 +4419,11 @@ void wmi_htc_tx_complete(void *ctx, HTC_PACKET *htc_pkt)
 			((uint32_t *) qdf_nbuf_data(wmi_cmd_buf) +
 			wmi_handle->log_info.buf_offset_command));
 	}
-
-	qdf_spin_unlock_bh(&wmi_handle->log_info.wmi_record_lock);
 	}
 #endif
-	qdf_nbuf_free(wmi_cmd_buf);
-	qdf_mem_free(htc_pkt);
+	wmi_cmd_lat_tx_cmp(wmi_handle, wmi_cmd_buf, htc_pkt);
+	wmi_buf_pool_put(wmi_handle, wmi_cmd_buf);
+	wmi_htc_pkt_free(wmi_handle, htc_pkt);
 	qdf_atomic_dec(&wmi_handle->pending_cmds);
 }
 
@@ -2392,7 +4453,9 @@ wmi_unified_connect_htc_service(struct wmi_unified *wmi_handle,
 	connect.EpCallbacks.pContext = wmi_handle;
 	connect.EpCallbacks.EpTxCompleteMultiple =
 		NULL /* Control path completion ar6000_tx_complete */;
-	connect.EpCallbacks.EpRecv = wmi_control_rx /* Control path rx */;
+	connect.EpCallbacks.EpRecv = NULL;
+	connect.EpCallbacks.EpRecvPktMultiple =
+		wmi_control_rx_multiple /* Control path rx */;
 	connect.EpCallbacks.EpRecvRefill = NULL /* ar6000_rx_refill */;
 	connect.EpCallbacks.EpSendFull = NULL /* ar6000_tx_queue_full */;
 	connect.EpCallbacks.EpTxComplete =
@@ -2413,6 +4476,10 @@ wmi_unified_connect_htc_service(struct wmi_unified *wmi_handle,
 	wmi_handle->htc_handle = htc_handle;
 	wmi_handle->max_msg_len = response.MaxMsgLength;
 
+	/* optional, events are freed normally where the bus can't recycle */
+	htc_rx_nbuf_recycle_enable(htc_handle, response.Endpoint,
+				   WMI_RX_NBUF_POOL_SIZE);
+
 	return EOK;
 }
 
@@ -324,6 +324,171 @@ wmi_unified_pdev_param_send(void *wmi_hdl,
 	return QDF_STATUS_E_FAILURE;
 }
 
+/**
+ * wmi_unified_param_batch_init() - start an empty set_param batch
+ * @batch: batch to initialize
+ *
+ * A batch collects pdev, vdev and peer set_param commands so that
+ * wmi_unified_param_batch_flush() can hand them to HTC in one group.
+ *
+ * Return: none
+ */
+void wmi_unified_param_batch_init(struct wmi_param_batch *batch)
+{
+	qdf_mem_zero(batch, sizeof(*batch));
+}
+
+/**
+ * wmi_param_batch_next() - get the next free entry of a set_param batch
+ * @wmi_handle: handle to WMI
+ * @batch: batch to queue to
+ * @entry: returns the free entry
+ *
+ * A full batch is flushed first.
+ *
+ * Return: status of that flush, the entry is valid either way
+ */
+static QDF_STATUS wmi_param_batch_next(wmi_unified_t wmi_handle,
+				       struct wmi_param_batch *batch,
+				       struct wmi_param_batch_entry **entry)
+{
+	QDF_STATUS status = QDF_STATUS_SUCCESS;
+
+	if (batch->num_entries == WMI_PARAM_BATCH_MAX)
+		status = wmi_unified_param_batch_flush(wmi_handle, batch);
+
+	*entry = &batch->entries[batch->num_entries++];
+	return status;
+}
+
+/**
+ * wmi_unified_param_batch_add_pdev() - queue a pdev set_param to a batch
+ * @wmi_hdl: wmi handle
+ * @batch: batch from wmi_unified_param_batch_init()
+ * @param: pointer to pdev parameter
+ * @mac_id: radio context
+ *
+ * Return: QDF_STATUS_SUCCESS, or the error of flushing a full batch
+ */
+QDF_STATUS
+wmi_unified_param_batch_add_pdev(void *wmi_hdl, struct wmi_param_batch *batch,
+				 struct pdev_params *param, uint8_t mac_id)
+{
+	struct wmi_param_batch_entry *entry;
+	QDF_STATUS status;
+
+	status = wmi_param_batch_next(wmi_hdl, batch, &entry);
+	entry->type = WMI_PARAM_BATCH_PDEV;
+	entry->mac_id = mac_id;
+	entry->u.pdev = *param;
+
+	return status;
+}
+
+/**
+ * wmi_unified_param_batch_add_vdev() - queue a vdev set_param to a batch
+ * @wmi_hdl: wmi handle
+ * @batch: batch from wmi_unified_param_batch_init()
+ * @param: pointer to vdev set parameter
+ *
+ * Return: QDF_STATUS_SUCCESS, or the error of flushing a full batch
+ */
+QDF_STATUS
+wmi_unified_param_batch_add_vdev(void *wmi_hdl, struct wmi_param_batch *batch,
+				 struct vdev_set_params *param)
+{
+	struct wmi_param_batch_entry *entry;
+	QDF_STATUS status;
+
+	status = wmi_param_batch_next(wmi_hdl, batch, &entry);
+	entry->type = WMI_PARAM_BATCH_VDEV;
+	entry->u.vdev = *param;
+
+	return status;
+}
+
+/**
+ * wmi_unified_param_batch_add_peer() - queue a peer set_param to a batch
+ * @wmi_hdl: wmi handle
+ * @batch: batch from wmi_unified_param_batch_init()
+ * @peer_addr: peer mac address
+ * @param: pointer to peer set parameter
+ *
+ * Return: QDF_STATUS_SUCCESS, or the error of flushing a full batch
+ */
+QDF_STATUS
+wmi_unified_param_batch_add_peer(void *wmi_hdl, struct wmi_param_batch *batch,
+				 uint8_t peer_addr[IEEE80211_ADDR_LEN],
+				 struct peer_set_params *param)
+{
+	struct wmi_param_batch_entry *entry;
+	QDF_STATUS status;
+
+	status = wmi_param_batch_next(wmi_hdl, batch, &entry);
+	entry->type = WMI_PARAM_BATCH_PEER;
+	qdf_mem_copy(entry->peer_addr, peer_addr, IEEE80211_ADDR_LEN);
+	entry->u.peer = *param;
+
+	return status;
+}
+
+/**
+ * wmi_unified_param_batch_flush() - send the commands queued in a batch
+ * @wmi_hdl: wmi handle
+ * @batch: batch from wmi_unified_param_batch_init()
+ *
+ * Targets that support it get the commands as one group; whatever the
+ * group did not take, or every command on other targets, is sent with
+ * the regular per-command APIs. The batch is empty afterwards and its
+ * counters add up the commands sent and those that failed.
+ *
+ * Return: QDF_STATUS_SUCCESS if all commands were sent
+ */
+QDF_STATUS
+wmi_unified_param_batch_flush(void *wmi_hdl, struct wmi_param_batch *batch)
+{
+	wmi_unified_t wmi_handle = (wmi_unified_t) wmi_hdl;
+	struct wmi_param_batch_entry *entry;
+	uint32_t num = batch->num_entries;
+	uint32_t grouped = 0, failed = 0, i;
+	QDF_STATUS status;
+
+	batch->num_entries = 0;
+	if (num > 1 && wmi_handle->ops->send_param_batch_cmd)
+		grouped = wmi_handle->ops->send_param_batch_cmd(wmi_handle,
+							batch->entries, num);
+
+	for (i = grouped; i < num; i++) {
+		entry = &batch->entries[i];
+		switch (entry->type) {
+		case WMI_PARAM_BATCH_PDEV:
+			status = wmi_unified_pdev_param_send(wmi_handle,
+							     &entry->u.pdev,
+							     entry->mac_id);
+			break;
+		case WMI_PARAM_BATCH_VDEV:
+			status = wmi_unified_vdev_set_param_send(wmi_handle,
+							&entry->u.vdev);
+			break;
+		case WMI_PARAM_BATCH_PEER:
+			status = wmi_set_peer_param_send(wmi_handle,
+							 entry->peer_addr,
+							 &entry->u.peer);
+			break;
+		default:
+			status = QDF_STATUS_E_INVAL;
+			break;
+		}
+		if (QDF_IS_STATUS_ERROR(status))
+			failed++;
+	}
+
+	batch->num_sent += num - failed;
+	batch->num_failed += failed;
+
+	return failed ? QDF_STATUS_E_FAILURE : QDF_STATUS_SUCCESS;
+}
+
 /**
  *  wmi_unified_suspend_send() - WMI suspend function
  *  @param wmi_handle      : handle to WMI.
@@ -7920,6 +7920,38 @@ static void populate_vdev_param_non_tlv(uint32_t *vdev_param)
 }
 #endif
 
+#ifdef WMI_NON_TLV_SUPPORT
+/**
+ * wmi_non_tlv_track_cmd_responses() - time the commands answered by an event
+ * @wmi_handle: handle to wmi
+ *
+ * Return: None
+ */
+static void wmi_non_tlv_track_cmd_responses(wmi_unified_t wmi_handle)
+{
+#ifdef WMI_TLV_AND_NON_TLV_SUPPORT
+	uint32_t start_resp = wmi_vdev_start_resp_event_id;
+	uint32_t stopped = wmi_vdev_stopped_event_id;
+	uint32_t stats = wmi_update_stats_event_id;
+#else
+	uint32_t start_resp = WMI_VDEV_START_RESP_EVENTID;
+	uint32_t stopped = WMI_VDEV_STOPPED_EVENTID;
+	uint32_t stats = WMI_UPDATE_STATS_EVENTID;
+#endif
+
+	wmi_unified_track_cmd_response(wmi_handle,
+				       WMI_VDEV_START_REQUEST_CMDID,
+				       start_resp);
+	wmi_unified_track_cmd_response(wmi_handle,
+				       WMI_VDEV_RESTART_REQUEST_CMDID,
+				       start_resp);
+	wmi_unified_track_cmd_response(wmi_handle, WMI_VDEV_STOP_CMDID,
+				       stopped);
+	wmi_unified_track_cmd_response(wmi_handle, WMI_REQUEST_STATS_CMDID,
+				       stats);
+}
+#endif
+
 /**
  * wmi_get_non_tlv_ops() - gives pointer to wmi tlv ops
  *
@@ -7941,6 +7973,7 @@ void wmi_non_tlv_attach(struct wmi_unified *wmi_handle)
 		is_management_record_non_tlv;
 	/*(uint8 *)(*wmi_id_to_name)(uint32_t cmd_id);*/
 #endif
+	wmi_non_tlv_track_cmd_responses(wmi_handle);
 #else
 	qdf_print("%s: Not supported\n", __func__);
 #endif
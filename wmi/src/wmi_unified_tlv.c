@@ -472,25 +472,25 @@ QDF_STATUS send_peer_delete_cmd_tlv(wmi_unified_t wmi,
 }
 
 /**
- * send_peer_param_cmd_tlv() - set peer parameter in fw
+ * wmi_peer_param_build_tlv() - build a peer set_param command
  * @wmi: wmi handle
  * @peer_addr: peer mac address
  * @param    : pointer to hold peer set parameter
  *
- * Return: QDF_STATUS_SUCCESS for success or error code
+ * Return: command buffer of sizeof(wmi_peer_set_param_cmd_fixed_param)
+ *	bytes, NULL if it could not be allocated
  */
-QDF_STATUS send_peer_param_cmd_tlv(wmi_unified_t wmi,
-				uint8_t peer_addr[IEEE80211_ADDR_LEN],
-				struct peer_set_params *param)
+static wmi_buf_t wmi_peer_param_build_tlv(wmi_unified_t wmi,
+					  uint8_t *peer_addr,
+					  struct peer_set_params *param)
 {
 	wmi_peer_set_param_cmd_fixed_param *cmd;
 	wmi_buf_t buf;
-	int32_t err;
 
 	buf = wmi_buf_alloc(wmi, sizeof(*cmd));
 	if (!buf) {
 		WMI_LOGE("Failed to allocate buffer to send set_param cmd");
-		return QDF_STATUS_E_NOMEM;
+		return NULL;
 	}
 	cmd = (wmi_peer_set_param_cmd_fixed_param *) wmi_buf_data(buf);
 	WMITLV_SET_HDR(&cmd->tlv_header,
@@ -501,6 +501,28 @@ QDF_STATUS send_peer_param_cmd_tlv(wmi_unified_t wmi,
 	WMI_CHAR_ARRAY_TO_MAC_ADDR(peer_addr, &cmd->peer_macaddr);
 	cmd->param_id = param->param_id;
 	cmd->param_value = param->param_value;
+
+	return buf;
+}
+
+/**
+ * send_peer_param_cmd_tlv() - set peer parameter in fw
+ * @wmi: wmi handle
+ * @peer_addr: peer mac address
+ * @param    : pointer to hold peer set parameter
+ *
+ * Return: QDF_STATUS_SUCCESS for success or error code
+ */
+QDF_STATUS send_peer_param_cmd_tlv(wmi_unified_t wmi,
+				uint8_t peer_addr[IEEE80211_ADDR_LEN],
+				struct peer_set_params *param)
+{
+	wmi_buf_t buf;
+	int32_t err;
+
+	buf = wmi_peer_param_build_tlv(wmi, peer_addr, param);
+	if (!buf)
+		return QDF_STATUS_E_NOMEM;
 	err = wmi_unified_cmd_send(wmi, buf,
 				   sizeof(wmi_peer_set_param_cmd_fixed_param),
 				   WMI_PEER_SET_PARAM_CMDID);
@@ -726,27 +748,23 @@ send_pdev_utf_cmd_tlv(wmi_unified_t wmi_handle,
 }
 
 /**
- * send_pdev_param_cmd_tlv() - set pdev parameters
+ * wmi_pdev_param_build_tlv() - build a pdev set_param command
  * @wmi_handle: wmi handle
  * @param: pointer to pdev parameter
- * @mac_id: radio context
  *
- * Return: 0 on success, errno on failure
+ * Return: command buffer of sizeof(wmi_pdev_set_param_cmd_fixed_param)
+ *	bytes, NULL if it could not be allocated
  */
-QDF_STATUS
-send_pdev_param_cmd_tlv(wmi_unified_t wmi_handle,
-			   struct pdev_params *param,
-				uint8_t mac_id)
+static wmi_buf_t wmi_pdev_param_build_tlv(wmi_unified_t wmi_handle,
+					  struct pdev_params *param)
 {
-	QDF_STATUS ret;
 	wmi_pdev_set_param_cmd_fixed_param *cmd;
 	wmi_buf_t buf;
-	uint16_t len = sizeof(*cmd);
 
-	buf = wmi_buf_alloc(wmi_handle, len);
+	buf = wmi_buf_alloc(wmi_handle, sizeof(*cmd));
 	if (!buf) {
 		WMI_LOGE("%s:wmi_buf_alloc failed", __func__);
-		return QDF_STATUS_E_NOMEM;
+		return NULL;
 	}
 	cmd = (wmi_pdev_set_param_cmd_fixed_param *) wmi_buf_data(buf);
 	WMITLV_SET_HDR(&cmd->tlv_header,
@@ -758,6 +776,30 @@ send_pdev_param_cmd_tlv(wmi_unified_t wmi_handle,
 	cmd->param_value = param->param_value;
 	WMI_LOGD("Setting pdev param = %x, value = %u", param->param_id,
 				param->param_value);
+
+	return buf;
+}
+
+/**
+ * send_pdev_param_cmd_tlv() - set pdev parameters
+ * @wmi_handle: wmi handle
+ * @param: pointer to pdev parameter
+ * @mac_id: radio context
+ *
+ * Return: 0 on success, errno on failure
+ */
+QDF_STATUS
+send_pdev_param_cmd_tlv(wmi_unified_t wmi_handle,
+			   struct pdev_params *param,
+				uint8_t mac_id)
+{
+	QDF_STATUS ret;
+	wmi_buf_t buf;
+	uint16_t len = sizeof(wmi_pdev_set_param_cmd_fixed_param);
+
+	buf = wmi_pdev_param_build_tlv(wmi_handle, param);
+	if (!buf)
+		return QDF_STATUS_E_NOMEM;
 	ret = wmi_unified_cmd_send(wmi_handle, buf, len,
 				   WMI_PDEV_SET_PARAM_CMDID);
 	if (QDF_IS_STATUS_ERROR(ret)) {
@@ -1077,25 +1119,23 @@ send_dbglog_cmd_tlv(wmi_unified_t wmi_handle,
 }
 
 /**
- *  send_vdev_set_param_cmd_tlv() - WMI vdev set parameter function
- *  @param wmi_handle      : handle to WMI.
- *  @param macaddr        : MAC address
- *  @param param    : pointer to hold vdev set parameter
+ * wmi_vdev_param_build_tlv() - build a vdev set_param command
+ * @wmi_handle: handle to WMI.
+ * @param: pointer to hold vdev set parameter
  *
- *  Return: 0  on success and -ve on failure.
+ * Return: command buffer of sizeof(wmi_vdev_set_param_cmd_fixed_param)
+ *	bytes, NULL if it could not be allocated
  */
-QDF_STATUS send_vdev_set_param_cmd_tlv(wmi_unified_t wmi_handle,
-				struct vdev_set_params *param)
+static wmi_buf_t wmi_vdev_param_build_tlv(wmi_unified_t wmi_handle,
+					  struct vdev_set_params *param)
 {
-	QDF_STATUS ret;
 	wmi_vdev_set_param_cmd_fixed_param *cmd;
 	wmi_buf_t buf;
-	uint16_t len = sizeof(*cmd);
 
-	buf = wmi_buf_alloc(wmi_handle, len);
+	buf = wmi_buf_alloc(wmi_handle, sizeof(*cmd));
 	if (!buf) {
 		WMI_LOGE("%s:wmi_buf_alloc failed", __func__);
-		return QDF_STATUS_E_NOMEM;
+		return NULL;
 	}
 	cmd = (wmi_vdev_set_param_cmd_fixed_param *) wmi_buf_data(buf);
 	WMITLV_SET_HDR(&cmd->tlv_header,
@@ -1107,6 +1147,28 @@ QDF_STATUS send_vdev_set_param_cmd_tlv(wmi_unified_t wmi_handle,
 	cmd->param_value = param->param_value;
 	WMI_LOGD("Setting vdev %d param = %x, value = %u",
 		 param->if_id, param->param_id, param->param_value);
+
+	return buf;
+}
+
+/**
+ *  send_vdev_set_param_cmd_tlv() - WMI vdev set parameter function
+ *  @param wmi_handle      : handle to WMI.
+ *  @param macaddr        : MAC address
+ *  @param param    : pointer to hold vdev set parameter
+ *
+ *  Return: 0  on success and -ve on failure.
+ */
+QDF_STATUS send_vdev_set_param_cmd_tlv(wmi_unified_t wmi_handle,
+				struct vdev_set_params *param)
+{
+	QDF_STATUS ret;
+	wmi_buf_t buf;
+	uint16_t len = sizeof(wmi_vdev_set_param_cmd_fixed_param);
+
+	buf = wmi_vdev_param_build_tlv(wmi_handle, param);
+	if (!buf)
+		return QDF_STATUS_E_NOMEM;
 	ret = wmi_unified_cmd_send(wmi_handle, buf, len,
 				   WMI_VDEV_SET_PARAM_CMDID);
 	if (QDF_IS_STATUS_ERROR(ret)) {
@@ -1117,6 +1179,82 @@ QDF_STATUS send_vdev_set_param_cmd_tlv(wmi_unified_t wmi_handle,
 	return ret;
 }
 
+/**
+ * wmi_param_batch_build_tlv() - build the command of a batched set_param
+ * @wmi_handle: handle to WMI.
+ * @entry: queued set_param
+ * @len: returns the command length
+ * @cmd_id: returns the command id
+ *
+ * Return: command buffer, NULL on failure
+ */
+static wmi_buf_t wmi_param_batch_build_tlv(wmi_unified_t wmi_handle,
+					   struct wmi_param_batch_entry *entry,
+					   uint32_t *len, uint32_t *cmd_id)
+{
+	switch (entry->type) {
+	case WMI_PARAM_BATCH_PDEV:
+		*len = sizeof(wmi_pdev_set_param_cmd_fixed_param);
+		*cmd_id = WMI_PDEV_SET_PARAM_CMDID;
+		return wmi_pdev_param_build_tlv(wmi_handle, &entry->u.pdev);
+	case WMI_PARAM_BATCH_VDEV:
+		*len = sizeof(wmi_vdev_set_param_cmd_fixed_param);
+		*cmd_id = WMI_VDEV_SET_PARAM_CMDID;
+		return wmi_vdev_param_build_tlv(wmi_handle, &entry->u.vdev);
+	case WMI_PARAM_BATCH_PEER:
+		*len = sizeof(wmi_peer_set_param_cmd_fixed_param);
+		*cmd_id = WMI_PEER_SET_PARAM_CMDID;
+		return wmi_peer_param_build_tlv(wmi_handle, entry->peer_addr,
+						&entry->u.peer);
+	default:
+		return NULL;
+	}
+}
+
+/**
+ *  send_param_batch_cmd_tlv() - send a group of set_param commands
+ *  @param wmi_handle      : handle to WMI.
+ *  @param entries    : queued pdev, vdev and peer set_params
+ *  @param num    : number of entries
+ *
+ *  The firmware has no multi-parameter command, so each entry still
+ *  becomes its own command; they are handed to HTC together so that
+ *  it can bundle them.
+ *
+ *  Return: number of leading entries sent
+ */
+uint32_t send_param_batch_cmd_tlv(wmi_unified_t wmi_handle,
+				struct wmi_param_batch_entry *entries,
+				uint32_t num)
+{
+	wmi_buf_t bufs[WMI_PARAM_BATCH_MAX];
+	uint32_t lens[WMI_PARAM_BATCH_MAX];
+	uint32_t cmd_ids[WMI_PARAM_BATCH_MAX];
+	uint32_t built, sent, i;
+
+	if (num > WMI_PARAM_BATCH_MAX)
+		num = WMI_PARAM_BATCH_MAX;
+
+	for (built = 0; built < num; built++) {
+		bufs[built] = wmi_param_batch_build_tlv(wmi_handle,
+							&entries[built],
+							&lens[built],
+							&cmd_ids[built]);
+		if (!bufs[built])
+			break;
+	}
+
+	sent = wmi_unified_cmd_send_multiple(wmi_handle, bufs, lens, cmd_ids,
+					     built);
+	for (i = sent; i < built; i++)
+		wmi_buf_free(bufs[i]);
+
+	WMI_LOGD("%s: %u of %u set_param commands sent as a group",
+		 __func__, sent, num);
+
+	return sent;
+}
+
 /**
  *  send_stats_request_cmd_tlv() - WMI request stats function
  *  @param wmi_handle      : handle to WMI.
@@ -11819,6 +11957,7 @@ struct wmi_ops tlv_ops =  {
 	.send_crash_inject_cmd = send_crash_inject_cmd_tlv,
 	.send_dbglog_cmd = send_dbglog_cmd_tlv,
 	.send_vdev_set_param_cmd = send_vdev_set_param_cmd_tlv,
+	.send_param_batch_cmd = send_param_batch_cmd_tlv,
 	.send_stats_request_cmd = send_stats_request_cmd_tlv,
 	.send_packet_log_enable_cmd = send_packet_log_enable_cmd_tlv,
 	.send_beacon_send_cmd = send_beacon_send_cmd_tlv,
@@ -12716,6 +12855,36 @@ static void populate_vdev_param_tlv(uint32_t *vdev_param)
 }
 #endif
 
+/**
+ * wmi_tlv_track_cmd_responses() - time the commands answered by an event
+ * @wmi_handle: handle to wmi
+ *
+ * Return: None
+ */
+static void wmi_tlv_track_cmd_responses(wmi_unified_t wmi_handle)
+{
+#ifdef WMI_TLV_AND_NON_TLV_SUPPORT
+	uint32_t start_resp = wmi_vdev_start_resp_event_id;
+	uint32_t stopped = wmi_vdev_stopped_event_id;
+	uint32_t stats = wmi_update_stats_event_id;
+#else
+	uint32_t start_resp = WMI_VDEV_START_RESP_EVENTID;
+	uint32_t stopped = WMI_VDEV_STOPPED_EVENTID;
+	uint32_t stats = WMI_UPDATE_STATS_EVENTID;
+#endif
+
+	wmi_unified_track_cmd_response(wmi_handle,
+				       WMI_VDEV_START_REQUEST_CMDID,
+				       start_resp);
+	wmi_unified_track_cmd_response(wmi_handle,
+				       WMI_VDEV_RESTART_REQUEST_CMDID,
+				       start_resp);
+	wmi_unified_track_cmd_response(wmi_handle, WMI_VDEV_STOP_CMDID,
+				       stopped);
+	wmi_unified_track_cmd_response(wmi_handle, WMI_REQUEST_STATS_CMDID,
+				       stats);
+}
+
 /**
  * wmi_tlv_attach() - Attach TLV APIs
  *
@@ -12735,6 +12904,8 @@ void wmi_tlv_attach(wmi_unified_t wmi_handle)
 	populate_tlv_events_id(wmi_handle->wmi_events);
 	populate_pdev_param_tlv(wmi_handle->pdev_param);
 	populate_vdev_param_tlv(wmi_handle->vdev_param);
+	wmitlv_init_attr_index();
+	wmi_tlv_track_cmd_responses(wmi_handle);
 }
 #else
 void wmi_tlv_attach(wmi_unified_t wmi_handle)
@@ -12746,5 +12917,7 @@ void wmi_tlv_attach(wmi_unified_t wmi_handle)
 	wmi_handle->log_info.is_management_record =
 		is_management_record_tlv;
 #endif
+	wmitlv_init_attr_index();
+	wmi_tlv_track_cmd_responses(wmi_handle);
 }
 #endif